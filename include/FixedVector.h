@@ -0,0 +1,376 @@
+#ifndef IVECTOR_FIXEDVECTOR_H
+#define IVECTOR_FIXEDVECTOR_H
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+#include "IVector.h"
+#include "VectorAllocator.h"
+
+/*
+* Kernels for dimension known at compile time, every loop is unrolled by the fold expression.
+* Terms are added left to right, exactly like the plain loop
+*/
+namespace FixedKernels
+{
+    constexpr double abs(double val) { return val < 0 ? -val : val; }
+
+    template <size_t... I>
+    constexpr double sumAbs(double const* data, std::index_sequence<I...>)
+    {
+        return (0.0 + ... + abs(data[I]));
+    }
+
+    template <size_t... I>
+    constexpr double sumSquares(double const* data, std::index_sequence<I...>)
+    {
+        return (0.0 + ... + (data[I] * data[I]));
+    }
+
+    template <size_t... I>
+    constexpr double maxAbs(double const* data, std::index_sequence<I...>)
+    {
+        double result = 0;
+        ((result = abs(data[I]) > result ? abs(data[I]) : result), ...);
+        return result;
+    }
+
+    template <size_t... I>
+    constexpr double dot(double const* op1, double const* op2, std::index_sequence<I...>)
+    {
+        return (0.0 + ... + (op1[I] * op2[I]));
+    }
+
+    // result may be one of operands
+    template <size_t... I>
+    constexpr void axpby(double alpha, double const* op1, double beta, double const* op2, double* result, std::index_sequence<I...>)
+    {
+        ((result[I] = alpha * op1[I] + beta * op2[I]), ...);
+    }
+
+    template <size_t... I>
+    constexpr void scale(double multiplier, double const* data, double* result, std::index_sequence<I...>)
+    {
+        ((result[I] = multiplier * data[I]), ...);
+    }
+
+    // Inf - Inf and NaN - NaN are NaN, so the sum is 0 only for finite data
+    template <size_t... I>
+    constexpr bool isFinite(double const* data, std::index_sequence<I...>)
+    {
+        return (0.0 + ... + (data[I] - data[I])) == 0;
+    }
+}
+
+/*
+* Not template part of FixedVector, logger is shared by all dimensions
+*/
+class FixedVectorBase : public IVector {
+public:
+    static RC setLogger(ILogger* const logger);
+
+protected:
+    static void log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line);
+
+    FixedVectorBase() = default;
+
+private:
+    static ILogger* pLogger;
+};
+
+/*
+* Vector of dimension N with coordinates stored inside the object.
+*
+* IVector::createVector() returns it for dimensions 2, 3, 4 and 8. It can also be used directly as a value
+* (on stack or as a member): the class is final, so calls through FixedVector<N> are not virtual and
+* inline into unrolled code without dimension checks. Heap instances are created with new (std::nothrow)
+* and, like other vectors, live in VectorAllocator memory
+*/
+template <size_t N>
+class FixedVector final : public FixedVectorBase {
+    static_assert(N > 0, "FixedVector dimension must be positive");
+
+public:
+    using IVector::add;
+    using IVector::sub;
+    using IVector::dot;
+
+    // Coordinates follow the vtable pointer of FixedVectorBase
+    static constexpr size_t dataOffset = sizeof(FixedVectorBase);
+
+    // Zero vector
+    FixedVector() : _data() {}
+
+    FixedVector(FixedVector const& other) : FixedVectorBase()
+    {
+        copyCoords(other._data);
+    }
+
+    FixedVector& operator=(FixedVector const& other)
+    {
+        copyCoords(other._data);
+        return *this;
+    }
+
+    double operator[](size_t index) const { return _data[index]; }
+
+    IVector* clone() const override
+    {
+        auto* instance = new (std::nothrow) FixedVector(*this);
+        if (!instance)
+            log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+        return instance;
+    }
+
+    double const* getData() const override { return _data; }
+
+    RC setData(size_t dim, double const* const& ptr_data) override
+    {
+        if (!ptr_data || dim != N)
+        {
+            log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INVALID_ARGUMENT;
+        }
+
+        if (!FixedKernels::isFinite(ptr_data, indexes()))
+        {
+            log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::NOT_NUMBER;
+        }
+
+        copyCoords(ptr_data);
+        return RC::SUCCESS;
+    }
+
+    RC getCord(size_t index, double& val) const override
+    {
+        if (index >= N)
+        {
+            log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INDEX_OUT_OF_BOUND;
+        }
+
+        val = _data[index];
+        return RC::SUCCESS;
+    }
+
+    RC setCord(size_t index, double val) override
+    {
+        if (index >= N)
+        {
+            log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INDEX_OUT_OF_BOUND;
+        }
+
+        if (!std::isfinite(val))
+        {
+            log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INVALID_ARGUMENT;
+        }
+
+        _data[index] = val;
+        return RC::SUCCESS;
+    }
+
+    RC scale(double multiplier) override
+    {
+        if (!std::isfinite(multiplier))
+        {
+            log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INVALID_ARGUMENT;
+        }
+
+        double result[N];
+        FixedKernels::scale(multiplier, _data, result, indexes());
+        return commit(result);
+    }
+
+    size_t getDim() const override { return N; }
+
+    PRECISION getPrecision() const override { return PRECISION::DOUBLE; }
+
+    RC inc(IVector const* const& op) override
+    {
+        return combineWith(op, 1);
+    }
+
+    RC dec(IVector const* const& op) override
+    {
+        return combineWith(op, -1);
+    }
+
+    RC inc(FixedVector const& op)
+    {
+        double result[N];
+        FixedKernels::axpby(1, _data, 1, op._data, result, indexes());
+        return commit(result);
+    }
+
+    RC dec(FixedVector const& op)
+    {
+        double result[N];
+        FixedKernels::axpby(1, _data, -1, op._data, result, indexes());
+        return commit(result);
+    }
+
+    /*
+    * result = op1 + op2 (op1 - op2), result may be one of operands and stays unchanged on overflow
+    */
+    static RC add(FixedVector const& op1, FixedVector const& op2, FixedVector& result)
+    {
+        double coords[N];
+        FixedKernels::axpby(1, op1._data, 1, op2._data, coords, indexes());
+        return result.commit(coords);
+    }
+
+    static RC sub(FixedVector const& op1, FixedVector const& op2, FixedVector& result)
+    {
+        double coords[N];
+        FixedKernels::axpby(1, op1._data, -1, op2._data, coords, indexes());
+        return result.commit(coords);
+    }
+
+    static double dot(FixedVector const& op1, FixedVector const& op2)
+    {
+        const double result = FixedKernels::dot(op1._data, op2._data, indexes());
+        if (!std::isfinite(result))
+        {
+            log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return result;
+    }
+
+    double norm(NORM n) const override
+    {
+        double result = 0;
+
+        switch (n)
+        {
+            case NORM::FIRST:
+                result = FixedKernels::sumAbs(_data, indexes());
+                break;
+
+            case NORM::SECOND:
+                result = std::sqrt(FixedKernels::sumSquares(_data, indexes()));
+                break;
+
+            case NORM::CHEBYSHEV:
+                result = FixedKernels::maxAbs(_data, indexes());
+                break;
+
+            default:
+            {
+                log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+
+        if (!std::isfinite(result))
+        {
+            log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return result;
+    }
+
+    RC applyFunction(const std::function<double(double)>& fun) override
+    {
+        if (!fun)
+        {
+            log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INVALID_ARGUMENT;
+        }
+
+        double result[N];
+        for (size_t i = 0; i < N; i++)
+            result[i] = fun(_data[i]);
+
+        return commit(result);
+    }
+
+    RC foreach(const std::function<void(double)>& fun) const override
+    {
+        if (!fun)
+        {
+            log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INVALID_ARGUMENT;
+        }
+
+        for (size_t i = 0; i < N; i++)
+            fun(_data[i]);
+
+        return RC::SUCCESS;
+    }
+
+    size_t sizeAllocated() const override { return sizeof(FixedVector); }
+
+    ~FixedVector() override = default;
+
+    static void* operator new(size_t size, std::nothrow_t const&) noexcept
+    {
+        return VectorAllocator::allocate(size, dataOffset);
+    }
+
+    static void operator delete(void* ptr, std::nothrow_t const&) noexcept
+    {
+        VectorAllocator::deallocate(ptr);
+    }
+
+    static void operator delete(void* ptr)
+    {
+        VectorAllocator::deallocate(ptr);
+    }
+
+protected:
+    double* getMutableData() override { return _data; }
+
+private:
+    double _data[N];
+
+    static constexpr std::make_index_sequence<N> indexes() { return {}; }
+
+    void copyCoords(double const* data)
+    {
+        for (size_t i = 0; i < N; i++)
+            _data[i] = data[i];
+    }
+
+    RC commit(double const* result)
+    {
+        if (!FixedKernels::isFinite(result, indexes()))
+        {
+            log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INFINITY_OVERFLOW;
+        }
+
+        copyCoords(result);
+        return RC::SUCCESS;
+    }
+
+    RC combineWith(IVector const* const& op, double sign)
+    {
+        if (!op)
+        {
+            log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::NULLPTR_ERROR;
+        }
+
+        if (op->getDim() != N)
+        {
+            log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::MISMATCHING_DIMENSIONS;
+        }
+
+        double result[N];
+        FixedKernels::axpby(1, _data, sign, op->getData(), result, indexes());
+        return commit(result);
+    }
+};
+
+#endif //IVECTOR_FIXEDVECTOR_H
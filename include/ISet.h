@@ -1,15 +1,108 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 #include "IVector.h"
+#include "IVectorView.h"
 #include "RC.h"
 
 class ISet {
 public:
+    /*
+    * Index used to find vectors within tolerance. GRID hashes vectors into cells of the first tolerance
+    * passed to insert(), lookups check only nearby cells and stay exact for every norm.
+    * LSH is approximate, for vectors with hundreds of coordinates and more: lookups check only vectors with
+    * equal locality-sensitive hashes (see LshParams), so a vector within tolerance is found with high probability
+    * but not always, and insert() may then add a near duplicate, so such a set is never assumed to be tol apart
+    * by set algebra. Lookups under a norm other than the one of the first insert() are exact scans.
+    * NONE compares pattern with every vector
+    */
+    enum class INDEX {
+        NONE,
+        GRID,
+        LSH
+    };
+
+    /*
+    * Recall against speed of INDEX::LSH. Bucket width is in tolerances, every table has hashesPerTable hashes
+    * of width bucketWidth. More tables or wider buckets find more near vectors, more hashes per table check
+    * fewer vectors per lookup.
+    * Buckets are sized for the tolerance of the first insert(): lookups with a smaller tolerance find a near vector
+    * at least as often, lookups with a larger one (or another norm) are exact scans. Set algebra with such tolerance
+    * or norm builds a separate index for the call, the set keeps its own
+    */
+    struct LshParams
+    {
+        size_t tables = 8;
+        size_t hashesPerTable = 4;
+        double bucketWidth = 4;
+        // Every sampleEvery-th lookup is repeated by a scan to measure recall (see ScanStats), 0 turns it off
+        size_t sampleEvery = 64;
+        uint64_t seed = 1;
+    };
+
+    struct ScanStats
+    {
+        size_t lookups;        // Searches for a vector within tolerance (insert, find, remove by pattern)
+        size_t rowsVisited;    // Rows compared with the pattern by these searches
+        // Lookups through INDEX::LSH checked by a scan, recall is approxFound / exactFound
+        size_t sampledLookups;
+        size_t exactFound;     // Sampled lookups where the scan found a vector
+        size_t approxFound;    // Sampled lookups where the index found a vector
+    };
+
+    /*
+    * Files read by load(). CSV has a row per line with comma separated coordinates, BINARY is coordinates
+    * of the rows one after another as raw doubles in native byte order
+    */
+    enum class FILE_FORMAT {
+        CSV,
+        BINARY
+    };
+
+    struct LoadStats
+    {
+        size_t rowsRead;      // Rows found in the file
+        size_t rowsRejected;  // Rows with wrong number of coordinates, unparsable numbers, Inf or NaN
+        size_t rowsAccepted;  // Rows added to the set, the rest had a vector within tol already
+        double seconds;
+        double rowsPerSecond; // rowsRead / seconds
+    };
+
     static RC setLogger(ILogger* const logger);
 
     static ISet* createSet();
+
+    /*
+    * Set for concurrent use: any number of threads may read it (find, get, export, iterate) without locks
+    * while other threads modify it. Every modification publishes a new version of the set, which shares unchanged
+    * chunks of coordinates and of the tolerance index with the previous one, so a write costs about a pointer
+    * per chunk; vectors are still cheaper to add in batches. Iterators keep the version they were created on.
+    * getView() and rebindView() fail with INVALID_ARGUMENT, getCursor() logs the same error and returns
+    * an empty cursor whose isValid() is false. Iterate over clone() to use them
+    */
+    static ISet* createConcurrentSet();
+
+    /*
+    * Copy-on-write snapshot: clone shares coordinates, unique indexes and buckets of the tolerance index with the set
+    * and costs a pointer per chunk of rows and per shard of index buckets. Whichever set writes to a shared chunk,
+    * shard or bucket first copies it, so the clone and the set together take as much extra memory (and the first writes
+    * as much extra time) as the parts changed after cloning. Clone and set may be used on different threads
+    */
     virtual ISet* clone() const = 0;
 
+    /*
+    * Binary snapshot of the set: a versioned header with dimension, size and unique indexes of the vectors,
+    * then the coordinates, aligned to a page. openMapped() maps the file instead of reading it, so opening
+    * costs about the same for any size: coordinates are read from the file on first use, without copying.
+    * Chunks of rows point into the file and are copied to memory when the set (or its clone) writes to them
+    * (remove, compact), inserted vectors go to new chunks in memory. The file is never changed by the set
+    * and must not be changed while it or any of its clones is open.
+    * Snapshot is read only on machines with the same byte order
+    */
+    virtual RC save(char const* const& path) const = 0;
+    static ISet* openMapped(char const* const& path);
+
     static ISet* makeIntersection(ISet const * const& op1, ISet const * const& op2, IVector::NORM n, double tol);
     static ISet* makeUnion(ISet const * const& op1, ISet const * const& op2, IVector::NORM n, double tol);
     static ISet* sub(ISet const * const& op1, ISet const * const& op2, IVector::NORM n, double tol);
@@ -18,6 +111,15 @@ public:
     static bool equals(ISet const * const& op1, ISet const * const& op2, IVector::NORM n, double tol);
     static bool subSet(ISet const * const& op1, ISet const * const& op2, IVector::NORM n, double tol);
 
+    /*
+    * Threads used by the operations above (including the calling one), 0 means one per hardware thread.
+    * Threads are started at once, ALLOCATION_ERROR if some of them couldn't be (the ones started are used).
+    * Results don't depend on the number of threads, operations called from different threads run at the same
+    * time. Operands must not be modified while an operation runs
+    */
+    static RC setThreadCount(size_t count);
+    static size_t getThreadCount();
+
     virtual size_t getDim() const = 0;
     virtual size_t getSize() const = 0;
 
@@ -33,11 +135,78 @@ public:
     virtual RC getCoords(size_t index, IVector * const& val) const = 0;
     virtual RC findFirstAndCopyCoords(IVector const * const& pat, IVector::NORM n, double tol, IVector * const& val) const = 0;
 
+    /*
+    * Nearest neighbours of pat under n, written nearest first to caller's buffers: indices[i] is the index
+    * of a vector (as in getCoords), distances[i] is its distance from pat, equal distances go in index order.
+    * findKNearest writes min(k, getSize()) vectors to buffers of k elements.
+    * findWithin looks for vectors with distance less than r: found is the number of them, the nearest
+    * min(found, capacity) are written to buffers of capacity elements.
+    * Queries don't allocate, the first query after a change builds a k-d tree over the vectors
+    */
+    virtual RC findKNearest(IVector const * const& pat, size_t k, IVector::NORM n, size_t* const& indices, double* const& distances, size_t& found) const = 0;
+    virtual RC findWithin(IVector const * const& pat, double r, IVector::NORM n, size_t* const& indices, double* const& distances, size_t capacity, size_t& found) const = 0;
+
+    /*
+     * Read-only view of vector in ISet without copying, it stays valid (IVectorView::isValid) until the set
+     * is modified or destroyed. getView creates new view, rebindView points existing one to the vector
+     */
+    virtual RC getView(size_t index, IVectorView *& val) const = 0;
+    virtual RC rebindView(size_t index, IVectorView * const& val) const = 0;
+
+    /*
+    * Bulk copy of vectors [start, start + count) to dst without creating IVector instances.
+    * exportRange writes vector i at dst + i * strideDoubles (strideDoubles >= getDim()),
+    * exportRangeColumnMajor writes coordinate j of vector i at dst[j * ldDoubles + i] (ldDoubles >= count),
+    * exportIndices writes vector indices[i] at dst + i * strideDoubles.
+    * Arguments are checked before anything is written
+    */
+    virtual RC exportRange(size_t start, size_t count, double* const& dst, size_t strideDoubles) const = 0;
+    virtual RC exportRangeColumnMajor(size_t start, size_t count, double* const& dst, size_t ldDoubles) const = 0;
+    virtual RC exportIndices(size_t const* const& indices, size_t count, double* const& dst, size_t strideDoubles) const = 0;
+
     virtual RC insert(IVector const * const& val, IVector::NORM n, double tol) = 0;
 
+    /*
+    * Inserts count vectors of dimension dim stored one after another in rows, the result is the same as
+    * inserting them one by one: a row is skipped if the set already has a vector within tol, including rows
+    * accepted earlier from the same batch. accepted is the number of rows added to the set.
+    * If any row has Inf or NaN nothing is inserted
+    */
+    virtual RC insertBatch(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol, size_t& accepted) = 0;
+
+    /*
+    * Same for a range of IVector pointers, e.g. of std::vector<IVector*>
+    */
+    template <class It>
+    RC insertBatch(It first, It last, IVector::NORM n, double tol, size_t& accepted);
+
+    /*
+    * Streams vectors of dimension dim from a file into the set. The file is parsed on another thread in chunks
+    * of fixed size while the previous chunks go to insertBatch(), so memory use doesn't depend on the file size.
+    * Invalid rows are skipped and counted in stats, the logger gets a warning if there were any.
+    * If insertion fails, rows of the chunks before stay in the set
+    */
+    RC load(char const* const& path, FILE_FORMAT format, size_t dim, IVector::NORM n, double tol, LoadStats& stats);
+
     virtual RC remove(size_t index) = 0;
     virtual RC remove(IVector const * const& pat, IVector::NORM n, double tol) = 0;
 
+    // GRID by default
+    virtual RC setIndex(INDEX index) = 0;
+    // Takes effect when the index is built next time, by the next insert()
+    virtual RC setLshParams(LshParams const& params) = 0;
+
+    /*
+    * remove() only marks vectors as removed, their memory is reused by compaction. It runs when removed vectors
+    * make more than deadFraction of the storage (0.25 by default, 1 turns it off) or when compact() is called.
+    * Iterators stay valid across compaction, views don't
+    */
+    virtual RC compact() = 0;
+    virtual RC setCompactionThreshold(double deadFraction) = 0;
+
+    virtual ScanStats getScanStats() const = 0;
+    virtual void resetScanStats() = 0;
+
     /*
     * Iterator object can be created with ISet methods ISet::getIterator, ISet::getBegin, ISet::getEnd
     */
@@ -84,6 +253,78 @@ public:
         IIterator() = default;
     };
 
+    /*
+    * Forward cursor over coordinates of the vectors, in the same order as IIterator.
+    *
+    * Cursor is a small value: stepping doesn't allocate, copy coordinates or call virtual functions, and data()
+    * points straight into the set storage. Any insert, remove or compaction invalidates the cursor,
+    * isValid() tells if that happened. A default constructed cursor, or one of a set without cursor support
+    * (see createConcurrentSet()), is empty and never valid. Like a view, the cursor must not outlive the set:
+    *
+    *     for (double const* coords : *set)
+    *         total += coords[0];
+    */
+    class Cursor {
+    public:
+        Cursor() = default;
+
+        double const* data() const { return _chunks[_slot >> _chunkShift] + (_slot & _chunkMask) * _dim; }
+        double const* operator*() const { return data(); }
+        size_t getDim() const { return _dim; }
+
+        bool isEnd() const { return _slot >= _slots; }
+        // False after the set was changed, data() must not be used then
+        bool isValid() const { return _epoch != nullptr && *_epoch == _expectedEpoch; }
+
+        Cursor& operator++()
+        {
+            _slot++;
+            skipRemoved();
+            return *this;
+        }
+
+        bool operator==(Cursor const& other) const { return _slot == other._slot && _chunks == other._chunks; }
+        bool operator!=(Cursor const& other) const { return !(*this == other); }
+
+    private:
+        friend class ISet;
+
+        // Rows are stored in chunks of 2^_chunkShift rows, _chunks points to the first row of every chunk
+        double const* const* _chunks = nullptr;
+        size_t _chunkShift = 0;
+        size_t _chunkMask = 0;
+        size_t _dim = 0;
+        size_t _slot = 0;
+        size_t _slots = 0;
+        size_t const* _epoch = nullptr;
+        size_t _expectedEpoch = 0;
+
+        Cursor(double const* const* chunks, size_t chunkShift, size_t dim, size_t slots, size_t const* epoch) :
+            _chunks(chunks), _chunkShift(chunkShift), _chunkMask((size_t(1) << chunkShift) - 1), _dim(dim), _slots(slots),
+            _epoch(epoch), _expectedEpoch(*epoch)
+        {
+            skipRemoved();
+        }
+
+        // Removed vectors stay in storage as NaN until compaction, see compact()
+        void skipRemoved()
+        {
+            while (_slot < _slots && data()[0] != data()[0])
+                _slot++;
+        }
+    };
+
+    virtual Cursor getCursor() const = 0;
+
+    Cursor begin() const { return getCursor(); }
+
+    Cursor end() const
+    {
+        Cursor cursor = getCursor();
+        cursor._slot = cursor._slots;
+        return cursor;
+    }
+
     virtual IIterator *getIterator(size_t index) const = 0;
     virtual IIterator *getBegin() const = 0;
     virtual IIterator *getEnd() const = 0;
@@ -96,4 +337,44 @@ private:
 
 protected:
     ISet() = default;
+
+    /*
+    * For implementations: slots rows of dim coordinates in chunks of 2^chunkShift rows, chunks[i] is the first row
+    * of chunk i. epoch changes on every modification
+    */
+    static Cursor makeCursor(double const* const* chunks, size_t chunkShift, size_t dim, size_t slots, size_t const* epoch)
+    {
+        return Cursor(chunks, chunkShift, dim, slots, epoch);
+    }
 };
+
+template <class It>
+RC ISet::insertBatch(It first, It last, IVector::NORM n, double tol, size_t& accepted)
+{
+    accepted = 0;
+    if (first == last)
+        return RC::SUCCESS;
+
+    if (*first == nullptr)
+        return RC::NULLPTR_ERROR;
+
+    // Coordinates are gathered into one buffer, so the batch is deduplicated in a single insertBatch() call
+    const size_t dim = (*first)->getDim();
+    std::vector<double> rows;
+    size_t count = 0;
+    for (It it = first; it != last; ++it)
+    {
+        IVector const* vector = *it;
+        if (vector == nullptr)
+            return RC::NULLPTR_ERROR;
+
+        if (vector->getDim() != dim)
+            return RC::MISMATCHING_DIMENSIONS;
+
+        double const* data = vector->getData();
+        rows.insert(rows.end(), data, data + dim);
+        count++;
+    }
+
+    return insertBatch(dim, rows.data(), count, n, tol, accepted);
+}
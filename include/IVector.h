@@ -1,9 +1,18 @@
 #pragma once
 #include <cstddef>
 #include <functional>
+#include <initializer_list>
+#include <utility>
 #include "RC.h"
 #include "ILogger.h"
 
+class IVectorArena;
+
+namespace VectorExpression {
+    template <class E>
+    struct Expr;
+}
+
 class IVector {
 public:
     enum class NORM {
@@ -13,7 +22,27 @@ public:
         AMOUNT
     };
 
+    /*
+    * Storage of coordinates. FLOAT and BFLOAT16 halve/quarter memory, coordinates are rounded to storage
+    * precision on every write and must fit its range. Reductions (norm, dot, distance, equals) read
+    * compact coordinates directly and accumulate in double.
+    *
+    * getData() of compact vector returns decoded copy in thread-local memory, it stays valid until 8 more
+    * getData() calls of compact vectors on the same thread. Compact vector can't be dest of assign() and
+    * functions built on it (axpy etc.), its own modifying methods work as usual
+    */
+    enum class PRECISION {
+        DOUBLE,
+        FLOAT,
+        BFLOAT16
+    };
+
     static IVector* createVector(size_t dim, double const* const& ptr_data);
+    /*
+    * Same as createVector() but the instance is placed into arena, see IVectorArena for lifetime rules
+    */
+    static IVector* createVector(size_t dim, double const* const& ptr_data, IVectorArena* const& arena);
+    static IVector* createVector(size_t dim, double const* const& ptr_data, PRECISION precision);
     static RC copyInstance(IVector* const dest, IVector const* const& src);
     static RC moveInstance(IVector* const dest, IVector*& src);
 
@@ -28,6 +57,7 @@ public:
     virtual RC setCord(size_t index, double val) = 0;
     virtual RC scale(double multiplier) = 0;
     virtual size_t getDim() const = 0;
+    virtual PRECISION getPrecision() const = 0;
 
     virtual RC inc(IVector const* const& op) = 0;
     virtual RC dec(IVector const* const& op) = 0;
@@ -35,13 +65,55 @@ public:
     static IVector* add(IVector const* const& op1, IVector const* const& op2);
     static IVector* sub(IVector const* const& op1, IVector const* const& op2);
 
+    /*
+    * Arithmetic into existing vector without allocations. Result vector must have dimension of operands
+    * and may be one of them, it stays unchanged if result has invalid coordinates
+    */
+    // y = alpha * x + y
+    static RC axpy(double alpha, IVector const* const& x, IVector* const& y);
+    // y = alpha * x + beta * y
+    static RC axpby(double alpha, IVector const* const& x, double beta, IVector* const& y);
+    // dest = alpha * x + y
+    static RC scaleAdd(IVector* const& dest, double alpha, IVector const* const& x, IVector const* const& y);
+    // dest = a * x + b * y - z
+    static RC combine(IVector* const& dest, double a, IVector const* const& x, double b, IVector const* const& y, IVector const* const& z);
+    // dest = sum of coefficient * vector over terms
+    static RC linearCombination(IVector* const& dest, std::initializer_list<std::pair<double, IVector const*>> const& terms);
+
+    /*
+    * Evaluates expression built with VectorExpression.h into dest in one pass, defined there
+    */
+    template <class E>
+    static RC assign(IVector* const& dest, VectorExpression::Expr<E> const& expr);
+
     static double dot(IVector const* const& op1, IVector const* const& op2);
     static bool equals(IVector const* const& op1, IVector const* const& op2, NORM n, double tol);
+    /*
+    * Norm of op1 - op2, computed without creating the difference vector
+    */
+    static double distance(IVector const* const& op1, IVector const* const& op2, NORM n);
+    /*
+    * Same as distance() but stops as soon as the partial norm reaches bound, then result is some value >= bound
+    */
+    static double distance(IVector const* const& op1, IVector const* const& op2, NORM n, double bound);
     virtual double norm(NORM n) const = 0;
 
     virtual RC applyFunction(const std::function<double(double)>& fun) = 0;
     virtual RC foreach(const std::function<void(double)>& fun) const = 0;
 
+    /*
+    * Same as applyFunction()/foreach() for any callable, calls are inlined. Defined in VectorExpression.h
+    *
+    * fun is called exactly once per coordinate, applyInline() and zipApply() commit results only if all of them are valid
+    */
+    template <class F>
+    RC applyInline(F&& fun);
+    template <class F>
+    RC forEachInline(F&& fun) const;
+    // dest[i] = fun(op1[i], op2[i]), dest may be one of operands
+    template <class F>
+    static RC zipApply(IVector* const& dest, IVector const* const& op1, IVector const* const& op2, F&& fun);
+
     virtual size_t sizeAllocated() const = 0;
 
     virtual ~IVector() = 0;
@@ -52,4 +124,9 @@ private:
 
 protected:
     IVector() = default;
+
+    /*
+    * Coordinates for in-place kernels, nullptr if vector can't be modified in place
+    */
+    virtual double* getMutableData() = 0;
 };
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include "ILogger.h"
+#include "RC.h"
+
+/*
+* Arena for short-lived vectors, created with IVector::createVector(dim, ptr_data, arena)
+*
+* Memory of every vector created in arena is released at once by reset() or by deleting the arena.
+* delete of such vector is allowed but doesn't release memory. Vectors must not be used after reset()
+* and must not outlive their arena
+*/
+class IVectorArena {
+public:
+    /*
+    * @param [in] chunkSize Size in bytes of memory chunks requested from the system
+    */
+    static IVectorArena* createArena(size_t chunkSize = 64 * 1024);
+
+    static RC setLogger(ILogger* const logger);
+
+    /*
+    * Returns memory for vector instance of size bytes, or nullptr if allocation failed.
+    * Coordinates dataOffset bytes after the instance are aligned like in VectorAllocator
+    */
+    virtual void* allocate(size_t size, size_t dataOffset = 0) = 0;
+
+    /*
+    * Releases all vectors created in arena, current chunk is kept for reuse
+    */
+    virtual RC reset() = 0;
+
+    virtual size_t getAllocationsCount() const = 0;
+    virtual size_t sizeAllocated() const = 0;
+
+    virtual ~IVectorArena() = 0;
+
+private:
+    IVectorArena(const IVectorArena& arena) = delete;
+    IVectorArena& operator=(const IVectorArena& arena) = delete;
+
+protected:
+    IVectorArena() = default;
+};
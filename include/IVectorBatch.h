@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include "ILogger.h"
+#include "IVector.h"
+#include "RC.h"
+
+class ISet;
+
+/*
+* Fixed number of vectors of the same dimension in one contiguous block.
+*
+* ROW_MAJOR keeps every vector contiguous (vector i starts at i * dim), SOA keeps every coordinate
+* contiguous (coordinate j of all vectors starts at j * count). Bulk methods do one pass over the block,
+* modifying ones leave the batch unchanged if any result is invalid
+*/
+class IVectorBatch {
+public:
+    enum class LAYOUT {
+        ROW_MAJOR,
+        SOA
+    };
+
+    // Batch of count zero vectors
+    static IVectorBatch* createBatch(size_t dim, size_t count, LAYOUT layout = LAYOUT::ROW_MAJOR);
+    // rows are count vectors one after another (row-major) whatever layout of the batch is
+    static IVectorBatch* createBatch(size_t dim, size_t count, double const* const& rows, LAYOUT layout = LAYOUT::ROW_MAJOR);
+    static IVectorBatch* createBatch(IVector const* const* const& vectors, size_t count, LAYOUT layout = LAYOUT::ROW_MAJOR);
+    static IVectorBatch* createBatch(ISet const* const& set, LAYOUT layout = LAYOUT::ROW_MAJOR);
+
+    static RC setLogger(ILogger* const logger);
+
+    virtual IVectorBatch* clone() const = 0;
+
+    virtual size_t getDim() const = 0;
+    virtual size_t getCount() const = 0;
+    virtual LAYOUT getLayout() const = 0;
+
+    /*
+    * Copies vector index to existing vector val / from vector val
+    */
+    virtual RC getRow(size_t index, IVector* const& val) const = 0;
+    virtual RC setRow(size_t index, IVector const* const& val) = 0;
+
+    /*
+    * Writes all vectors one after another to dst of getCount() * getDim() doubles
+    */
+    virtual RC exportRows(double* const& dst) const = 0;
+    /*
+    * Inserts all vectors to set with ISet::insert semantic
+    */
+    virtual RC exportToSet(ISet* const& set, IVector::NORM n, double tol) const = 0;
+
+    /*
+    * Bulk kernels, result arrays have getCount() elements
+    */
+    virtual RC norms(IVector::NORM n, double* const& result) const = 0;
+    // result[i] = dot(vector i, query)
+    virtual RC dots(IVector const* const& query, double* const& result) const = 0;
+    // result[i] = IVector::equals(vector i, pat, n, tol)
+    virtual RC equals(IVector const* const& pat, IVector::NORM n, double tol, bool* const& result) const = 0;
+
+    virtual RC scale(double multiplier) = 0;
+    // vector i += alpha * x for every i
+    virtual RC axpy(double alpha, IVector const* const& x) = 0;
+    // vector i += alpha * vector i of x, batches must have the same dim and count
+    virtual RC axpy(double alpha, IVectorBatch const* const& x) = 0;
+
+    virtual ~IVectorBatch() = 0;
+
+private:
+    IVectorBatch(const IVectorBatch& batch) = delete;
+    IVectorBatch& operator=(const IVectorBatch& batch) = delete;
+
+protected:
+    IVectorBatch() = default;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include "IVector.h"
+
+/*
+* Vector over coordinates owned by someone else (ISet, caller buffer), nothing is copied or released.
+*
+* Read-only view returns INVALID_ARGUMENT from every modifying method, mutable view writes through to the
+* memory it was created over. Coordinates are not validated, norm() and other reductions over Inf or NaN
+* return NaN like on overflow. clone() returns an ordinary owning vector.
+*
+* Views must not be passed to IVector::copyInstance()/moveInstance()
+*/
+class IVectorView : public IVector {
+public:
+    /*
+    * Counter of the memory owner, it's changed when owner's memory may move or be released.
+    * View remembers the value at creation, empty epoch means that caller controls lifetime himself
+    */
+    using Epoch = std::shared_ptr<size_t const>;
+
+    static IVectorView* createView(size_t dim, double const* const& ptr_data, Epoch const& epoch = Epoch());
+    static IVectorView* createMutableView(size_t dim, double* const& ptr_data, Epoch const& epoch = Epoch());
+
+    static RC setLogger(ILogger* const logger);
+
+    /*
+    * False if epoch was changed after view creation, coordinates must not be read then.
+    * Reading methods don't check it, modifying methods return SOURCE_SET_DESTROYED
+    */
+    virtual bool isValid() const = 0;
+    virtual bool isMutable() const = 0;
+
+    /*
+    * Points existing view to other coordinates without allocations
+    */
+    virtual RC rebind(size_t dim, double const* const& ptr_data, Epoch const& epoch = Epoch()) = 0;
+    virtual RC rebindMutable(size_t dim, double* const& ptr_data, Epoch const& epoch = Epoch()) = 0;
+
+protected:
+    IVectorView() = default;
+};
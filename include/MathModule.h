@@ -4,12 +4,16 @@
 #include "../include/IVector.h"
 #include "../include/ISet.h"
 #include "../src/VectorImpl.cpp"
+#include "../include/VectorExpression.h"
 #include <functional>
 #include <limits>
 #include <math.h>
 
 
-IVector* AddAndSub(const IVector *op1, const IVector *op2, const std::function<double(double, double)>& func);
+/*
+* Creates op1 + sign * op2
+*/
+IVector* AddAndSub(const IVector *op1, const IVector *op2, double sign);
 
 RC forEachInSet(const ISet* const& set, std::function<RC(IVector*)>& func);
 
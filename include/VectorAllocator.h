@@ -0,0 +1,65 @@
+#ifndef IVECTOR_VECTORALLOCATOR_H
+#define IVECTOR_VECTORALLOCATOR_H
+
+#include <cstddef>
+
+/*
+* Storage for IVector instances.
+*
+* Every instance lives in a block with a small header in front of it. The header keeps the size of the instance
+* and the owner of the block, so deallocate() either returns the block to the free list of its size class
+* (one list per instance size, i.e. per dimension, per thread) or leaves it to the IVectorArena that owns it.
+*
+* Instance is placed so that its coordinates, dataOffset bytes after the instance, start on a dataAlignment
+* boundary. Blocks of hugePageThreshold bytes and more are mapped separately and backed by huge pages
+* where the system supports it, they are never cached
+*/
+namespace VectorAllocator
+{
+    const size_t dataAlignment = 64;
+    const size_t hugePageThreshold = 4 * 1024 * 1024;
+
+    struct Stats
+    {
+        size_t requests;            // Blocks requested by createVector/clone/add/sub
+        size_t poolHits;            // Requests served from per-thread free lists
+        size_t arenaHits;           // Requests served from an IVectorArena
+        size_t systemAllocations;   // Requests that reached operator new or mmap
+        size_t systemReleases;      // Blocks returned to operator delete or munmap
+        size_t hugePageAllocations; // Part of systemAllocations mapped with huge pages
+    };
+
+    /*
+    * Returns memory for an instance of size bytes, or nullptr if allocation failed
+    */
+    void* allocate(size_t size, size_t dataOffset = 0);
+
+    /*
+    * Returns block obtained by allocate() or markArenaBlock() back to the allocator
+    */
+    void deallocate(void* instance);
+
+    /*
+    * Size of the raw block starting at dataAlignment boundary an arena has to reserve for an instance of size bytes
+    */
+    size_t blockSize(size_t size, size_t dataOffset = 0);
+
+    /*
+    * Writes header into arena-owned block of blockSize(size, dataOffset) bytes and returns memory for the instance.
+    * deallocate() of such instance doesn't release anything, the arena does it all at once
+    */
+    void* markArenaBlock(void* block, size_t size, size_t dataOffset = 0);
+
+    /*
+    * Releases blocks cached by the calling thread
+    */
+    void releaseCached();
+
+    /*
+    * Counters are process-wide, allocations saved = poolHits + arenaHits
+    */
+    Stats getStats();
+    void resetStats();
+}
+
+#endif //IVECTOR_VECTORALLOCATOR_H
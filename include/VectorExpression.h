@@ -0,0 +1,193 @@
+#ifndef IVECTOR_VECTOREXPRESSION_H
+#define IVECTOR_VECTOREXPRESSION_H
+
+#include <cstddef>
+#include <cstring>
+#include "IVector.h"
+#include "VectorKernels.h"
+
+/*
+* Expression templates for IVector arithmetic.
+*
+* Expression only keeps pointers to coordinates of its operands and is evaluated element by element
+* by IVector::assign(), so x + alpha * d - y costs one pass over memory and no temporary vectors:
+*
+*     using namespace VectorExpression;
+*     IVector::assign(x, vec(x) + alpha * vec(d));
+*
+* Operands must stay alive and unchanged until assign() returns
+*/
+namespace VectorExpression
+{
+    template <class E>
+    struct Expr {
+        E const& self() const { return static_cast<E const&>(*this); }
+    };
+
+    struct Leaf : Expr<Leaf> {
+        double const* data;
+        size_t dim;
+
+        Leaf(double const* data, size_t dim) : data(data), dim(dim) {}
+
+        double operator[](size_t index) const { return data[index]; }
+        size_t getDim() const { return dim; }
+    };
+
+    template <class E>
+    struct Scaled : Expr<Scaled<E>> {
+        double alpha;
+        E expr;
+
+        Scaled(double alpha, E const& expr) : alpha(alpha), expr(expr) {}
+
+        double operator[](size_t index) const { return alpha * expr[index]; }
+        size_t getDim() const { return expr.getDim(); }
+    };
+
+    struct Plus {
+        static double apply(double a, double b) { return a + b; }
+    };
+
+    struct Minus {
+        static double apply(double a, double b) { return a - b; }
+    };
+
+    template <class L, class R, class Op>
+    struct Binary : Expr<Binary<L, R, Op>> {
+        L left;
+        R right;
+
+        Binary(L const& left, R const& right) : left(left), right(right) {}
+
+        double operator[](size_t index) const { return Op::apply(left[index], right[index]); }
+        // 0 marks operands of different dimensions, valid vector never has it
+        size_t getDim() const { return left.getDim() == right.getDim() ? left.getDim() : 0; }
+    };
+
+    inline Leaf vec(IVector const* const& vector)
+    {
+        return vector ? Leaf(vector->getData(), vector->getDim()) : Leaf(nullptr, 0);
+    }
+
+    template <class L, class R>
+    Binary<L, R, Plus> operator+(Expr<L> const& left, Expr<R> const& right)
+    {
+        return Binary<L, R, Plus>(left.self(), right.self());
+    }
+
+    template <class L, class R>
+    Binary<L, R, Minus> operator-(Expr<L> const& left, Expr<R> const& right)
+    {
+        return Binary<L, R, Minus>(left.self(), right.self());
+    }
+
+    template <class E>
+    Scaled<E> operator*(double alpha, Expr<E> const& expr)
+    {
+        return Scaled<E>(alpha, expr.self());
+    }
+
+    template <class E>
+    Scaled<E> operator*(Expr<E> const& expr, double alpha)
+    {
+        return Scaled<E>(alpha, expr.self());
+    }
+
+    template <class E>
+    Scaled<E> operator-(Expr<E> const& expr)
+    {
+        return Scaled<E>(-1, expr.self());
+    }
+}
+
+template <class E>
+RC IVector::assign(IVector* const& dest, VectorExpression::Expr<E> const& expr)
+{
+    if (!dest)
+        return RC::NULLPTR_ERROR;
+
+    E const& e = expr.self();
+    const size_t dim = dest->getDim();
+    if (e.getDim() != dim)
+        return RC::MISMATCHING_DIMENSIONS;
+
+    double* coords = dest->getMutableData();
+    if (!coords)
+        return RC::INVALID_ARGUMENT;
+
+    // dest may be an operand of the expression, so it is overwritten only after the whole result is valid
+    VectorKernels::Scratch scratch(dim);
+    double* result = scratch.data();
+    for (size_t i = 0; i < dim; i++)
+        result[i] = e[i];
+
+    if (!VectorKernels::isFinite(result, dim))
+        return RC::INFINITY_OVERFLOW;
+
+    memcpy(coords, result, dim * sizeof(double));
+    return RC::SUCCESS;
+}
+
+template <class F>
+RC IVector::applyInline(F&& fun)
+{
+    const size_t dim = getDim();
+    double* coords = getMutableData();
+    if (!coords)
+        return RC::INVALID_ARGUMENT;
+
+    VectorKernels::Scratch scratch(dim);
+    double* result = scratch.data();
+    for (size_t i = 0; i < dim; i++)
+        result[i] = fun(coords[i]);
+
+    if (!VectorKernels::isFinite(result, dim))
+        return RC::INFINITY_OVERFLOW;
+
+    memcpy(coords, result, dim * sizeof(double));
+    return RC::SUCCESS;
+}
+
+template <class F>
+RC IVector::forEachInline(F&& fun) const
+{
+    const size_t dim = getDim();
+    double const* coords = getData();
+
+    for (size_t i = 0; i < dim; i++)
+        fun(coords[i]);
+
+    return RC::SUCCESS;
+}
+
+template <class F>
+RC IVector::zipApply(IVector* const& dest, IVector const* const& op1, IVector const* const& op2, F&& fun)
+{
+    if (!dest || !op1 || !op2)
+        return RC::NULLPTR_ERROR;
+
+    const size_t dim = dest->getDim();
+    if (op1->getDim() != dim || op2->getDim() != dim)
+        return RC::MISMATCHING_DIMENSIONS;
+
+    double* coords = dest->getMutableData();
+    if (!coords)
+        return RC::INVALID_ARGUMENT;
+
+    double const* data1 = op1->getData();
+    double const* data2 = op2->getData();
+
+    VectorKernels::Scratch scratch(dim);
+    double* result = scratch.data();
+    for (size_t i = 0; i < dim; i++)
+        result[i] = fun(data1[i], data2[i]);
+
+    if (!VectorKernels::isFinite(result, dim))
+        return RC::INFINITY_OVERFLOW;
+
+    memcpy(coords, result, dim * sizeof(double));
+    return RC::SUCCESS;
+}
+
+#endif //IVECTOR_VECTOREXPRESSION_H
@@ -0,0 +1,99 @@
+#ifndef IVECTOR_VECTORKERNELS_H
+#define IVECTOR_VECTORKERNELS_H
+
+#include <cstddef>
+#include <limits>
+#include "IVector.h"
+#include "RC.h"
+
+/*
+* Reduction kernels over raw coordinates used by IVector implementations.
+*
+* Kernels don't validate anything per element, caller checks that the result is finite once
+* (overflow of any partial sum turns the result into Inf or NaN, so nothing is lost).
+*
+* Implementation is picked once, on the first call, by CPUID: AVX-512, AVX2, SSE2 or portable scalar code.
+* Vector kernels sum in several independent lanes, so results may differ from the plain left-to-right loop:
+* - maxAbs is exact for every implementation;
+* - sumAbs and sumSquares add non-negative terms, both orders are within (dim - 1) * eps relative error
+*   of the exact sum, so they differ by at most 2 * (dim - 1) ulp of the result (in practice a few ulp);
+* - dot has the same bound, but relative to sum |op1[i] * op2[i]| instead of the result itself,
+*   results close to zero because of cancellation may differ in all digits.
+*/
+namespace VectorKernels
+{
+    enum class ISA {
+        SCALAR,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    double sumAbs(double const* data, size_t dim);
+    double sumSquares(double const* data, size_t dim);
+    double maxAbs(double const* data, size_t dim);
+    double dot(double const* op1, double const* op2, size_t dim);
+
+    /*
+    * Norms of op1 - op2 without building the difference, each operand is read once.
+    *
+    * Kernels stop as soon as the partial result reaches bound and return that partial result, so any
+    * returned value below bound is the complete result (partial norms never decrease). For sumSquaresDiff
+    * bound applies to the sum of squares, distance() takes bound for the norm itself
+    */
+    double sumAbsDiff(double const* op1, double const* op2, size_t dim, double bound = std::numeric_limits<double>::infinity());
+    double sumSquaresDiff(double const* op1, double const* op2, size_t dim, double bound = std::numeric_limits<double>::infinity());
+    double maxAbsDiff(double const* op1, double const* op2, size_t dim, double bound = std::numeric_limits<double>::infinity());
+    double distance(double const* op1, double const* op2, size_t dim, IVector::NORM n, double bound = std::numeric_limits<double>::infinity());
+
+    /*
+    * Index of the first of count rows (row-major, dim coordinates each) with distance(row, pat) < tol,
+    * count if there is none. visited is the number of rows looked at, including the matching one.
+    *
+    * Rows are scanned in blocks: a pass over the first coordinate of every row in the block drops rows
+    * that can't match under any norm, distance() runs only for the rest. Nothing is allocated
+    */
+    size_t findWithin(double const* rows, size_t count, size_t dim, double const* pat, IVector::NORM n, double tol, size_t& visited);
+
+    /*
+    * True if there is no Inf or NaN in data
+    */
+    bool isFinite(double const* data, size_t dim);
+
+    /*
+    * memcpy of non-overlapping blocks. Blocks of streamingThreshold bytes and more are written with
+    * non-temporal stores, so copying a large vector doesn't evict everything else from the cache
+    */
+    void copy(void* dst, void const* src, size_t bytes);
+    size_t getStreamingThreshold();
+    void setStreamingThreshold(size_t bytes);
+
+    /*
+    * Thread-local buffer for results that are committed only after validation.
+    * Buffers are taken in stack order, so nested operations on the same thread get different buffers
+    */
+    class Scratch {
+    public:
+        explicit Scratch(size_t dim);
+
+        double* data() const { return _data; }
+
+        ~Scratch();
+
+    private:
+        double* _data;
+
+        Scratch(const Scratch&) = delete;
+        Scratch& operator=(const Scratch&) = delete;
+    };
+
+    ISA getISA();
+
+    /*
+    * Forces implementation (e.g. SCALAR to compare results), returns INVALID_ARGUMENT if CPU doesn't support it.
+    * May be called while other threads use kernels, calls already running finish on the previous implementation
+    */
+    RC setISA(ISA isa);
+}
+
+#endif //IVECTOR_VECTORKERNELS_H
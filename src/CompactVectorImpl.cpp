@@ -0,0 +1,431 @@
+#ifndef IVECTOR_COMPACTVECTORIMPL_H
+#define IVECTOR_COMPACTVECTORIMPL_H
+
+#include "../include/IVector.h"
+#include "../include/ValidChecker.h"
+#include "../include/VectorAllocator.h"
+#include "../include/VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+    /*
+    * Vector with FLOAT or BFLOAT16 coordinates placed right after the object, like VectorImpl.
+    * Coordinates are rounded on every write, reductions decode blocks to double and use VectorKernels
+    */
+    class CompactVectorImpl : public IVector {
+    private:
+        size_t _dim = 0;
+        PRECISION _precision;
+        static ILogger* pLogger;
+
+        void* storage() const { return (uint8_t*)this + sizeof(CompactVectorImpl); }
+
+        // Writes src only if every coordinate is representable in storage precision
+        RC encodeChecked(double const* src);
+
+    public:
+        // Coordinates are decoded and reduced by blocks of this size
+        static constexpr size_t blockSize = 256;
+
+        static void log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line);
+
+        static RC setLogger(ILogger* const logger);
+
+        static size_t elementSize(PRECISION precision);
+
+        // Rounds src to storage precision, result is Inf if it doesn't fit
+        static void encode(double const* src, size_t count, PRECISION precision, void* dst);
+        static void decode(void const* src, size_t count, PRECISION precision, double* dst);
+
+        CompactVectorImpl(size_t dim, PRECISION precision) : _dim(dim), _precision(precision) {}
+
+        void decode(size_t start, size_t count, double* dst) const;
+
+        RC getCord(size_t index, double& val) const override;
+        RC setCord(size_t index, double val) override;
+        RC scale(double multiplier) override;
+        RC inc(IVector const* const& op) override;
+        RC dec(IVector const* const& op) override;
+
+        size_t getDim() const override;
+        PRECISION getPrecision() const override;
+        double norm(NORM n) const override;
+
+        IVector* clone() const override;
+
+        RC applyFunction(const std::function<double(double)>& fun) override;
+        RC foreach(const std::function<void(double)>& fun) const override;
+
+        double const* getData() const override;
+        RC setData(size_t dim, double const* const& ptr_data) override;
+
+        size_t sizeAllocated() const override;
+
+        ~CompactVectorImpl() override = default;
+
+        static void operator delete(void* ptr);
+
+    protected:
+        double* getMutableData() override;
+    };
+
+    ILogger* CompactVectorImpl::pLogger = nullptr;
+
+    // getData() results, taken round robin
+    const size_t decodedBuffersCount = 8;
+    thread_local std::vector<double> decodedBuffers[decodedBuffersCount];
+    thread_local size_t nextDecodedBuffer = 0;
+
+    uint16_t toBFloat16(float val)
+    {
+        uint32_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        // Round to nearest even, overflow of the mantissa carries into exponent up to Inf
+        bits += 0x7FFF + ((bits >> 16) & 1);
+        return (uint16_t)(bits >> 16);
+    }
+
+    float fromBFloat16(uint16_t val)
+    {
+        const uint32_t bits = (uint32_t)val << 16;
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+}
+
+void CompactVectorImpl::operator delete(void* ptr)
+{
+    VectorAllocator::deallocate(ptr);
+}
+
+RC CompactVectorImpl::setLogger(ILogger* const logger)
+{
+    if (!logger)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    pLogger = logger;
+    return RC::SUCCESS;
+}
+
+void CompactVectorImpl::log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line)
+{
+    if (pLogger != nullptr)
+        pLogger->log(code, level, srcfile, function, line);
+}
+
+size_t CompactVectorImpl::elementSize(PRECISION precision)
+{
+    return precision == PRECISION::BFLOAT16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+void CompactVectorImpl::encode(double const* src, size_t count, PRECISION precision, void* dst)
+{
+    if (precision == PRECISION::BFLOAT16)
+    {
+        auto* out = static_cast<uint16_t*>(dst);
+        for (size_t i = 0; i < count; i++)
+            out[i] = toBFloat16((float)src[i]);
+
+        return;
+    }
+
+    auto* out = static_cast<float*>(dst);
+    for (size_t i = 0; i < count; i++)
+        out[i] = (float)src[i];
+}
+
+void CompactVectorImpl::decode(void const* src, size_t count, PRECISION precision, double* dst)
+{
+    if (precision == PRECISION::BFLOAT16)
+    {
+        auto const* in = static_cast<uint16_t const*>(src);
+        for (size_t i = 0; i < count; i++)
+            dst[i] = fromBFloat16(in[i]);
+
+        return;
+    }
+
+    auto const* in = static_cast<float const*>(src);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = in[i];
+}
+
+void CompactVectorImpl::decode(size_t start, size_t count, double* dst) const
+{
+    decode((uint8_t const*)storage() + start * elementSize(_precision), count, _precision, dst);
+}
+
+RC CompactVectorImpl::encodeChecked(double const* src)
+{
+    uint8_t encoded[blockSize * sizeof(float)];
+    double check[blockSize];
+
+    // Valid doubles may still be too large for float, so every block is encoded and decoded back first
+    for (size_t start = 0; start < _dim; start += blockSize)
+    {
+        const size_t count = std::min(blockSize, _dim - start);
+        encode(src + start, count, _precision, encoded);
+        decode(encoded, count, _precision, check);
+        if (!VectorKernels::isFinite(check, count))
+            return RC::INFINITY_OVERFLOW;
+    }
+
+    encode(src, _dim, _precision, storage());
+    return RC::SUCCESS;
+}
+
+RC CompactVectorImpl::getCord(size_t index, double& val) const
+{
+    if (index >= _dim)
+    {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    decode(index, 1, &val);
+    return RC::SUCCESS;
+}
+
+RC CompactVectorImpl::setCord(size_t index, double val)
+{
+    if (index >= _dim)
+    {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    double rounded = 0;
+    uint8_t encoded[sizeof(float)];
+    encode(&val, 1, _precision, encoded);
+    decode(encoded, 1, _precision, &rounded);
+
+    if (!ValidChecker::isValidNumber(rounded))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    encode(&val, 1, _precision, (uint8_t*)storage() + index * elementSize(_precision));
+    return RC::SUCCESS;
+}
+
+RC CompactVectorImpl::scale(double multiplier)
+{
+    if (!ValidChecker::isValidNumber(multiplier))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    return applyFunction([multiplier](double val) { return multiplier * val; });
+}
+
+RC CompactVectorImpl::inc(IVector const* const& op)
+{
+    if (!op || op->getDim() != _dim)
+    {
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return op ? RC::MISMATCHING_DIMENSIONS : RC::NULLPTR_ERROR;
+    }
+
+    VectorKernels::Scratch scratch(_dim);
+    double* result = scratch.data();
+    decode(0, _dim, result);
+
+    double const* opData = op->getData();
+    for (size_t i = 0; i < _dim; i++)
+        result[i] += opData[i];
+
+    RC rc = VectorKernels::isFinite(result, _dim) ? encodeChecked(result) : RC::INFINITY_OVERFLOW;
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC CompactVectorImpl::dec(IVector const* const& op)
+{
+    if (!op || op->getDim() != _dim)
+    {
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return op ? RC::MISMATCHING_DIMENSIONS : RC::NULLPTR_ERROR;
+    }
+
+    VectorKernels::Scratch scratch(_dim);
+    double* result = scratch.data();
+    decode(0, _dim, result);
+
+    double const* opData = op->getData();
+    for (size_t i = 0; i < _dim; i++)
+        result[i] -= opData[i];
+
+    RC rc = VectorKernels::isFinite(result, _dim) ? encodeChecked(result) : RC::INFINITY_OVERFLOW;
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+size_t CompactVectorImpl::getDim() const
+{
+    return _dim;
+}
+
+IVector::PRECISION CompactVectorImpl::getPrecision() const
+{
+    return _precision;
+}
+
+double CompactVectorImpl::norm(NORM n) const
+{
+    if (n == NORM::AMOUNT)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double block[blockSize];
+    double result = 0;
+
+    // Memory traffic is that of the compact coordinates, sums are kept in double
+    for (size_t start = 0; start < _dim; start += blockSize)
+    {
+        const size_t count = std::min(blockSize, _dim - start);
+        decode(start, count, block);
+
+        switch (n)
+        {
+            case NORM::FIRST:
+                result += VectorKernels::sumAbs(block, count);
+                break;
+            case NORM::SECOND:
+                result += VectorKernels::sumSquares(block, count);
+                break;
+            default:
+                result = std::max(result, VectorKernels::maxAbs(block, count));
+        }
+    }
+
+    if (n == NORM::SECOND)
+        result = sqrt(result);
+
+    if (!ValidChecker::isValidNumber(result))
+    {
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return result;
+}
+
+IVector* CompactVectorImpl::clone() const
+{
+    const size_t size = sizeAllocated();
+
+    void* pInstance = VectorAllocator::allocate(size, sizeof(CompactVectorImpl));
+    if (!pInstance)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    VectorKernels::copy(pInstance, (void const*)this, size);
+    return (IVector*)pInstance;
+}
+
+RC CompactVectorImpl::applyFunction(const std::function<double(double)>& fun)
+{
+    if (!fun)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    VectorKernels::Scratch scratch(_dim);
+    double* result = scratch.data();
+    decode(0, _dim, result);
+
+    for (size_t i = 0; i < _dim; i++)
+        result[i] = fun(result[i]);
+
+    RC rc = VectorKernels::isFinite(result, _dim) ? encodeChecked(result) : RC::INFINITY_OVERFLOW;
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC CompactVectorImpl::foreach(const std::function<void(double)>& fun) const
+{
+    if (!fun)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    double block[blockSize];
+    for (size_t start = 0; start < _dim; start += blockSize)
+    {
+        const size_t count = std::min(blockSize, _dim - start);
+        decode(start, count, block);
+
+        for (size_t i = 0; i < count; i++)
+            fun(block[i]);
+    }
+
+    return RC::SUCCESS;
+}
+
+double const* CompactVectorImpl::getData() const
+{
+    std::vector<double>& buffer = decodedBuffers[nextDecodedBuffer];
+    nextDecodedBuffer = (nextDecodedBuffer + 1) % decodedBuffersCount;
+
+    if (buffer.size() < _dim)
+        buffer.resize(_dim);
+
+    decode(0, _dim, buffer.data());
+    return buffer.data();
+}
+
+double* CompactVectorImpl::getMutableData()
+{
+    return nullptr;
+}
+
+RC CompactVectorImpl::setData(size_t dim, double const* const& ptr_data)
+{
+    if (!ptr_data || dim != _dim)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    if (!VectorKernels::isFinite(ptr_data, dim))
+    {
+        log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NOT_NUMBER;
+    }
+
+    RC rc = encodeChecked(ptr_data);
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+size_t CompactVectorImpl::sizeAllocated() const
+{
+    return sizeof(*this) + _dim * elementSize(_precision);
+}
+
+#endif //IVECTOR_COMPACTVECTORIMPL_H
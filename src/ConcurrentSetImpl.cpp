@@ -0,0 +1,533 @@
+#ifndef IVECTOR_CONCURRENTSETIMPL_H
+#define IVECTOR_CONCURRENTSETIMPL_H
+
+#include "ISetImpl.cpp"
+#include "EpochReclaimer.cpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+    /*
+    * ISet shared by many reader threads and concurrent writers.
+    *
+    * Vectors live in versions, ISetImpl instances which are never changed after they are published. Reads run
+    * on the current version without locks under EpochReclaimer::ReadGuard. Writes are serialized by a mutex:
+    * a write changes a copy of the current version (with its index) and publishes it. The old version is freed
+    * once no reader can use it, by the next write or by the first read or iterator which ends after its last reader,
+    * so memory comes back without further writes. The copy is a clone, so it shares rows and the tolerance index
+    * with the current version and a write copies only the chunks, shards and buckets it changes: its cost grows with
+    * the number of chunk pointers, not with the number of vectors. Many vectors are still cheaper to add by one insertBatch().
+    *
+    * Iterators pin their version and keep seeing it until they are deleted. Views and cursors point into storage
+    * of a version and would dangle after the next write, so getView() and rebindView() fail and getCursor() returns
+    * an empty cursor which is not valid. Iterate over an iterator or over clone() instead
+    */
+    class ConcurrentSetImpl : public ISet {
+    public:
+        // set becomes the first version, nullptr if it is
+        static ConcurrentSetImpl* create(ISetImpl* set);
+
+        size_t getDim() const override;
+        size_t getSize() const override;
+
+        ISet* clone() const override;
+        RC save(char const* const& path) const override;
+
+        RC getCopy(size_t index, IVector*& val) const override;
+        RC findFirstAndCopy(IVector const * const& pat, IVector::NORM n, double tol, IVector *& val) const override;
+
+        RC getCoords(size_t index, IVector * const& val) const override;
+        RC findFirstAndCopyCoords(IVector const * const& pat, IVector::NORM n, double tol, IVector * const& val) const override;
+
+        RC findKNearest(IVector const * const& pat, size_t k, IVector::NORM n, size_t* const& indices, double* const& distances, size_t& found) const override;
+        RC findWithin(IVector const * const& pat, double r, IVector::NORM n, size_t* const& indices, double* const& distances, size_t capacity, size_t& found) const override;
+
+        RC getView(size_t index, IVectorView *& val) const override;
+        RC rebindView(size_t index, IVectorView * const& val) const override;
+
+        RC exportRange(size_t start, size_t count, double* const& dst, size_t strideDoubles) const override;
+        RC exportRangeColumnMajor(size_t start, size_t count, double* const& dst, size_t ldDoubles) const override;
+        RC exportIndices(size_t const* const& indices, size_t count, double* const& dst, size_t strideDoubles) const override;
+
+        RC insert(IVector const * const& val, IVector::NORM n, double tol) override;
+        RC insertBatch(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol, size_t& accepted) override;
+
+        RC remove(size_t index) override;
+        RC remove(IVector const * const& pat, IVector::NORM n, double tol) override;
+
+        RC setIndex(INDEX index) override;
+        RC setLshParams(LshParams const& params) override;
+
+        RC compact() override;
+        RC setCompactionThreshold(double deadFraction) override;
+
+        ScanStats getScanStats() const override;
+        void resetScanStats() override;
+
+        Cursor getCursor() const override;
+
+        IIterator *getIterator(size_t index) const override;
+        IIterator *getBegin() const override;
+        IIterator *getEnd() const override;
+
+        ~ConcurrentSetImpl() override;
+
+    private:
+        struct Version {
+            ISetImpl* set;
+            // Iterators using the version
+            std::atomic<size_t> pins{0};
+            // Epoch of retirement, valid only in _retired
+            uint64_t epoch = 0;
+        };
+
+        /*
+        * Iterator of a pinned version, the version is not freed while the iterator lives
+        */
+        class PinnedIterator : public IIterator {
+        public:
+            // Takes iterator and one pin of version
+            PinnedIterator(ConcurrentSetImpl const* owner, Version* version, IIterator* iterator) :
+                _owner(owner), _version(version), _iterator(iterator) {}
+
+            IIterator * getNext(size_t indexInc = 1) const override;
+            IIterator * getPrevious(size_t indexInc = 1) const override;
+            IIterator * clone() const override;
+
+            RC next(size_t indexInc = 1) override { return _iterator->next(indexInc); }
+            RC previous(size_t indexInc = 1) override { return _iterator->previous(indexInc); }
+
+            bool isValid() const override { return _iterator->isValid(); }
+
+            RC makeBegin() override { return _iterator->makeBegin(); }
+            RC makeEnd() override { return _iterator->makeEnd(); }
+
+            RC getVectorCopy(IVector *& val) const override { return _iterator->getVectorCopy(val); }
+            RC getVectorCoords(IVector * const& val) const override { return _iterator->getVectorCoords(val); }
+
+            ~PinnedIterator() override;
+
+        private:
+            ConcurrentSetImpl const* _owner;
+            Version* _version;
+            IIterator* _iterator;
+
+            IIterator* wrap(IIterator* iterator) const;
+        };
+
+        /*
+        * Declared before a ReadGuard, so that retired versions are freed right after the guard is released:
+        * otherwise versions retired by a burst of writes would stay until the next write
+        */
+        class ReclaimAfterRead {
+        public:
+            explicit ReclaimAfterRead(ConcurrentSetImpl const* set) : _set(set) {}
+            ~ReclaimAfterRead() { _set->reclaim(); }
+
+        private:
+            ConcurrentSetImpl const* _set;
+        };
+
+        std::atomic<Version*> _current;
+        // Serializes writers, guards _retired and _freedStats. Readers free retired versions too, see reclaim()
+        mutable std::mutex _mutex;
+        mutable std::vector<Version*> _retired;
+        // _retired.size(), so that readers check it without the lock
+        mutable std::atomic<size_t> _retiredCount{0};
+        // Lookups done by versions which are already freed
+        mutable ScanStats _freedStats{0, 0, 0, 0, 0};
+
+        explicit ConcurrentSetImpl(Version* version) : _current(version) {}
+
+        static Version* makeVersion(ISetImpl* set);
+        static void addStats(ScanStats& total, ISetImpl const* set);
+
+        // Version pinned for an iterator, caller holds a ReadGuard
+        Version* pinCurrent() const;
+        IIterator* pinIterator(IIterator* (*make)(ISetImpl const*, size_t), size_t index) const;
+
+        /*
+        * Applies change to a copy of the current version and publishes the copy if change returns SUCCESS.
+        * Caller holds _mutex
+        */
+        template <class F>
+        RC write(F&& change);
+        void publish(Version* version);
+        // Caller holds _mutex
+        void freeRetired() const;
+        // Frees retired versions nobody reads, skipped while a writer holds _mutex (its publish() frees them)
+        void reclaim() const;
+    };
+
+    ConcurrentSetImpl::Version* ConcurrentSetImpl::makeVersion(ISetImpl* set) {
+        if (!set)
+            return nullptr;
+
+        auto* version = new (std::nothrow) Version;
+        if (!version)
+        {
+            ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            delete set;
+            return nullptr;
+        }
+
+        version->set = set;
+        return version;
+    }
+
+    ConcurrentSetImpl* ConcurrentSetImpl::create(ISetImpl* set) {
+        Version* version = makeVersion(set);
+        if (!version)
+            return nullptr;
+
+        auto* concurrentSet = new (std::nothrow) ConcurrentSetImpl(version);
+        if (!concurrentSet)
+        {
+            ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            delete version->set;
+            delete version;
+        }
+
+        return concurrentSet;
+    }
+
+    size_t ConcurrentSetImpl::getDim() const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->getDim();
+    }
+
+    size_t ConcurrentSetImpl::getSize() const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->getSize();
+    }
+
+    ISet *ConcurrentSetImpl::clone() const {
+        ISetImpl* copy;
+        {
+            ReclaimAfterRead reclaim(this);
+            EpochReclaimer::ReadGuard guard;
+            copy = dynamic_cast<ISetImpl*>(_current.load()->set->clone());
+        }
+
+        return create(copy);
+    }
+
+    RC ConcurrentSetImpl::save(char const* const& path) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->save(path);
+    }
+
+    RC ConcurrentSetImpl::getCopy(size_t index, IVector *&val) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->getCopy(index, val);
+    }
+
+    RC ConcurrentSetImpl::findFirstAndCopy(IVector const * const& pat, IVector::NORM n, double tol, IVector *& val) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->findFirstAndCopy(pat, n, tol, val);
+    }
+
+    RC ConcurrentSetImpl::getCoords(size_t index, IVector * const& val) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->getCoords(index, val);
+    }
+
+    RC ConcurrentSetImpl::findFirstAndCopyCoords(IVector const * const& pat, IVector::NORM n, double tol, IVector * const& val) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->findFirstAndCopyCoords(pat, n, tol, val);
+    }
+
+    RC ConcurrentSetImpl::findKNearest(IVector const * const& pat, size_t k, IVector::NORM n, size_t* const& indices, double* const& distances, size_t& found) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->findKNearest(pat, k, n, indices, distances, found);
+    }
+
+    RC ConcurrentSetImpl::findWithin(IVector const * const& pat, double r, IVector::NORM n, size_t* const& indices, double* const& distances, size_t capacity, size_t& found) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->findWithin(pat, r, n, indices, distances, capacity, found);
+    }
+
+    RC ConcurrentSetImpl::getView(size_t, IVectorView *&) const {
+        ISetImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    RC ConcurrentSetImpl::rebindView(size_t, IVectorView * const&) const {
+        ISetImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    RC ConcurrentSetImpl::exportRange(size_t start, size_t count, double* const& dst, size_t strideDoubles) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->exportRange(start, count, dst, strideDoubles);
+    }
+
+    RC ConcurrentSetImpl::exportRangeColumnMajor(size_t start, size_t count, double* const& dst, size_t ldDoubles) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->exportRangeColumnMajor(start, count, dst, ldDoubles);
+    }
+
+    RC ConcurrentSetImpl::exportIndices(size_t const* const& indices, size_t count, double* const& dst, size_t strideDoubles) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        return _current.load()->set->exportIndices(indices, count, dst, strideDoubles);
+    }
+
+    template <class F>
+    RC ConcurrentSetImpl::write(F&& change) {
+        Version* version = makeVersion(dynamic_cast<ISetImpl*>(_current.load()->set->clone()));
+        if (!version)
+            return RC::ALLOCATION_ERROR;
+
+        bool changed = true;
+        const RC code = change(version->set, changed);
+        if (code != RC::SUCCESS || !changed)
+        {
+            delete version->set;
+            delete version;
+            return code;
+        }
+
+        publish(version);
+        return RC::SUCCESS;
+    }
+
+    void ConcurrentSetImpl::publish(Version* version) {
+        Version* old = _current.exchange(version);
+        old->epoch = EpochReclaimer::retire();
+        _retired.push_back(old);
+        freeRetired();
+    }
+
+    void ConcurrentSetImpl::reclaim() const {
+        if (_retiredCount.load(std::memory_order_relaxed) == 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if (lock.owns_lock())
+            freeRetired();
+    }
+
+    void ConcurrentSetImpl::freeRetired() const {
+        auto kept = _retired.begin();
+        for (Version* version : _retired)
+        {
+            if (version->pins.load(std::memory_order_acquire) == 0 && EpochReclaimer::isQuiescent(version->epoch))
+            {
+                addStats(_freedStats, version->set);
+                delete version->set;
+                delete version;
+            }
+            else
+                *kept++ = version;
+        }
+
+        _retired.erase(kept, _retired.end());
+        _retiredCount.store(_retired.size(), std::memory_order_relaxed);
+    }
+
+    RC ConcurrentSetImpl::insert(IVector const * const& val, IVector::NORM n, double tol) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Vector which is already there doesn't need a new version
+        ISetImpl const* set = _current.load()->set;
+        if (val && set->getSize() != 0 && val->getDim() == set->getDim() && n != IVector::NORM::AMOUNT)
+        {
+            ScanStats stats{0, 0, 0, 0, 0};
+            const bool found = set->containsRow(val->getData(), n, tol, stats);
+            set->addScanStats(stats);
+            if (found)
+                return RC::SUCCESS;
+        }
+
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->insert(val, n, tol);
+        });
+    }
+
+    RC ConcurrentSetImpl::insertBatch(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol, size_t& accepted) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        accepted = 0;
+        return write([&](ISetImpl* copy, bool& changed) {
+            const RC code = copy->insertBatch(dim, rows, count, n, tol, accepted);
+            changed = accepted != 0;
+            return code;
+        });
+    }
+
+    RC ConcurrentSetImpl::remove(size_t index) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->remove(index);
+        });
+    }
+
+    RC ConcurrentSetImpl::remove(IVector const * const& pat, IVector::NORM n, double tol) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->remove(pat, n, tol);
+        });
+    }
+
+    RC ConcurrentSetImpl::setIndex(INDEX index) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->setIndex(index);
+        });
+    }
+
+    RC ConcurrentSetImpl::setLshParams(LshParams const& params) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->setLshParams(params);
+        });
+    }
+
+    RC ConcurrentSetImpl::compact() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->compact();
+        });
+    }
+
+    RC ConcurrentSetImpl::setCompactionThreshold(double deadFraction) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return write([&](ISetImpl* copy, bool&) {
+            return copy->setCompactionThreshold(deadFraction);
+        });
+    }
+
+    void ConcurrentSetImpl::addStats(ScanStats& total, ISetImpl const* set) {
+        const ScanStats stats = set->getScanStats();
+        total.lookups += stats.lookups;
+        total.rowsVisited += stats.rowsVisited;
+        total.sampledLookups += stats.sampledLookups;
+        total.exactFound += stats.exactFound;
+        total.approxFound += stats.approxFound;
+    }
+
+    ISet::ScanStats ConcurrentSetImpl::getScanStats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ScanStats total = _freedStats;
+        for (Version const* version : _retired)
+            addStats(total, version->set);
+
+        addStats(total, _current.load()->set);
+        return total;
+    }
+
+    void ConcurrentSetImpl::resetScanStats() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _freedStats = ScanStats{0, 0, 0, 0, 0};
+        for (Version* version : _retired)
+            version->set->resetScanStats();
+
+        _current.load()->set->resetScanStats();
+    }
+
+    ISet::Cursor ConcurrentSetImpl::getCursor() const {
+        // A cursor can't pin a version, the one it would point into may be freed by the next write
+        ISetImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return Cursor();
+    }
+
+    ConcurrentSetImpl::Version* ConcurrentSetImpl::pinCurrent() const {
+        Version* version = _current.load();
+        version->pins.fetch_add(1, std::memory_order_relaxed);
+        return version;
+    }
+
+    ISet::IIterator* ConcurrentSetImpl::pinIterator(IIterator* (*make)(ISetImpl const*, size_t), size_t index) const {
+        ReclaimAfterRead reclaim(this);
+        EpochReclaimer::ReadGuard guard;
+        Version* version = pinCurrent();
+        IIterator* iterator = make(version->set, index);
+        auto* pinned = iterator ? new (std::nothrow) PinnedIterator(this, version, iterator) : nullptr;
+        if (!pinned)
+        {
+            if (iterator)
+                ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+            delete iterator;
+            version->pins.fetch_sub(1, std::memory_order_release);
+        }
+
+        return pinned;
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::getIterator(size_t index) const {
+        return pinIterator([](ISetImpl const* set, size_t index) { return set->getIterator(index); }, index);
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::getBegin() const {
+        return pinIterator([](ISetImpl const* set, size_t) { return set->getBegin(); }, 0);
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::getEnd() const {
+        return pinIterator([](ISetImpl const* set, size_t) { return set->getEnd(); }, 0);
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::PinnedIterator::wrap(IIterator* iterator) const {
+        if (!iterator)
+            return nullptr;
+
+        auto* pinned = new (std::nothrow) PinnedIterator(_owner, _version, iterator);
+        if (!pinned)
+        {
+            ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            delete iterator;
+            return nullptr;
+        }
+
+        // This iterator keeps the version alive, so the new pin is safe without a guard
+        _version->pins.fetch_add(1, std::memory_order_relaxed);
+        return pinned;
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::PinnedIterator::getNext(size_t indexInc) const {
+        return wrap(_iterator->getNext(indexInc));
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::PinnedIterator::getPrevious(size_t indexInc) const {
+        return wrap(_iterator->getPrevious(indexInc));
+    }
+
+    ISet::IIterator *ConcurrentSetImpl::PinnedIterator::clone() const {
+        return wrap(_iterator->clone());
+    }
+
+    ConcurrentSetImpl::PinnedIterator::~PinnedIterator() {
+        delete _iterator;
+        _version->pins.fetch_sub(1, std::memory_order_release);
+        _owner->reclaim();
+    }
+
+    // Nothing may use the set now, so every version goes without waiting for readers
+    ConcurrentSetImpl::~ConcurrentSetImpl() {
+        for (Version* version : _retired)
+        {
+            delete version->set;
+            delete version;
+        }
+
+        Version* version = _current.load();
+        delete version->set;
+        delete version;
+    }
+}
+
+#endif //IVECTOR_CONCURRENTSETIMPL_H
@@ -0,0 +1,337 @@
+#ifndef IVECTOR_COWCHUNKS_H
+#define IVECTOR_COWCHUNKS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    // True if ptr is the only owner. Writes through ptr then can't race with reads by former owners on other threads
+    template <class T>
+    bool isExclusive(std::shared_ptr<T> const& ptr)
+    {
+        if (ptr.use_count() != 1)
+            return false;
+
+        // Pairs with the release of the last other owner, its reads happen before the caller's writes
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    /*
+    * Array of slots, width elements each, stored in chunks of a power of two slots.
+    *
+    * Chunks are reference counted, so a copy of the array shares all of them and costs a pointer per chunk.
+    * A chunk is copied the first time an array writes to it while another array shares it: copies of one array
+    * together take as much memory as the array plus the chunks written since they were made.
+    * Slots of a chunk are contiguous, runLength() tells how many of them follow a slot.
+    * Copies may be used on different threads, each copy by one writer at a time
+    */
+    template <class T>
+    class CowChunks {
+    public:
+        // Chunks are as large as fits in chunkBytes, but at least one slot
+        static constexpr size_t chunkBytes = size_t(1) << 14;
+
+        explicit CowChunks(size_t width = 1)
+        {
+            setWidth(width);
+        }
+
+        // Only while there are no chunks
+        void setWidth(size_t width)
+        {
+            _width = width;
+            _shift = 0;
+            while ((size_t(2) << _shift) * std::max<size_t>(width, 1) * sizeof(T) <= chunkBytes)
+                _shift++;
+        }
+
+        size_t getWidth() const { return _width; }
+        size_t size() const { return _size; }
+        size_t capacity() const { return _chunks.size() << _shift; }
+
+        T const* at(size_t slot) const { return _bases[slot >> _shift] + (slot & mask()) * _width; }
+        T const& operator[](size_t slot) const { return *at(slot); }
+
+        // nullptr if the chunk is shared and there is no memory for a copy
+        T* mutableAt(size_t slot)
+        {
+            return unshareChunk(slot >> _shift) ? _chunks[slot >> _shift].get() + (slot & mask()) * _width : nullptr;
+        }
+
+        // Slots from slot to the end of its chunk
+        size_t runLength(size_t slot) const { return (size_t(1) << _shift) - (slot & mask()); }
+
+        // First slot of every chunk, for cursors: slot s is at table()[s >> shift()] + (s & (2^shift() - 1)) * width
+        T const* const* table() const { return _bases.data(); }
+        size_t shift() const { return _shift; }
+
+        /*
+        * Makes room for count slots and copies shared chunks of slots [size(), count), so writes there can't fail.
+        * False if there is no memory, slots stay unchanged then
+        */
+        bool reserve(size_t count)
+        {
+            const size_t chunks = _chunks.size();
+            try
+            {
+                while (capacity() < count)
+                {
+                    std::shared_ptr<T> chunk = allocate();
+                    if (!chunk)
+                        throw std::bad_alloc();
+
+                    _chunks.push_back(chunk);
+                    _bases.push_back(chunk.get());
+                }
+            }
+            catch (std::bad_alloc const&)
+            {
+                _chunks.resize(chunks);
+                _bases.resize(chunks);
+                return false;
+            }
+
+            return unshare(_size, count);
+        }
+
+        // Shrinking drops chunks past count, new slots (up to capacity()) are not initialized
+        void resize(size_t count)
+        {
+            const size_t chunks = (count + mask()) >> _shift;
+            if (count < _size && chunks < _chunks.size())
+            {
+                _chunks.resize(chunks);
+                _bases.resize(chunks);
+            }
+
+            _size = count;
+        }
+
+        // Copies shared chunks of slots [begin, end), false if there is no memory for some of them
+        bool unshare(size_t begin, size_t end)
+        {
+            if (begin >= end)
+                return true;
+
+            for (size_t chunk = begin >> _shift; chunk <= (end - 1) >> _shift; chunk++)
+            {
+                if (!unshareChunk(chunk))
+                    return false;
+            }
+
+            return true;
+        }
+
+        /*
+        * count slots starting at data, full chunks point into data and keep owner alive, the last partial chunk
+        * is copied so that slots can be added after it. False if there is no memory, array is empty then
+        */
+        bool alias(std::shared_ptr<void> const& owner, T* data, size_t count)
+        {
+            clear();
+            const size_t chunkSlots = size_t(1) << _shift;
+            const size_t full = count >> _shift;
+            try
+            {
+                for (size_t chunk = 0; chunk < full; chunk++)
+                {
+                    _chunks.push_back(std::shared_ptr<T>(owner, data + chunk * chunkSlots * _width));
+                    _bases.push_back(_chunks.back().get());
+                }
+            }
+            catch (std::bad_alloc const&)
+            {
+                clear();
+                return false;
+            }
+
+            _size = full * chunkSlots;
+            if (!reserve(count))
+            {
+                clear();
+                return false;
+            }
+
+            if (count != _size)
+                memcpy(_chunks.back().get(), data + _size * _width, (count - _size) * _width * sizeof(T));
+
+            _size = count;
+            return true;
+        }
+
+        void clear()
+        {
+            _chunks.clear();
+            _bases.clear();
+            _size = 0;
+        }
+
+    private:
+        size_t _width = 1;
+        size_t _shift = 0;
+        size_t _size = 0;
+        std::vector<std::shared_ptr<T>> _chunks;
+        // _chunks[i].get(), so that slots are found without touching reference counts
+        std::vector<T const*> _bases;
+
+        size_t mask() const { return (size_t(1) << _shift) - 1; }
+
+        std::shared_ptr<T> allocate() const
+        {
+            T* data = new (std::nothrow) T[(size_t(1) << _shift) * _width];
+            if (!data)
+                return nullptr;
+
+            // On failure shared_ptr deletes data itself
+            try
+            {
+                return std::shared_ptr<T>(data, std::default_delete<T[]>());
+            }
+            catch (std::bad_alloc const&)
+            {
+                return nullptr;
+            }
+        }
+
+        bool unshareChunk(size_t chunk)
+        {
+            if (isExclusive(_chunks[chunk]))
+                return true;
+
+            std::shared_ptr<T> copy = allocate();
+            if (!copy)
+                return false;
+
+            // Slots past size() were never written by this array
+            const size_t first = chunk << _shift;
+            const size_t used = _size > first ? std::min(_size - first, size_t(1) << _shift) : 0;
+            memcpy(copy.get(), _chunks[chunk].get(), used * _width * sizeof(T));
+            _chunks[chunk] = std::move(copy);
+            _bases[chunk] = _chunks[chunk].get();
+            return true;
+        }
+    };
+
+    /*
+    * Hash map from keys to buckets of slots with the same sharing as CowChunks.
+    *
+    * Keys are spread over shards by hash, a shard maps keys to reference counted buckets. A copy of the map
+    * shares all shards and costs a pointer per shard. The first write to a shared shard copies the shard
+    * (pointers to its buckets), the first write to a shared bucket copies the bucket, so copies take as much
+    * extra memory as the shards and buckets changed since they were made. Shards are kept at about shardKeys
+    * keys by doubling their number. Allocation failures throw std::bad_alloc, the map stays valid then
+    */
+    template <class Key, class Hash>
+    class CowBuckets {
+    public:
+        static constexpr size_t shardKeys = 64;
+
+        // nullptr if there is no bucket for key
+        std::vector<size_t> const* find(Key const& key) const
+        {
+            Shard const& shard = *_shards[shardOf(key)];
+            auto it = shard.find(key);
+            return it != shard.end() ? it->second.get() : nullptr;
+        }
+
+        void add(Key const& key, size_t slot)
+        {
+            if (_keys >= _shards.size() * shardKeys)
+                grow();
+
+            Shard& shard = mutableShard(shardOf(key));
+            auto it = shard.find(key);
+            if (it == shard.end())
+            {
+                auto bucket = std::make_shared<std::vector<size_t>>(1, slot);
+                shard.emplace(key, std::move(bucket));
+                _keys++;
+                return;
+            }
+
+            mutableBucket(it->second).push_back(slot);
+        }
+
+        void remove(Key const& key, size_t slot)
+        {
+            const size_t index = shardOf(key);
+            if (_shards[index]->find(key) == _shards[index]->end())
+                return;
+
+            Shard& shard = mutableShard(index);
+            auto it = shard.find(key);
+            if (it->second->size() == 1 && (*it->second)[0] == slot)
+            {
+                shard.erase(it);
+                _keys--;
+                return;
+            }
+
+            std::vector<size_t>& slots = mutableBucket(it->second);
+            slots.erase(std::remove(slots.begin(), slots.end(), slot), slots.end());
+        }
+
+    private:
+        typedef std::unordered_map<Key, std::shared_ptr<std::vector<size_t>>, Hash> Shard;
+
+        std::vector<std::shared_ptr<Shard>> _shards = std::vector<std::shared_ptr<Shard>>(1, std::make_shared<Shard>());
+        // Number of shards is 2^_shardBits
+        size_t _shardBits = 0;
+        size_t _keys = 0;
+
+        size_t shardOf(Key const& key) const
+        {
+            return shardOf(key, _shardBits);
+        }
+
+        // Top bits of the mixed hash, so keys of one shard still differ in the bits its map uses
+        static size_t shardOf(Key const& key, size_t bits)
+        {
+            const uint64_t mixed = (uint64_t)Hash()(key) * 0x9E3779B97F4A7C15ULL;
+            return bits == 0 ? 0 : (size_t)(mixed >> (64 - bits));
+        }
+
+        Shard& mutableShard(size_t index)
+        {
+            if (!isExclusive(_shards[index]))
+                _shards[index] = std::make_shared<Shard>(*_shards[index]);
+
+            return *_shards[index];
+        }
+
+        static std::vector<size_t>& mutableBucket(std::shared_ptr<std::vector<size_t>>& bucket)
+        {
+            if (!isExclusive(bucket))
+                bucket = std::make_shared<std::vector<size_t>>(*bucket);
+
+            return *bucket;
+        }
+
+        // Buckets stay shared, only shards are built again
+        void grow()
+        {
+            std::vector<std::shared_ptr<Shard>> shards(_shards.size() * 2);
+            for (auto& shard : shards)
+                shard = std::make_shared<Shard>();
+
+            for (auto const& shard : _shards)
+            {
+                for (auto const& entry : *shard)
+                    shards[shardOf(entry.first, _shardBits + 1)]->emplace(entry.first, entry.second);
+            }
+
+            _shards = std::move(shards);
+            _shardBits++;
+        }
+    };
+}
+
+#endif //IVECTOR_COWCHUNKS_H
@@ -0,0 +1,116 @@
+#ifndef IVECTOR_EPOCHRECLAIMER_H
+#define IVECTOR_EPOCHRECLAIMER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace {
+    /*
+    * Epoch based reclamation of data read without locks.
+    *
+    * Reader holds a ReadGuard while it uses shared pointers, the guard publishes the global epoch in a slot of
+    * its thread. Writer unlinks an object first, then retire() advances the epoch and returns the epoch the object
+    * belongs to. The object may be freed once isQuiescent(epoch) is true: every reader which could have seen it
+    * has left its guard by then. Guards nest, and cost two atomic stores and one load on the reader side
+    */
+    class EpochReclaimer {
+    public:
+        class ReadGuard {
+        public:
+            ReadGuard()
+            {
+                Owner& owner = localOwner();
+                if (owner.depth++ == 0)
+                    owner.slot->epoch.store(globalEpoch().load());
+            }
+
+            ~ReadGuard()
+            {
+                Owner& owner = localOwner();
+                if (--owner.depth == 0)
+                    owner.slot->epoch.store(0, std::memory_order_release);
+            }
+
+        private:
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+        };
+
+        // Call after the object is unlinked, it is not reachable by new readers
+        static uint64_t retire()
+        {
+            return globalEpoch().fetch_add(1);
+        }
+
+        static bool isQuiescent(uint64_t epoch)
+        {
+            for (Slot* slot = slots().load(); slot; slot = slot->next)
+            {
+                const uint64_t seen = slot->epoch.load();
+                if (seen != 0 && seen <= epoch)
+                    return false;
+            }
+
+            return true;
+        }
+
+    private:
+        // Slots are never freed, a slot of a finished thread is taken by the next new one
+        struct Slot {
+            // 0 while the owner is outside of guards
+            std::atomic<uint64_t> epoch{0};
+            std::atomic<bool> owned{true};
+            Slot* next = nullptr;
+        };
+
+        struct Owner {
+            Slot* slot = acquireSlot();
+            size_t depth = 0;
+
+            ~Owner()
+            {
+                slot->owned.store(false, std::memory_order_release);
+            }
+        };
+
+        // Starts from 1, 0 marks idle slots
+        static std::atomic<uint64_t>& globalEpoch()
+        {
+            static std::atomic<uint64_t> epoch{1};
+            return epoch;
+        }
+
+        static std::atomic<Slot*>& slots()
+        {
+            static std::atomic<Slot*> head{nullptr};
+            return head;
+        }
+
+        static Owner& localOwner()
+        {
+            thread_local Owner owner;
+            return owner;
+        }
+
+        static Slot* acquireSlot()
+        {
+            for (Slot* slot = slots().load(); slot; slot = slot->next)
+            {
+                bool owned = false;
+                if (!slot->owned.load(std::memory_order_relaxed) && slot->owned.compare_exchange_strong(owned, true))
+                    return slot;
+            }
+
+            auto* slot = new Slot;
+            slot->next = slots().load();
+            while (!slots().compare_exchange_weak(slot->next, slot))
+                ;
+
+            return slot;
+        }
+    };
+}
+
+#endif //IVECTOR_EPOCHRECLAIMER_H
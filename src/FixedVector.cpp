@@ -0,0 +1,21 @@
+#include "../include/FixedVector.h"
+
+ILogger* FixedVectorBase::pLogger = nullptr;
+
+RC FixedVectorBase::setLogger(ILogger* const logger)
+{
+    if (!logger)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    pLogger = logger;
+    return RC::SUCCESS;
+}
+
+void FixedVectorBase::log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line)
+{
+    if (pLogger != nullptr)
+        pLogger->log(code, level, srcfile, function, line);
+}
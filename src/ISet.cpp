@@ -1,5 +1,9 @@
 #include "../include/ISet.h"
 #include "../src/ISetImpl.cpp"
+#include "ConcurrentSetImpl.cpp"
+#include "VectorLoader.cpp"
+#include "WorkerPool.cpp"
+#include <chrono>
 
 RC ISet::setLogger(ILogger* const logger)
 {
@@ -10,253 +14,374 @@ ISet *ISet::createSet() {
     return new(std::nothrow)ISetImpl();
 }
 
-ISet *ISet::makeIntersection(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
-    if (!op1 || !op2 || n == IVector::NORM::AMOUNT || tol < 0 || op1->getSize() == 0 || op2->getSize() == 0 ||
-        op1->getDim() != op2->getDim())
-        return nullptr;
+ISet *ISet::openMapped(char const* const& path) {
+    return ISetImpl::openMapped(path);
+}
 
-    IVector* vectorForInsert = IVector::createVector(op1->getDim(), new double[op1->getDim()]);
-    ISet* intersectionSet = ISet::createSet();
-    if (!intersectionSet)
-        return nullptr;
+ISet *ISet::createConcurrentSet() {
+    return ConcurrentSetImpl::create(new(std::nothrow)ISetImpl());
+}
+
+RC ISet::load(char const* const& path, FILE_FORMAT format, size_t dim, IVector::NORM n, double tol, LoadStats& stats)
+{
+    stats = LoadStats{0, 0, 0, 0, 0};
+    if (!path)
+    {
+        ISetImpl::log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
 
-    ISet::IIterator* itOp1 = op1->getBegin();
-    bool isEnd = false;
+    if (dim == 0 || (format != FILE_FORMAT::CSV && format != FILE_FORMAT::BINARY))
+    {
+        ISetImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
 
-    if (itOp1 != nullptr) {
-        do {
-            isEnd = itOp1->isEnd();
+    const auto start = std::chrono::steady_clock::now();
+    VectorLoader loader(format, dim);
+    RC code = loader.start(path);
 
-            itOp1->getVectorCoords(vectorForInsert);
+    VectorLoader::Batch batch;
+    while (code == RC::SUCCESS && loader.next(batch))
+    {
+        stats.rowsRead += batch.read;
+        stats.rowsRejected += batch.rejected;
 
-            IVector *vectorForCheck;
-            switch (op2->findFirstAndCopy(vectorForInsert, n, tol, vectorForCheck)) {
-                case RC::SUCCESS: {
-                    delete vectorForCheck;
-                    if (intersectionSet->insert(vectorForInsert, n, tol) != RC::SUCCESS) {
-                        return nullptr;
-                    }
-                }
-                    break;
-                case RC::VECTOR_NOT_FOUND:
-                    continue;
-                default:
-                    return nullptr;
-            }
-        } while (!isEnd);
-        delete itOp1;
-        itOp1 = nullptr;
-        return intersectionSet;
+        size_t accepted;
+        code = insertBatch(dim, batch.rows.data(), batch.rows.size() / dim, n, tol, accepted);
+        stats.rowsAccepted += accepted;
     }
 
-    return nullptr;
+    if (code == RC::SUCCESS)
+        code = loader.getResult();
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.rowsPerSecond = stats.seconds > 0 ? (double)stats.rowsRead / stats.seconds : 0;
+
+    if (code != RC::SUCCESS)
+        ISetImpl::log(code, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+    else if (stats.rowsRejected != 0)
+        ISetImpl::log(RC::NOT_NUMBER, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+
+    return code;
 }
 
-ISet *ISet::makeUnion(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
-    if (!op1 || !op2 || n == IVector::NORM::AMOUNT || tol < 0 || op1->getSize() == 0 || op2->getSize() == 0 ||
-        op1->getDim() != op2->getDim())
-        return nullptr;
+RC ISet::setThreadCount(size_t count)
+{
+    if (!WorkerPool::instance().setThreadCount(count))
+    {
+        ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::ALLOCATION_ERROR;
+    }
 
-    ILogger* pLogger = ILogger::createLogger();
-    IVector* vectorForInsert = IVector::createVector(op1->getDim(), new double[op1->getDim()]);
-    ISet* unionSet = ISet::createSet();
-    if (!unionSet)
-        return nullptr;
+    return RC::SUCCESS;
+}
 
-    ISet::IIterator* itOp1 = op1->getBegin();
-    bool isEnd = false;
+size_t ISet::getThreadCount()
+{
+    return WorkerPool::instance().getThreadCount();
+}
 
-    do {
-        isEnd = itOp1->isEnd();
+namespace {
+    /*
+     * Set algebra works on rows when operands are ISetImpl: the probed operand is read in place by a cursor,
+     * the other one answers through its tolerance index (or one built for the call if its own doesn't suit tol and n,
+     * the operand itself is never changed), results are added by one bulk call.
+     * Rows taken from a set which is already tol-separated under n are appended without lookups.
+     *
+     * Lookups run on WorkerPool: probe rows are split into parts of rowsPerPart, every part writes its own flags
+     * and stats, and results are merged in probe order, so they are the same for any number of threads
+     */
+    const size_t rowsPerPart = 4096;
+
+    RC collectRows(ISet const* const& source, std::vector<double>& rows)
+    {
+        const size_t count = source->getSize();
+        const size_t dim = source->getDim();
+        try
+        {
+            rows.resize(count * dim);
+        }
+        catch (std::bad_alloc const&)
+        {
+            ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::ALLOCATION_ERROR;
+        }
+
+        return rows.empty() ? RC::SUCCESS : source->exportRange(0, count, rows.data(), dim);
+    }
 
-        if (itOp1->getVectorCoords(vectorForInsert) != RC::SUCCESS)
-            return nullptr;
-        if (unionSet->insert(vectorForInsert, n, tol) != RC::SUCCESS)
-            return nullptr;
-    }while (!isEnd);
+    // Lookups stop early once stop is set, flags of skipped rows stay 0
+    RC findMembers(std::vector<double> const& rows, size_t dim, ISetImpl const* const& other, IVector::NORM n, double tol,
+                   std::vector<char>& member, std::atomic<bool>* stop = nullptr)
+    {
+        const size_t count = rows.size() / dim;
+        const size_t parts = (count + rowsPerPart - 1) / rowsPerPart;
+        std::vector<ISet::ScanStats> stats;
 
-    delete itOp1;
-    itOp1 = nullptr;
+        // Lookups allocate candidate lists, run() rethrows the first failure after every part has stopped
+        try
+        {
+            stats.assign(parts, ISet::ScanStats{0, 0, 0, 0, 0});
+            member.assign(count, 0);
+
+            // other may be an operand of calls on other threads, so its own index is never replaced here
+            const std::shared_ptr<ToleranceIndex const> index = other->lookupIndex(tol, n);
+            WorkerPool::instance().run(parts, [&](size_t part) {
+                const size_t end = std::min(count, (part + 1) * rowsPerPart);
+                for (size_t i = part * rowsPerPart; i < end; i++)
+                {
+                    if (stop && stop->load(std::memory_order_relaxed))
+                        return;
 
-    isEnd = false;
-    ISet::IIterator* itOp2 = op2->getBegin();
+                    member[i] = other->containsRow(rows.data() + i * dim, n, tol, index.get(), stats[part]);
+                    if (stop && !member[i])
+                        stop->store(true, std::memory_order_relaxed);
+                }
+            });
+        }
+        catch (std::bad_alloc const&)
+        {
+            ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::ALLOCATION_ERROR;
+        }
 
-    do {
-        isEnd = itOp2->isEnd();
+        ISet::ScanStats total{0, 0, 0, 0, 0};
+        for (ISet::ScanStats const& partStats : stats)
+        {
+            total.lookups += partStats.lookups;
+            total.rowsVisited += partStats.rowsVisited;
+        }
 
-        if (itOp2->getVectorCoords(vectorForInsert) != RC::SUCCESS)
-            return nullptr;
-        if (unionSet->insert(vectorForInsert, n, tol) != RC::SUCCESS)
-            return nullptr;
+        other->addScanStats(total);
+        return RC::SUCCESS;
+    }
 
-    }while (!isEnd);
+    RC collectRows(ISet const* const& probe, ISetImpl const* const& other, IVector::NORM n, double tol, bool isMember,
+                   std::vector<double>& rows)
+    {
+        const size_t dim = probe->getDim();
+        std::vector<double> probeRows;
+        std::vector<char> member;
+        RC code = collectRows(probe, probeRows);
+        if (code != RC::SUCCESS)
+            return code;
+
+        if ((code = findMembers(probeRows, dim, other, n, tol, member)) != RC::SUCCESS)
+            return code;
+
+        rows.clear();
+        try
+        {
+            for (size_t i = 0; i < member.size(); i++)
+            {
+                if ((member[i] != 0) == isMember)
+                    rows.insert(rows.end(), probeRows.data() + i * dim, probeRows.data() + (i + 1) * dim);
+            }
+        }
+        catch (std::bad_alloc const&)
+        {
+            ISetImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::ALLOCATION_ERROR;
+        }
 
-    delete itOp2;
-    itOp2 = nullptr;
+        return RC::SUCCESS;
+    }
 
-    return unionSet;
-}
+    // rows are taken from source in its order
+    RC addRows(ISetImpl* const& result, ISet const* const& source, std::vector<double> const& rows, IVector::NORM n, double tol)
+    {
+        const size_t dim = source->getDim();
+        const size_t count = rows.size() / dim;
+        auto const* sourceImpl = dynamic_cast<ISetImpl const*>(source);
 
-ISet *ISet::sub(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
-    if (!op1 || !op2 || n == IVector::NORM::AMOUNT || tol < 0 || op1->getSize() == 0 || op2->getSize() == 0 ||
-        op1->getDim() != op2->getDim())
-        return nullptr;
+        if (result->getSize() == 0 && sourceImpl && sourceImpl->isSeparated(n, tol))
+            return result->appendRows(dim, rows.data(), count, n, tol);
 
-    IVector* vectorForInsert = IVector::createVector(op1->getDim(), new double [op1->getDim()]);
-    ISet* newSet = ISet::createSet();
-    if (!newSet)
-        return nullptr;
+        size_t accepted;
+        return result->insertBatch(dim, rows.data(), count, n, tol, accepted);
+    }
 
-    ISet::IIterator* itOp1 = op1->getBegin();
-    bool isEnd = false;
+    /*
+     * Inserts into result every vector of op1 which is (isMember == true) or isn't (isMember == false) in op2.
+     * Vectors are read into one reused instance, membership is checked by fused distance, so nothing is allocated per vector
+     */
+    RC filterInto(ISet* const& result, ISet const* const& op1, ISet const* const& op2, IVector::NORM n, double tol, bool isMember)
+    {
+        auto* resultImpl = dynamic_cast<ISetImpl*>(result);
+        auto const* op2Impl = dynamic_cast<ISetImpl const*>(op2);
+        if (resultImpl && op2Impl)
+        {
+            std::vector<double> rows;
+            RC code = collectRows(op1, op2Impl, n, tol, isMember, rows);
+            return code == RC::SUCCESS ? addRows(resultImpl, op1, rows, n, tol) : code;
+        }
 
-    do {
-        isEnd = itOp1->isEnd();
-        if (itOp1->getVectorCoords(vectorForInsert) != RC::SUCCESS)
-            return nullptr;
+        IVector* vectorForInsert = nullptr;
+        IVector* vectorForCheck = nullptr;
+        RC rc = op1->getCopy(0, vectorForInsert);
+        if (rc == RC::SUCCESS)
+            rc = op1->getCopy(0, vectorForCheck);
 
-        IVector* vectorForCheck;
-        switch (op2->findFirstAndCopy(vectorForInsert, n, tol, vectorForCheck))
+        for (size_t i = 0; rc == RC::SUCCESS && i < op1->getSize(); i++)
         {
-            case RC::VECTOR_NOT_FOUND:
-            {
-                delete vectorForCheck;
-                if (newSet->insert(vectorForInsert, n, tol) != RC::SUCCESS)
-                {
-                    return nullptr;
-                }
+            if ((rc = op1->getCoords(i, vectorForInsert)) != RC::SUCCESS)
                 break;
-            }
-            case RC::SUCCESS:
-                continue;
-            default:
-                return nullptr;
 
+            rc = op2->findFirstAndCopyCoords(vectorForInsert, n, tol, vectorForCheck);
+            if (rc != RC::SUCCESS && rc != RC::VECTOR_NOT_FOUND)
+                break;
+
+            const bool found = rc == RC::SUCCESS;
+            rc = found == isMember ? result->insert(vectorForInsert, n, tol) : RC::SUCCESS;
         }
 
-    } while(!isEnd);
+        delete vectorForInsert;
+        delete vectorForCheck;
+        return rc;
+    }
 
-    return newSet;
+    RC insertAll(ISet* const& result, ISet const* const& op, IVector::NORM n, double tol)
+    {
+        auto* resultImpl = dynamic_cast<ISetImpl*>(result);
+        if (resultImpl)
+        {
+            std::vector<double> rows;
+            RC code = collectRows(op, rows);
+            return code == RC::SUCCESS ? addRows(resultImpl, op, rows, n, tol) : code;
+        }
+
+        IVector* vectorForInsert = nullptr;
+        RC rc = op->getCopy(0, vectorForInsert);
+
+        for (size_t i = 0; rc == RC::SUCCESS && i < op->getSize(); i++)
+        {
+            if ((rc = op->getCoords(i, vectorForInsert)) == RC::SUCCESS)
+                rc = result->insert(vectorForInsert, n, tol);
+        }
+
+        delete vectorForInsert;
+        return rc;
+    }
+
+    bool isValidOperands(ISet const * const& op1, ISet const * const& op2, IVector::NORM n, double tol)
+    {
+        return op1 && op2 && n != IVector::NORM::AMOUNT && tol >= 0 && op1->getSize() != 0 && op2->getSize() != 0 &&
+               op1->getDim() == op2->getDim();
+    }
 }
 
-ISet *ISet::symSub(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
-    if (!op1 || !op2 || n == IVector::NORM::AMOUNT || tol < 0 || op1->getSize() == 0 || op2->getSize() == 0 ||
-        op1->getDim() != op2->getDim())
+ISet *ISet::makeIntersection(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
+    if (!isValidOperands(op1, op2, n, tol))
         return nullptr;
 
-    ISet* symSubSet = ISet::createSet();
-    IVector* vectorForInsert = IVector::createVector(op1->getDim(), new double [op1->getDim()]);
-    IVector* vectorForCheck = IVector::createVector(op1->getDim(), new double [op1->getDim()]);
+    ISet* intersectionSet = ISet::createSet();
+    if (!intersectionSet)
+        return nullptr;
 
-    ISet::IIterator* itOp1 = op1->getBegin();
-    bool isEnd = false;
+    if (filterInto(intersectionSet, op1, op2, n, tol, true) != RC::SUCCESS)
+    {
+        delete intersectionSet;
+        return nullptr;
+    }
 
-    do {
-        isEnd = itOp1->isEnd();
-        if (itOp1->getVectorCoords(vectorForInsert) != RC::SUCCESS)
-            return nullptr;
+    return intersectionSet;
+}
 
-        switch (op2->findFirstAndCopyCoords(vectorForInsert, n, tol, vectorForCheck))
-        {
-            case RC::VECTOR_NOT_FOUND:
-            {
-                if (symSubSet->insert(vectorForInsert, n, tol) != RC::SUCCESS)
-                {
-                    return nullptr;
-                }
-                break;
-            }
-            case RC::SUCCESS:
-                continue;
-            default:
-                return nullptr;
+ISet *ISet::makeUnion(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
+    if (!isValidOperands(op1, op2, n, tol))
+        return nullptr;
 
-        }
+    ISet* unionSet = ISet::createSet();
+    if (!unionSet)
+        return nullptr;
 
-    } while (!isEnd);
+    if (insertAll(unionSet, op1, n, tol) != RC::SUCCESS || insertAll(unionSet, op2, n, tol) != RC::SUCCESS)
+    {
+        delete unionSet;
+        return nullptr;
+    }
 
-    isEnd = false;
-    ISet::IIterator* itOp2 = op2->getBegin();
+    return unionSet;
+}
 
-    do {
-        isEnd = itOp2->isEnd();
-        if (itOp2->getVectorCoords(vectorForInsert) != RC::SUCCESS)
-            return nullptr;
+ISet *ISet::sub(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
+    if (!isValidOperands(op1, op2, n, tol))
+        return nullptr;
 
-        switch (op1->findFirstAndCopyCoords(vectorForInsert, n, tol, vectorForCheck))
-        {
-            case RC::VECTOR_NOT_FOUND:
-            {
-                if (symSubSet->insert(vectorForInsert, n, tol) != RC::SUCCESS)
-                {
-                    return nullptr;
-                }
-                break;
-            }
-            case RC::SUCCESS:
-                continue;
-            default:
-                return nullptr;
+    ISet* newSet = ISet::createSet();
+    if (!newSet)
+        return nullptr;
 
-        }
+    if (filterInto(newSet, op1, op2, n, tol, false) != RC::SUCCESS)
+    {
+        delete newSet;
+        return nullptr;
+    }
 
-    } while (!isEnd);
+    return newSet;
+}
 
-    delete vectorForInsert;
-    delete vectorForCheck;
+ISet *ISet::symSub(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
+    if (!isValidOperands(op1, op2, n, tol))
+        return nullptr;
+
+    ISet* symSubSet = ISet::createSet();
+    if (!symSubSet)
+        return nullptr;
+
+    if (filterInto(symSubSet, op1, op2, n, tol, false) != RC::SUCCESS ||
+        filterInto(symSubSet, op2, op1, n, tol, false) != RC::SUCCESS)
+    {
+        delete symSubSet;
+        return nullptr;
+    }
 
     return symSubSet;
 }
 
 bool ISet::equals(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
-    if (!op1 || !op2 || n == IVector::NORM::AMOUNT || tol < 0 || op1->getSize() == 0 || op2->getSize() == 0 ||
-        op1->getDim() != op2->getDim())
+    if (!isValidOperands(op1, op2, n, tol))
         return false;
 
-    return subSet(op1, op2, n, tol) == subSet(op2, op1, n, tol);
+    return subSet(op1, op2, n, tol) && subSet(op2, op1, n, tol);
 }
 
 bool ISet::subSet(const ISet *const &op1, const ISet *const &op2, IVector::NORM n, double tol) {
-    if (!op1 || !op2 || n == IVector::NORM::AMOUNT || tol < 0 || op1->getSize() == 0 || op2->getSize() == 0 ||
-        op1->getDim() != op2->getDim())
+    if (!isValidOperands(op1, op2, n, tol))
         return false;
 
-    IVector* vectorFromSet = IVector::createVector(op1->getDim(), new double [op1->getDim()]);
-    IVector* vectorForCheck = IVector::createVector(op1->getDim(), new double [op1->getDim()]);
-
-    ISet::IIterator* itOp1 = op1->getBegin();
-    bool isEnd = false;
+    auto const* op2Impl = dynamic_cast<ISetImpl const*>(op2);
+    if (op2Impl)
+    {
+        std::vector<double> rows;
+        std::vector<char> member;
+        std::atomic<bool> missing{false};
+        if (collectRows(op1, rows) != RC::SUCCESS)
+            return false;
 
-    do {
-        isEnd = itOp1->isEnd();
-        if (itOp1->getVectorCoords(vectorFromSet) != RC::SUCCESS)
+        if (findMembers(rows, op1->getDim(), op2Impl, n, tol, member, &missing) != RC::SUCCESS)
             return false;
 
-        switch (op2->findFirstAndCopyCoords(vectorFromSet, n, tol, vectorForCheck))
-        {
-            case RC::VECTOR_NOT_FOUND:
-            {
-                return false;
-            }
-            case RC::SUCCESS:
-                continue;
-            default:
-                return false;
-        }
+        return !missing.load();
+    }
 
-    } while (!isEnd);
+    IVector* vectorFromSet = nullptr;
+    IVector* vectorForCheck = nullptr;
+    RC rc = op1->getCopy(0, vectorFromSet);
+    if (rc == RC::SUCCESS)
+        rc = op1->getCopy(0, vectorForCheck);
+
+    for (size_t i = 0; rc == RC::SUCCESS && i < op1->getSize(); i++)
+    {
+        if ((rc = op1->getCoords(i, vectorFromSet)) == RC::SUCCESS)
+            rc = op2->findFirstAndCopyCoords(vectorFromSet, n, tol, vectorForCheck);
+    }
 
     delete vectorFromSet;
     delete vectorForCheck;
 
-    return true;
-}
-
-bool ISet::IIterator::equal(const ISet::IIterator *op1, const ISet::IIterator *op2) {
-    if (!op1 || !op2)
-        return false;
-
-    return op1->getIndex() == op2->getIndex();
+    return rc == RC::SUCCESS;
 }
 
 ISet::~ISet() = default;
@@ -1,12 +1,27 @@
 //
 // Created by Danil on 26.03.2021.
 //
+#ifndef IVECTOR_ISETIMPL_H
+#define IVECTOR_ISETIMPL_H
+
 #include "../include/ISet.h"
 #include "../include/ValidChecker.h"
 #include "../include/ILogger.h"
 #include "../include/IControlBlock.h"
+#include "../include/VectorKernels.h"
+#include "ToleranceIndex.cpp"
+#include "SlotRanks.cpp"
+#include "SetSnapshot.cpp"
+#include "KdTree.cpp"
+#include "CowChunks.cpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -19,6 +34,10 @@ namespace {
 
         static RC setLogger(ILogger *const logger);
 
+        // nullptr if the file can't be read or isn't a snapshot
+        static ISetImpl* openMapped(char const* const& path);
+        RC save(char const* const& path) const override;
+
         size_t getDim() const override;
         size_t getSize() const override;
 
@@ -30,11 +49,47 @@ namespace {
         RC getCoords(size_t index, IVector * const& val) const override;
         RC findFirstAndCopyCoords(IVector const * const& pat, IVector::NORM n, double tol, IVector * const& val) const override;
 
+        RC findKNearest(IVector const * const& pat, size_t k, IVector::NORM n, size_t* const& indices, double* const& distances, size_t& found) const override;
+        RC findWithin(IVector const * const& pat, double r, IVector::NORM n, size_t* const& indices, double* const& distances, size_t capacity, size_t& found) const override;
+
+        RC getView(size_t index, IVectorView *& val) const override;
+        RC rebindView(size_t index, IVectorView * const& val) const override;
+
+        RC exportRange(size_t start, size_t count, double* const& dst, size_t strideDoubles) const override;
+        RC exportRangeColumnMajor(size_t start, size_t count, double* const& dst, size_t ldDoubles) const override;
+        RC exportIndices(size_t const* const& indices, size_t count, double* const& dst, size_t strideDoubles) const override;
+
         RC insert(IVector const * const& val, IVector::NORM n, double tol) override;
+        RC insertBatch(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol, size_t& accepted) override;
 
         RC remove(size_t index) override;
         RC remove(IVector const * const& pat, IVector::NORM n, double tol) override;
 
+        RC setIndex(INDEX index) override;
+        RC setLshParams(LshParams const& params) override;
+
+        RC compact() override;
+        RC setCompactionThreshold(double deadFraction) override;
+
+        ScanStats getScanStats() const override;
+        void resetScanStats() override;
+
+        Cursor getCursor() const override;
+
+        /*
+        * Row level operations for set algebra in ISet.cpp.
+        * lookupIndex returns the set's index if it suits lookups with tol under n, otherwise builds one for them
+        * which only the caller uses (nullptr means scan), the set itself is not changed. containsRow may run on
+        * several threads, it counts lookups in caller's stats, addScanStats publishes them.
+        * appendRows adds rows without lookups, caller guarantees they are tol apart under n from each other and from the set
+        */
+        std::shared_ptr<ToleranceIndex const> lookupIndex(double tol, IVector::NORM n) const;
+        bool containsRow(double const* row, IVector::NORM n, double tol, ScanStats& stats) const;
+        bool containsRow(double const* row, IVector::NORM n, double tol, ToleranceIndex const* index, ScanStats& stats) const;
+        void addScanStats(ScanStats const& stats) const;
+        bool isSeparated(IVector::NORM n, double tol) const;
+        RC appendRows(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol);
+
         IIterator *getIterator(size_t index) const override;
         IIterator *getBegin() const override;
         IIterator *getEnd() const override;
@@ -50,8 +105,12 @@ namespace {
             RC getNext(IVector *const &vec, size_t &index, size_t indexInc = 1) const override;
             RC getPrevious(IVector *const &vec, size_t &index, size_t indexInc = 1) const override;
 
+            RC getBegin(IVector *const &vec, size_t &index) const override;
+            RC getEnd(IVector *const &vec, size_t &index) const override;
+
             bool isBegin(size_t index) override;
             bool isEnd(size_t index) override;
+            bool isValid(size_t index) const override;
 
             ~IControlBlockImpl() override = default ;
         };
@@ -79,35 +138,107 @@ namespace {
 
             RC getVectorCoords(IVector * const& val) const override;
 
-            bool isBegin() const override;
-            bool isEnd() const override;
+            bool isValid() const override;
+
+            RC makeBegin() override;
+            RC makeEnd() override;
+
+            bool isBegin() const;
+            bool isEnd() const;
 
             ~IIteratorImpl() override;
 
         protected:
-            virtual size_t getIndex() const override;
+            virtual size_t getIndex() const;
         };
 
     private:
         size_t _dim = 0;
+        // Live vectors
         size_t _size = 0;
-        size_t _capacity = 100;
-        static ILogger *pLogger;
-        double* _data;
-        std::vector<size_t> availableIndexes;
+        // Rows in _rows, removed rows stay there filled with NaN until compaction
+        size_t _slots = 0;
+        // Atomic, so setLogger() may run while other threads use sets
+        static std::atomic<ILogger*> pLogger;
+        // Shared with clones until written, full chunks of a set from openMapped() point into the file
+        CowChunks<double> _rows;
+        // Unique index of every slot, increasing with slot
+        CowChunks<size_t> availableIndexes;
+        SlotRanks _ranks;
+        double _compactionThreshold = 0.25;
+        // Unique index of the next inserted vector
         size_t maxHash = 0;
         std::shared_ptr<IControlBlockImpl> controlBlock = std::make_shared<IControlBlockImpl>(this);
+        // Changed whenever a chunk of _rows may be copied or rows shifted, see IVectorView::Epoch
+        std::shared_ptr<size_t> _epoch = std::make_shared<size_t>(0);
+        INDEX _indexKind = INDEX::GRID;
+        // Built by the first insert() with positive tol, nullptr means linear scan. Const operations never
+        // replace it, see lookupIndex(). Clones share it until one of them changes it, see mutableIndex()
+        std::shared_ptr<ToleranceIndex> _index;
+        double _indexTol = 0;
+        IVector::NORM _indexNorm = IVector::NORM::SECOND;
+        LshParams _lshParams;
+        // Every two vectors are at least _separation[n] apart under norm n
+        double _separation[(size_t)IVector::NORM::AMOUNT] = {
+            std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()
+        };
+
+        void buildIndex(double tol, IVector::NORM n);
+        // Index of the live rows, nullptr if there is no memory for it
+        ToleranceIndex* makeIndex(double tol, IVector::NORM n) const;
+        // nullptr if there is no index, copies a shared index first (its buckets stay shared)
+        ToleranceIndex* mutableIndex();
+        // Index is dropped if there is no memory to change it, the next insert() builds it again
+        void indexInsert(size_t slot, double const* row);
+        void indexErase(size_t slot, double const* row);
+        void noteInsert(IVector::NORM n, double tol);
+        // Makes room for rows slots in total, so that append() can't fail
+        RC reserve(size_t rows);
+        void append(double const* row);
+
+        // NaN never passes a distance check, so scans skip removed rows without looking at them
+        bool isLive(size_t slot) const { return !std::isnan(_rows.at(slot)[0]); }
+        size_t slotOf(size_t index) const { return _slots == _size ? index : _ranks.select(index); }
+        // Copies shared chunks removeSlot() writes to for every slot, nothing is removed if there is no memory
+        RC prepareRemoval(size_t const* slots, size_t count);
+        void removeSlot(size_t slot);
+        RC getSlotCoords(size_t slot, IVector * const& val) const;
+        // First slot with unique index not less than index, availableIndexes is sorted
+        size_t lowerSlot(size_t index) const;
+        RC checkRange(size_t start, size_t count, double* const& dst) const;
+        void compactIfNeeded();
+
+        // Built by the first nearest neighbour query after a change, _treeEpoch is *_epoch + 1 at that moment.
+        // Readers may build it concurrently, so it is guarded by _treeMutex
+        mutable std::mutex _treeMutex;
+        mutable std::unique_ptr<KdTree> _tree;
+        mutable std::atomic<size_t> _treeEpoch{0};
+
+        // nullptr if there is no memory for the tree, queries scan all rows then
+        KdTree const* nearestTree() const;
+        RC findNearest(IVector const * const& pat, IVector::NORM n, double radius, size_t capacity, size_t* const& indices,
+                       double* const& distances, bool countAll, size_t& found) const;
+
+        // Updated by const lookups, which may run on several threads
+        mutable std::atomic<size_t> _lookups{0};
+        mutable std::atomic<size_t> _rowsVisited{0};
+        mutable std::atomic<size_t> _approxLookups{0};
+        mutable std::atomic<size_t> _sampledLookups{0};
+        mutable std::atomic<size_t> _exactFound{0};
+        mutable std::atomic<size_t> _approxFound{0};
 
         RC FindEqualData(const IVector *const &pat, IVector::NORM n, double tol, int& index, int startIndex = 0) const;
+        // Slot of the first row from startIndex within tol of row, _slots if there is none. index is the set's one or from lookupIndex()
+        size_t findRow(double const* row, IVector::NORM n, double tol, ToleranceIndex const* index, size_t& visited, size_t startIndex = 0) const;
+        // Same without index, chunk by chunk
+        size_t scanRows(double const* row, IVector::NORM n, double tol, size_t& visited, size_t startIndex) const;
     };
 
 
-    ILogger* ISetImpl::pLogger = nullptr;
+    std::atomic<ILogger*> ISetImpl::pLogger{nullptr};
 }
 
-    ISetImpl::ISetImpl() {
-        _data = new double[_capacity];
-    }
+    ISetImpl::ISetImpl() = default;
 
 size_t ISetImpl::getDim() const {
     return _dim;
@@ -118,28 +249,41 @@ size_t ISetImpl::getSize() const {
 }
 
 RC ISetImpl::getCoords(size_t index, IVector * const& val) const {
-    if (index < 0 || index > _size - 1)
+    if (index >= _size)
     {
-        pLogger->log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INDEX_OUT_OF_BOUND;
     }
 
-    auto *dataForOutput = new double[_dim];
-    memcpy((void *) dataForOutput, _data + index * _dim, _dim * sizeof(double));
+    return val->setData(_dim, _rows.at(slotOf(index)));
+}
 
-    val->setData(_dim, dataForOutput);
+RC ISetImpl::getSlotCoords(size_t slot, IVector * const& val) const {
+    return val->setData(_dim, _rows.at(slot));
+}
 
-    return RC::SUCCESS;
+size_t ISetImpl::lowerSlot(size_t index) const {
+    size_t low = 0, high = _slots;
+    while (low < high)
+    {
+        const size_t mid = low + (high - low) / 2;
+        if (availableIndexes[mid] < index)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
 }
 
 RC ISetImpl::findFirstAndCopyCoords(IVector const * const& pat, IVector::NORM n, double tol, IVector * const& val) const {
     if (_size == 0) {
-        pLogger->log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INDEX_OUT_OF_BOUND;
     }
 
     if (pat == nullptr || n == IVector::NORM::AMOUNT) {
-        pLogger->log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INVALID_ARGUMENT;
     }
 
@@ -149,21 +293,268 @@ RC ISetImpl::findFirstAndCopyCoords(IVector const * const& pat, IVector::NORM n,
         return code;
 
     if (indexOfEqualData != -1)
+        return val->setData(_dim, _rows.at(indexOfEqualData));
+
+    return RC::VECTOR_NOT_FOUND;
+}
+
+RC ISetImpl::findKNearest(IVector const * const& pat, size_t k, IVector::NORM n, size_t* const& indices, double* const& distances, size_t& found) const {
+    return findNearest(pat, n, std::numeric_limits<double>::infinity(), k, indices, distances, false, found);
+}
+
+RC ISetImpl::findWithin(IVector const * const& pat, double r, IVector::NORM n, size_t* const& indices, double* const& distances, size_t capacity, size_t& found) const {
+    return findNearest(pat, n, r, capacity, indices, distances, true, found);
+}
+
+RC ISetImpl::findNearest(IVector const * const& pat, IVector::NORM n, double radius, size_t capacity, size_t* const& indices,
+                         double* const& distances, bool countAll, size_t& found) const {
+    found = 0;
+    if (pat == nullptr || (capacity != 0 && (indices == nullptr || distances == nullptr)))
     {
-        auto* dataForOutput = new double[_dim];
-        memcpy(dataForOutput, _data + indexOfEqualData * _dim, _dim * sizeof(double));
-        val->setData(_dim, dataForOutput);
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    if (n == IVector::NORM::AMOUNT || !(radius >= 0))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    if (_size == 0 || (capacity == 0 && !countAll))
         return RC::SUCCESS;
+
+    if (pat->getDim() != _dim)
+    {
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MISMATCHING_DIMENSIONS;
     }
 
-    return RC::VECTOR_NOT_FOUND;
+    NearestQuery query(pat->getData(), _dim, n, radius, capacity, indices, distances, countAll);
+    KdTree const* tree = nearestTree();
+    if (tree)
+        tree->search(_rows, query);
+    else
+    {
+        for (size_t slot = 0; slot < _slots; slot++)
+        {
+            if (isLive(slot))
+                query.visit(_rows.at(slot), slot);
+        }
+    }
+
+    // Slots become indexes, as getCoords() takes them
+    const size_t size = query.finish();
+    if (_slots != _size)
+    {
+        for (size_t i = 0; i < size; i++)
+            indices[i] = _ranks.rank(indices[i]);
+    }
+
+    found = countAll ? query.getMatches() : size;
+    _lookups.fetch_add(1, std::memory_order_relaxed);
+    _rowsVisited.fetch_add(query.getVisited(), std::memory_order_relaxed);
+    return RC::SUCCESS;
+}
+
+KdTree const* ISetImpl::nearestTree() const {
+    // Sets aren't changed while they are read, so *_epoch is stable here
+    const size_t current = *_epoch + 1;
+    if (_treeEpoch.load(std::memory_order_acquire) == current)
+        return _tree.get();
+
+    std::lock_guard<std::mutex> lock(_treeMutex);
+    if (_treeEpoch.load(std::memory_order_relaxed) != current)
+    {
+        try
+        {
+            _tree.reset(new KdTree(_rows, _slots));
+        }
+        catch (std::bad_alloc const&)
+        {
+            log(RC::ALLOCATION_ERROR, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+            _tree.reset();
+        }
+
+        _treeEpoch.store(current, std::memory_order_release);
+    }
+
+    return _tree.get();
+}
+
+RC ISetImpl::getView(size_t index, IVectorView *&val) const {
+    if (index >= _size)
+    {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    IVectorView* view = IVectorView::createView(_dim, _rows.at(slotOf(index)), _epoch);
+    if (!view)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::ALLOCATION_ERROR;
+    }
+
+    val = view;
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::rebindView(size_t index, IVectorView *const &val) const {
+    if (!val)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    if (index >= _size)
+    {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    return val->rebind(_dim, _rows.at(slotOf(index)), _epoch);
+}
+
+RC ISetImpl::checkRange(size_t start, size_t count, double *const &dst) const {
+    if (!dst)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    if (start > _size || count > _size - start)
+    {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::exportRange(size_t start, size_t count, double *const &dst, size_t strideDoubles) const {
+    RC code = checkRange(start, count, dst);
+    if (code != RC::SUCCESS)
+        return code;
+
+    if (strideDoubles < _dim)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    if (count == 0)
+        return RC::SUCCESS;
+
+    // Runs of live rows of a chunk are copied at once, a dense destination takes the whole run in one copy
+    size_t slot = slotOf(start);
+    size_t written = 0;
+    while (written < count)
+    {
+        while (!isLive(slot))
+            slot++;
+
+        const size_t chunkRun = _rows.runLength(slot);
+        size_t run = 1;
+        while (written + run < count && run < chunkRun && isLive(slot + run))
+            run++;
+
+        double const* src = _rows.at(slot);
+        double* out = dst + written * strideDoubles;
+        if (strideDoubles == _dim)
+            VectorKernels::copy(out, src, run * _dim * sizeof(double));
+        else
+        {
+            for (size_t i = 0; i < run; i++)
+                memcpy(out + i * strideDoubles, src + i * _dim, _dim * sizeof(double));
+        }
+
+        slot += run;
+        written += run;
+    }
+
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::exportRangeColumnMajor(size_t start, size_t count, double *const &dst, size_t ldDoubles) const {
+    RC code = checkRange(start, count, dst);
+    if (code != RC::SUCCESS)
+        return code;
+
+    if (ldDoubles < count)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    if (count == 0)
+        return RC::SUCCESS;
+
+    // Row by row, so the set is read once and every column is written sequentially
+    size_t slot = slotOf(start);
+    for (size_t i = 0; i < count; i++, slot++)
+    {
+        while (!isLive(slot))
+            slot++;
+
+        double const* row = _rows.at(slot);
+        for (size_t j = 0; j < _dim; j++)
+            dst[j * ldDoubles + i] = row[j];
+    }
+
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::exportIndices(size_t const *const &indices, size_t count, double *const &dst, size_t strideDoubles) const {
+    if (!indices || !dst)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    if (strideDoubles < _dim)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (indices[i] >= _size)
+        {
+            log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INDEX_OUT_OF_BOUND;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+        memcpy(dst + i * strideDoubles, _rows.at(slotOf(indices[i])), _dim * sizeof(double));
+
+    return RC::SUCCESS;
 }
 
 RC ISetImpl::findFirstAndCopy(const IVector *const &pat, IVector::NORM n, double tol, IVector *&val) const {
-    RC rc;
-    IVector* newVector = IVector::createVector(_dim, new double[_dim]);
-    if ((rc = findFirstAndCopyCoords(pat, n, tol, newVector)) != RC::SUCCESS)
-        return rc;
+    if (_size == 0) {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    if (pat == nullptr || n == IVector::NORM::AMOUNT) {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    int indexOfEqualData;
+    RC code;
+    if ((code = FindEqualData(pat, n, tol, indexOfEqualData)) != RC::SUCCESS)
+        return code;
+
+    if (indexOfEqualData == -1)
+        return RC::VECTOR_NOT_FOUND;
+
+    IVector* newVector = IVector::createVector(_dim, _rows.at(indexOfEqualData));
+    if (!newVector)
+        return RC::ALLOCATION_ERROR;
 
     val = newVector;
 
@@ -172,26 +563,33 @@ RC ISetImpl::findFirstAndCopy(const IVector *const &pat, IVector::NORM n, double
 
 RC ISetImpl::insert(IVector const * const& val, IVector::NORM n, double tol) {
     if (val == nullptr || n == IVector::NORM::AMOUNT || !ValidChecker::isValidNumber(tol) || tol < 0) {
-        pLogger->log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INVALID_ARGUMENT;
     }
 
     if (_dim != 0 && val->getDim() != _dim) {
-        pLogger->log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::MISMATCHING_DIMENSIONS;
     }
 
     if (_dim == 0 && _size == 0) {
         _dim = val->getDim();
-        _size = 1;
+        RC code = reserve(1);
+        if (code != RC::SUCCESS)
+        {
+            _dim = 0;
+            return code;
+        }
 
-        const double *ValData = val->getData();
-        memcpy(_data, ValData, _dim * sizeof(double));
-        availableIndexes.push_back(0);
+        ++*_epoch;
+        append(val->getData());
 
         return RC::SUCCESS;
     }
 
+    if (!_index && _indexKind != INDEX::NONE && tol > 0)
+        buildIndex(tol, n);
+
     int indexOfEqualData;
     RC code;
     if ((code = FindEqualData(val, n, tol, indexOfEqualData)) != RC::SUCCESS)
@@ -200,86 +598,396 @@ RC ISetImpl::insert(IVector const * const& val, IVector::NORM n, double tol) {
     if (indexOfEqualData != -1)
         return RC::SUCCESS;
 
+    if ((code = reserve(_slots + 1)) != RC::SUCCESS)
+        return code;
+
+    ++*_epoch;
+    append(val->getData());
+    noteInsert(n, tol);
+
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::insertBatch(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol, size_t& accepted) {
+    accepted = 0;
+    if (count == 0)
+        return RC::SUCCESS;
+
+    if (rows == nullptr || dim == 0 || n == IVector::NORM::AMOUNT || !ValidChecker::isValidNumber(tol) || tol < 0) {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
 
-    if (_capacity < (_size + 1) * _dim * sizeof(double)) {
-        _capacity *= 2;
-        auto *tmp = new double[_capacity];
-        memmove(tmp, _data, _capacity / 2);
-        delete _data;
-        _data = tmp;
+    if (_dim != 0 && dim != _dim) {
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MISMATCHING_DIMENSIONS;
     }
 
-    const double *vecData = val->getData();
+    // Whole batch is checked first, so a bad row leaves the set unchanged
+    if (!VectorKernels::isFinite(rows, dim * count)) {
+        log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NOT_NUMBER;
+    }
 
-    memcpy(_data + _size * _dim, vecData, _dim * sizeof(double));
-    maxHash++;
-    availableIndexes.push_back(maxHash);
-    _size += 1;
+    const size_t oldDim = _dim;
+    _dim = dim;
+    RC code = reserve(_slots + count);
+    if (code != RC::SUCCESS)
+    {
+        _dim = oldDim;
+        return code;
+    }
+
+    ++*_epoch;
+    if (!_index && _indexKind != INDEX::NONE && tol > 0)
+        buildIndex(tol, n);
+
+    // Every row is looked up among the rows already in the set and the accepted rows of the batch,
+    // so the result is the same as inserting rows one by one
+    size_t visited = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t rowVisited;
+        const size_t found = findRow(rows + i * dim, n, tol, _index.get(), rowVisited);
+        visited += rowVisited;
+        if (found != _slots)
+            continue;
+
+        append(rows + i * dim);
+        accepted++;
+    }
+
+    _lookups.fetch_add(count, std::memory_order_relaxed);
+    _rowsVisited.fetch_add(visited, std::memory_order_relaxed);
+
+    if (accepted != 0)
+        noteInsert(n, tol);
 
     return RC::SUCCESS;
 }
 
+RC ISetImpl::appendRows(size_t dim, double const* rows, size_t count, IVector::NORM n, double tol) {
+    if (_dim != 0 && dim != _dim)
+    {
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MISMATCHING_DIMENSIONS;
+    }
+
+    if (count == 0)
+        return RC::SUCCESS;
+
+    const size_t oldDim = _dim;
+    _dim = dim;
+    RC code = reserve(_slots + count);
+    if (code != RC::SUCCESS)
+    {
+        _dim = oldDim;
+        return code;
+    }
+
+    ++*_epoch;
+    for (size_t i = 0; i < count; i++)
+        append(rows + i * dim);
+
+    noteInsert(n, tol);
+    return RC::SUCCESS;
+}
+
+void ISetImpl::noteInsert(IVector::NORM n, double tol) {
+    // Distances under CHEBYSHEV, SECOND and FIRST norms never decrease in this order,
+    // so a pair at least tol apart under n is at least tol apart under every later norm too
+    // Approximate lookups may have missed a vector within tol, so nothing is known after them
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::SECOND, IVector::NORM::FIRST};
+    const bool isExact = _indexKind != INDEX::LSH;
+    bool implied = false;
+    for (IVector::NORM norm : norms)
+    {
+        implied = implied || norm == n;
+        double& separation = _separation[(size_t)norm];
+        separation = std::min(separation, implied && isExact ? tol : 0.0);
+    }
+}
+
+bool ISetImpl::isSeparated(IVector::NORM n, double tol) const {
+    return _separation[(size_t)n] >= tol;
+}
+
+std::shared_ptr<ToleranceIndex const> ISetImpl::lookupIndex(double tol, IVector::NORM n) const {
+    if (_indexKind == INDEX::NONE || !(tol > 0) || _dim == 0)
+        return nullptr;
+
+    // Grid with cells much smaller or larger than tol makes every lookup visit too many cells or rows,
+    // hashes answer only the norm they were built for and tolerances up to the one they were built for
+    if (_index && tol <= 4 * _indexTol && 4 * tol >= _indexTol && (_indexKind != INDEX::LSH || (n == _indexNorm && tol <= _indexTol)))
+        return _index;
+
+    // Owned by the caller only, freed if there is no memory for the shared pointer
+    std::unique_ptr<ToleranceIndex const> index(makeIndex(tol, n));
+    return std::shared_ptr<ToleranceIndex const>(std::move(index));
+}
+
+bool ISetImpl::containsRow(double const* row, IVector::NORM n, double tol, ScanStats& stats) const {
+    return containsRow(row, n, tol, _index.get(), stats);
+}
+
+bool ISetImpl::containsRow(double const* row, IVector::NORM n, double tol, ToleranceIndex const* index, ScanStats& stats) const {
+    size_t visited;
+    const bool found = findRow(row, n, tol, index, visited) != _slots;
+    stats.lookups++;
+    stats.rowsVisited += visited;
+    return found;
+}
+
+void ISetImpl::addScanStats(ScanStats const& stats) const {
+    _lookups.fetch_add(stats.lookups, std::memory_order_relaxed);
+    _rowsVisited.fetch_add(stats.rowsVisited, std::memory_order_relaxed);
+}
+
+RC ISetImpl::reserve(size_t rows) {
+    // Dimension is set only while there are no rows
+    if (_rows.getWidth() != _dim)
+        _rows.setWidth(_dim);
+
+    // Rows already in the set stay in place, new chunks are added and shared ones at the end are copied
+    if (!_rows.reserve(rows) || !availableIndexes.reserve(rows) || !_ranks.reserve(rows))
+    {
+        // Dimension of an empty set may be restored by the caller
+        if (_slots == 0)
+            _rows.clear();
+
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::ALLOCATION_ERROR;
+    }
+
+    return RC::SUCCESS;
+}
+
+void ISetImpl::append(double const* row) {
+    _rows.resize(_slots + 1);
+    double* dst = _rows.mutableAt(_slots);
+    memcpy(dst, row, _dim * sizeof(double));
+    indexInsert(_slots, dst);
+
+    availableIndexes.resize(_slots + 1);
+    *availableIndexes.mutableAt(_slots) = maxHash++;
+    _ranks.pushLive();
+    _slots += 1;
+    _size += 1;
+}
+
+ToleranceIndex* ISetImpl::mutableIndex() {
+    // Copy that doesn't fit in memory is dropped, the next insert() builds the index again
+    if (_index && !isExclusive(_index))
+        _index.reset(_index->clone());
+
+    return _index.get();
+}
+
+void ISetImpl::indexInsert(size_t slot, double const* row) {
+    ToleranceIndex* index = mutableIndex();
+    if (!index)
+        return;
+
+    try
+    {
+        index->insert(slot, row);
+    }
+    catch (std::bad_alloc const&)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+        _index.reset();
+    }
+}
+
+void ISetImpl::indexErase(size_t slot, double const* row) {
+    ToleranceIndex* index = mutableIndex();
+    if (!index)
+        return;
+
+    try
+    {
+        index->erase(slot, row);
+    }
+    catch (std::bad_alloc const&)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+        _index.reset();
+    }
+}
+
 RC ISetImpl::remove(size_t index) {
 
-    if (index < 0 || index > _size - 1) {
-        pLogger->log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+    if (index >= _size) {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INVALID_ARGUMENT;
     }
-    availableIndexes.erase(availableIndexes.begin() + index);
 
-    if (index == _size - 1) {
-        _size--;
-        return RC::SUCCESS;
+    const size_t slot = slotOf(index);
+    RC code = prepareRemoval(&slot, 1);
+    if (code != RC::SUCCESS)
+        return code;
+
+    removeSlot(slot);
+    compactIfNeeded();
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::prepareRemoval(size_t const* slots, size_t count) {
+    // Ranks first, nothing points into them
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!_ranks.prepareKill(slots[i]))
+        {
+            log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::ALLOCATION_ERROR;
+        }
     }
 
-    memmove(_data + index * _dim, _data + (index + 1) * _dim,
-            (_size - index - 1) * _dim * sizeof(double));
+    // Views may point into a chunk of rows that was copied before the failure, so only then the epoch changes
+    bool isCopied = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        double const* shared = _rows.at(slots[i]);
+        double const* row = _rows.mutableAt(slots[i]);
+        if (!row)
+        {
+            if (isCopied)
+                ++*_epoch;
+
+            log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::ALLOCATION_ERROR;
+        }
+
+        isCopied = isCopied || row != shared;
+    }
+
+    return RC::SUCCESS;
+}
+
+void ISetImpl::removeSlot(size_t slot) {
+    ++*_epoch;
+    double* row = _rows.mutableAt(slot);
+    indexErase(slot, row);
+
+    std::fill(row, row + _dim, std::numeric_limits<double>::quiet_NaN());
+    _ranks.kill(slot);
     _size--;
+}
+
+void ISetImpl::compactIfNeeded() {
+    if ((double)(_slots - _size) > _compactionThreshold * (double)_slots)
+        compact();
+}
+
+RC ISetImpl::compact() {
+    if (_slots == _size)
+        return RC::SUCCESS;
+
+    // Rows from the first removed one move, their chunks are copied first if shared,
+    // so the set stays as it was if there is no memory for them
+    size_t first = 0;
+    while (isLive(first))
+        first++;
+
+    SlotRanks ranks;
+    if (!_rows.unshare(first, _size) || !availableIndexes.unshare(first, _size) || !ranks.reset(_size))
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::ALLOCATION_ERROR;
+    }
+
+    // Live rows keep their order and unique indexes, so iterators stay valid
+    ++*_epoch;
+    size_t live = first;
+    for (size_t slot = first; slot < _slots; slot++)
+    {
+        if (!isLive(slot))
+            continue;
+
+        memcpy(_rows.mutableAt(live), _rows.at(slot), _dim * sizeof(double));
+        *availableIndexes.mutableAt(live) = availableIndexes[slot];
+        live++;
+    }
+
+    _rows.resize(live);
+    availableIndexes.resize(live);
+    _slots = live;
+    _ranks = std::move(ranks);
+
+    if (_index)
+        buildIndex(_indexTol, _indexNorm);
+
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::setCompactionThreshold(double deadFraction) {
+    if (!(deadFraction > 0 && deadFraction <= 1))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    _compactionThreshold = deadFraction;
+    compactIfNeeded();
     return RC::SUCCESS;
 }
 
 RC ISetImpl::remove(const IVector *const &pat, IVector::NORM n, double tol) {
     if (pat == nullptr || n == IVector::NORM::AMOUNT || tol < 0) {
-        pLogger->log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INVALID_ARGUMENT;
     }
 
-    int indexOfEqualData = 0, startIndex = 0, numOfDataRemoved = 0;
+    // All matches are found first and their shared chunks copied, so the removal is done completely or not at all
+    int indexOfEqualData = 0, startIndex = 0;
     RC code;
+    std::vector<size_t> slots;
+    try
+    {
+        do {
+            if ((code = FindEqualData(pat, n, tol, indexOfEqualData, startIndex)) != RC::SUCCESS)
+                return code;
+
+            if (indexOfEqualData != -1)
+            {
+                slots.push_back(indexOfEqualData);
+                startIndex = indexOfEqualData + 1;
+            }
+        }while (indexOfEqualData != -1);
+    }
+    catch (std::bad_alloc const&)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::ALLOCATION_ERROR;
+    }
 
-    do {
-        if ((code = FindEqualData(pat, n, tol, indexOfEqualData, startIndex)) != RC::SUCCESS)
-            return code;
+    if (slots.empty())
+        return RC::VECTOR_NOT_FOUND;
 
-        if (indexOfEqualData != -1)
-        {
-            remove(indexOfEqualData);
-            availableIndexes.erase(availableIndexes.begin() + indexOfEqualData);
-            startIndex = indexOfEqualData;
-            numOfDataRemoved++;
-        }
-    }while (indexOfEqualData != -1);
+    if ((code = prepareRemoval(slots.data(), slots.size())) != RC::SUCCESS)
+        return code;
 
-    if (numOfDataRemoved == 0)
-        return RC::VECTOR_NOT_FOUND;
+    // Removed slots stay in place until compaction below
+    for (size_t slot : slots)
+        removeSlot(slot);
 
+    compactIfNeeded();
     return RC::SUCCESS;
 }
 
 
 RC ISetImpl::getCopy(size_t index, IVector *&val) const {
-    if (index < 0 || index > _dim - 1)
+    if (index >= _size)
     {
-        pLogger->log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::INVALID_ARGUMENT;
     }
 
-    IVector* newVector = IVector::createVector(_dim, new double[_dim]);
-    RC rc = getCoords(index, newVector);
-    if (rc != RC::SUCCESS)
+    IVector* newVector = IVector::createVector(_dim, _rows.at(slotOf(index)));
+    if (!newVector)
     {
         val = nullptr;
-        return rc;
+        return RC::ALLOCATION_ERROR;
     }
 
     val = newVector;
@@ -288,54 +996,152 @@ RC ISetImpl::getCopy(size_t index, IVector *&val) const {
 }
 
 RC ISetImpl::FindEqualData(const IVector *const &pat, IVector::NORM n, double tol, int& index, int startIndex) const {
-    if (startIndex > _size - 1)
+    index = -1;
+
+    if (pat->getDim() != _dim)
     {
-        index = std::numeric_limits<int>::quiet_NaN();
-        return RC::SUCCESS;
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MISMATCHING_DIMENSIONS;
     }
 
-    const double *currentData = new double[_dim];
-    if (!currentData)
+    size_t visited;
+    const size_t found = findRow(pat->getData(), n, tol, _index.get(), visited, startIndex);
+    _lookups.fetch_add(1, std::memory_order_relaxed);
+    _rowsVisited.fetch_add(visited, std::memory_order_relaxed);
+    if (found != _slots)
+        index = (int)found;
+
+    return RC::SUCCESS;
+}
+
+size_t ISetImpl::findRow(double const* row, IVector::NORM n, double tol, ToleranceIndex const* index, size_t& visited, size_t startIndex) const {
+    visited = 0;
+
+    // Nothing is strictly closer than 0
+    if (!(tol > 0) || startIndex >= _slots)
+        return _slots;
+
+    // Candidates come in any order, the first matching row is the smallest matching slot
+    thread_local std::vector<size_t> candidates;
+    candidates.clear();
+    if (index && index->candidates(row, n, tol, candidates))
     {
-        pLogger->log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-        return RC::NULLPTR_ERROR;
+        visited = candidates.size();
+
+        size_t first = _slots;
+        for (size_t slot : candidates)
+        {
+            if (slot >= startIndex && slot < first && VectorKernels::distance(_rows.at(slot), row, _dim, n, tol) < tol)
+                first = slot;
+        }
+
+        // Approximate index may miss a match, a sample of lookups is repeated by a scan to count how often
+        const size_t sampleEvery = _lshParams.sampleEvery;
+        if (_indexKind == INDEX::LSH && sampleEvery != 0 && _approxLookups.fetch_add(1, std::memory_order_relaxed) % sampleEvery == 0)
+        {
+            size_t scanned;
+            const bool isFound = scanRows(row, n, tol, scanned, startIndex) != _slots;
+            _sampledLookups.fetch_add(1, std::memory_order_relaxed);
+            _exactFound.fetch_add(isFound ? 1 : 0, std::memory_order_relaxed);
+            _approxFound.fetch_add(first != _slots ? 1 : 0, std::memory_order_relaxed);
+        }
+
+        return first;
     }
-    IVector *currentVector = IVector::createVector(_dim, currentData);
 
-    if (!currentVector)
+    return scanRows(row, n, tol, visited, startIndex);
+}
+
+size_t ISetImpl::scanRows(double const* row, IVector::NORM n, double tol, size_t& visited, size_t startIndex) const {
+    // Rows are compared in place, distance stops as soon as partial norm reaches tol
+    visited = 0;
+    for (size_t slot = startIndex; slot < _slots;)
     {
-        pLogger->log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-        return RC::NULLPTR_ERROR;
+        const size_t count = std::min(_rows.runLength(slot), _slots - slot);
+        size_t chunkVisited;
+        const size_t found = VectorKernels::findWithin(_rows.at(slot), count, _dim, row, n, tol, chunkVisited);
+        visited += chunkVisited;
+        if (found != count)
+            return slot + found;
+
+        slot += count;
     }
 
-    for (size_t i = startIndex; i < _size; i++) {
-        memcpy((void *) currentData, _data + i * _dim, _dim * sizeof(double));
-        currentVector->setData(_dim, currentData);
+    return _slots;
+}
 
-        IVector *diff = IVector::sub(currentVector, pat);
-        if (!diff)
-        {
-            delete[] currentData;
-            delete currentVector;
-            pLogger->log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return RC::NULLPTR_ERROR;
-        }
+ISet::ScanStats ISetImpl::getScanStats() const {
+    ScanStats stats;
+    stats.lookups = _lookups.load(std::memory_order_relaxed);
+    stats.rowsVisited = _rowsVisited.load(std::memory_order_relaxed);
+    stats.sampledLookups = _sampledLookups.load(std::memory_order_relaxed);
+    stats.exactFound = _exactFound.load(std::memory_order_relaxed);
+    stats.approxFound = _approxFound.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ISetImpl::resetScanStats() {
+    _lookups.store(0, std::memory_order_relaxed);
+    _rowsVisited.store(0, std::memory_order_relaxed);
+    _sampledLookups.store(0, std::memory_order_relaxed);
+    _exactFound.store(0, std::memory_order_relaxed);
+    _approxFound.store(0, std::memory_order_relaxed);
+}
+
+void ISetImpl::buildIndex(double tol, IVector::NORM n) {
+    _indexTol = tol;
+    _indexNorm = n;
+    _index.reset(makeIndex(tol, n));
+}
 
-        if (diff->norm(n) < tol)
+ToleranceIndex* ISetImpl::makeIndex(double tol, IVector::NORM n) const {
+    std::unique_ptr<ToleranceIndex> index;
+    try
+    {
+        if (_indexKind == INDEX::LSH)
+            index.reset(new LshIndex(_dim, tol, n, _lshParams.tables, _lshParams.hashesPerTable, _lshParams.bucketWidth, _lshParams.seed));
+        else
+            index.reset(new GridIndex(_dim, tol));
+
+        for (size_t slot = 0; slot < _slots; slot++)
         {
-            index = i;
-            delete diff;
-            delete[] currentData;
-            delete currentVector;
-            return RC::SUCCESS;
+            if (isLive(slot))
+                index->insert(slot, _rows.at(slot));
         }
+    }
+    catch (std::bad_alloc const&)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    return index.release();
+}
 
-        delete diff;
+RC ISetImpl::setIndex(INDEX index) {
+    if (index != INDEX::NONE && index != INDEX::GRID && index != INDEX::LSH)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
     }
 
-    index = -1;
-    delete[] currentData;
-    delete currentVector;
+    // Index is built again by the next insert(), with its tolerance
+    _indexKind = index;
+    _index.reset();
+    return RC::SUCCESS;
+}
+
+RC ISetImpl::setLshParams(LshParams const& params) {
+    if (params.tables == 0 || params.hashesPerTable == 0 || !ValidChecker::isValidNumber(params.bucketWidth) || params.bucketWidth <= 0)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    _lshParams = params;
+    if (_indexKind == INDEX::LSH)
+        _index.reset();
+
     return RC::SUCCESS;
 }
 
@@ -346,13 +1152,14 @@ RC ISetImpl::setLogger(ILogger *const logger) {
         return RC::NULLPTR_ERROR;
     }
 
-    pLogger = logger;
+    pLogger.store(logger, std::memory_order_release);
     return RC::SUCCESS;
 }
 
 void ISetImpl::log(RC code, ILogger::Level level, const char *const &srcfile, const char *const &function, int line) {
-    if (pLogger != nullptr)
-        pLogger->log(code, level, srcfile, function, line);
+    ILogger* logger = pLogger.load(std::memory_order_acquire);
+    if (logger != nullptr)
+        logger->log(code, level, srcfile, function, line);
 }
 
 bool ISetImpl::IIteratorImpl::isBegin() const {
@@ -360,35 +1167,71 @@ bool ISetImpl::IIteratorImpl::isBegin() const {
 }
 
 bool ISetImpl::IControlBlockImpl::isBegin(size_t index) {
-    return index <= _set->availableIndexes[0];
+    return _set->_size == 0 || index <= _set->availableIndexes[_set->slotOf(0)];
 }
 
 bool ISetImpl::IIteratorImpl::isEnd() const {
     return _cntrl_block->isEnd(_index);
 }
 
+bool ISetImpl::IIteratorImpl::isValid() const {
+    return _cntrl_block->isValid(_index);
+}
+
+RC ISetImpl::IIteratorImpl::makeBegin() {
+    return _cntrl_block->getBegin(_vec, _index);
+}
+
+RC ISetImpl::IIteratorImpl::makeEnd() {
+    return _cntrl_block->getEnd(_vec, _index);
+}
+
+bool ISetImpl::IIteratorImpl::equal(const IIterator *op1, const IIterator *op2) {
+    if (!op1 || !op2)
+        return false;
+
+    return static_cast<const IIteratorImpl*>(op1)->getIndex() == static_cast<const IIteratorImpl*>(op2)->getIndex();
+}
+
 bool ISetImpl::IControlBlockImpl::isEnd(size_t index) {
-    return index >= _set->availableIndexes[_set->availableIndexes.size() - 1];
+    return _set->_size == 0 || index >= _set->availableIndexes[_set->slotOf(_set->_size - 1)];
 }
 
-RC ISetImpl::IControlBlockImpl::getNext(IVector *const &vec, size_t &index, size_t indexInc) const {
-    size_t sizeAvailableIndexes = _set->availableIndexes.size();
-    int nIndex = -1;
+bool ISetImpl::IControlBlockImpl::isValid(size_t index) const {
+    const size_t slot = _set->lowerSlot(index);
+    return slot != _set->_slots && _set->availableIndexes[slot] == index && _set->isLive(slot);
+}
 
-    for (size_t i = 0; i < sizeAvailableIndexes; i++)
-    {
-        if (_set->availableIndexes[i] > index)
-        {
-            nIndex = i;
-            break;
-        }
-    }
+RC ISetImpl::IControlBlockImpl::getBegin(IVector *const &vec, size_t &index) const {
+    if (_set->_size == 0)
+        return RC::SOURCE_SET_EMPTY;
+
+    const size_t slot = _set->slotOf(0);
+    index = _set->availableIndexes[slot];
+    return _set->getSlotCoords(slot, vec);
+}
+
+RC ISetImpl::IControlBlockImpl::getEnd(IVector *const &vec, size_t &index) const {
+    if (_set->_size == 0)
+        return RC::SOURCE_SET_EMPTY;
 
-    if (nIndex < 0)
+    const size_t slot = _set->slotOf(_set->_size - 1);
+    index = _set->availableIndexes[slot];
+    return _set->getSlotCoords(slot, vec);
+}
+
+RC ISetImpl::IControlBlockImpl::getNext(IVector *const &vec, size_t &index, size_t indexInc) const {
+    if (indexInc == 0)
+        return RC::SUCCESS;
+
+    // Live vectors before the first unique index after index, the iterator itself may point to a removed one
+    const size_t position = _set->_ranks.rank(_set->lowerSlot(index + 1));
+    if (position + indexInc - 1 >= _set->_size)
         return RC::INVALID_ARGUMENT;
 
-    index =_set->availableIndexes[nIndex];
-    RC rc = _set->getCoords(nIndex, vec);
+    const size_t slot = _set->slotOf(position + indexInc - 1);
+    index = _set->availableIndexes[slot];
+    RC rc = _set->getSlotCoords(slot, vec);
     if (rc != RC::SUCCESS)
     {
         ISetImpl::log(rc, ILogger::Level::SEVERE, __FILE__, __func__, __LINE__);
@@ -399,23 +1242,17 @@ RC ISetImpl::IControlBlockImpl::getNext(IVector *const &vec, size_t &index, size
 }
 
 RC ISetImpl::IControlBlockImpl::getPrevious(IVector *const &vec, size_t &index, size_t indexInc) const {
-    size_t sizeAvailableIndexes = _set->availableIndexes.size();
-    int nIndex = -1;
-
-    for (size_t i = 0; i < sizeAvailableIndexes; i++)
-    {
-        if (_set->availableIndexes[i] >= index)
-        {
-            nIndex = i - 1;
-            break;
-        }
-    }
+    if (indexInc == 0)
+        return RC::SUCCESS;
 
-    if (nIndex < 0)
+    // Live vectors with unique index less than index
+    const size_t position = _set->_ranks.rank(_set->lowerSlot(index));
+    if (position < indexInc)
         return RC::INVALID_ARGUMENT;
 
-    index = _set->availableIndexes[nIndex];
-    RC rc = _set->getCoords(nIndex, vec);
+    const size_t slot = _set->slotOf(position - indexInc);
+    index = _set->availableIndexes[slot];
+    RC rc = _set->getSlotCoords(slot, vec);
     if (rc != RC::SUCCESS)
     {
         ISetImpl::log(rc, ILogger::Level::SEVERE, __FILE__, __func__, __LINE__);
@@ -425,6 +1262,10 @@ RC ISetImpl::IControlBlockImpl::getPrevious(IVector *const &vec, size_t &index,
     return RC::SUCCESS;
 }
 
+ISet::Cursor ISetImpl::getCursor() const {
+    return makeCursor(_rows.table(), _rows.shift(), _dim, _slots, _epoch.get());
+}
+
 ISet::IIterator *ISetImpl::getIterator(size_t index) const {
     if (_size == 0)
         return nullptr;
@@ -436,7 +1277,7 @@ ISet::IIterator *ISetImpl::getIterator(size_t index) const {
     if (rc != RC::SUCCESS)
         return nullptr;
 
-    size_t currentIndex = availableIndexes[index];
+    size_t currentIndex = availableIndexes[slotOf(index)];
     std::shared_ptr<ISetControlBlock> tmpCtrlBlock = std::dynamic_pointer_cast<ISetControlBlock>(controlBlock);
 
     IIterator* it = new (std::nothrow)IIteratorImpl(tmpCtrlBlock, vec, currentIndex);
@@ -454,7 +1295,7 @@ ISet::IIterator *ISetImpl::getBegin() const {
     if (rc != RC::SUCCESS)
         return nullptr;
 
-    size_t index = availableIndexes[0];
+    size_t index = availableIndexes[slotOf(0)];
     std::shared_ptr<ISetControlBlock> tmpCtrlBlock = std::dynamic_pointer_cast<ISetControlBlock>(controlBlock);
     IIterator* it = new (std::nothrow)IIteratorImpl(tmpCtrlBlock, vec, index);
     delete vec;
@@ -471,7 +1312,7 @@ ISet::IIterator *ISetImpl::getEnd() const {
     if (rc != RC::SUCCESS)
         return nullptr;
 
-    size_t index = availableIndexes[_size - 1];
+    size_t index = availableIndexes[slotOf(_size - 1)];
     std::shared_ptr<ISetControlBlock> tmpCtrlBlock = std::dynamic_pointer_cast<ISetControlBlock>(controlBlock);
     IIterator* it = new (std::nothrow)IIteratorImpl(tmpCtrlBlock, vec, index);
     delete vec;
@@ -510,32 +1351,13 @@ RC ISetImpl::IIteratorImpl::setLogger(ILogger *const pLogger) {
     return RC::INDEX_OUT_OF_BOUND;
 }
 
+// Iterator stays in place if there are less than indexInc vectors to move over
 RC ISetImpl::IIteratorImpl::next(size_t indexInc) {
-    size_t i = indexInc;
-
-    while (i != 0)
-    {
-        RC rc = _cntrl_block->getNext(_vec, _index, indexInc);
-        if (rc == RC::INVALID_ARGUMENT)
-            return rc;
-
-        i-= 1;
-    }
-    return RC::SUCCESS;
+    return _cntrl_block->getNext(_vec, _index, indexInc);
 }
 
 RC ISetImpl::IIteratorImpl::previous(size_t indexInc) {
-    size_t i = indexInc;
-
-    while (i != 0)
-    {
-        RC rc = _cntrl_block->getPrevious(_vec, _index, indexInc);
-        if (rc == RC::INVALID_ARGUMENT)
-            return rc;
-
-        i -= 1;
-    }
-    return RC::SUCCESS;
+    return _cntrl_block->getPrevious(_vec, _index, indexInc);
 }
 
 RC ISetImpl::IIteratorImpl::getVectorCopy(IVector *&val) const {
@@ -572,17 +1394,190 @@ ISetImpl::IIteratorImpl::~IIteratorImpl(){
 
 
 ISet *ISetImpl::clone() const {
-//    TODO: доделать
-    ISetImpl* newSet = new ISetImpl;
+    auto* newSet = new (std::nothrow) ISetImpl;
+    if (!newSet)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
 
-    newSet->_dim = this->_dim;
+    // Chunks are shared, each set copies a chunk when it first writes to it.
+    // Removed rows are kept too, so unique indexes of vectors stay the same
+    newSet->_dim = _dim;
+    newSet->_rows = _rows;
+    newSet->_size = _size;
+    newSet->_slots = _slots;
+    newSet->availableIndexes = availableIndexes;
+    newSet->_ranks = _ranks;
+    newSet->maxHash = maxHash;
+    newSet->_compactionThreshold = _compactionThreshold;
+    newSet->_indexKind = _indexKind;
+    newSet->_lshParams = _lshParams;
+    std::copy(std::begin(_separation), std::end(_separation), std::begin(newSet->_separation));
+
+    if (_index)
+    {
+        newSet->_index = _index;
+        newSet->_indexTol = _indexTol;
+        newSet->_indexNorm = _indexNorm;
+    }
 
+    return newSet;
 }
 
-ISetImpl::~ISetImpl() {
-    delete _data;
+RC ISetImpl::save(char const* const& path) const {
+    if (!path)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        log(RC::FILE_NOT_FOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::FILE_NOT_FOUND;
+    }
+
+    SnapshotHeader header{};
+    memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.byteOrder = snapshotByteOrder;
+    header.headerBytes = sizeof(SnapshotHeader);
+    header.dim = _dim;
+    header.size = _size;
+    header.nextIndex = maxHash;
+    header.dataOffset = snapshotDataOffset(_size);
+    std::copy(std::begin(_separation), std::end(_separation), std::begin(header.separation));
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    for (size_t slot = 0; slot < _slots; slot++)
+    {
+        const uint64_t index = availableIndexes[slot];
+        if (isLive(slot))
+            file.write(reinterpret_cast<char const*>(&index), sizeof(index));
+    }
+
+    static const char padding[snapshotAlignment] = {};
+    file.write(padding, header.dataOffset - sizeof(header) - _size * sizeof(uint64_t));
+
+    // Runs of live rows of a chunk are written at once, without removed rows that is a chunk per write
+    for (size_t slot = 0; slot < _slots;)
+    {
+        if (!isLive(slot))
+        {
+            slot++;
+            continue;
+        }
+
+        const size_t chunkRun = std::min(_rows.runLength(slot), _slots - slot);
+        size_t run = 1;
+        while (run < chunkRun && isLive(slot + run))
+            run++;
+
+        file.write(reinterpret_cast<char const*>(_rows.at(slot)), run * _dim * sizeof(double));
+        slot += run;
+    }
+
+    if (!file.flush())
+    {
+        log(RC::IO_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::IO_ERROR;
+    }
+
+    return RC::SUCCESS;
 }
 
+ISetImpl* ISetImpl::openMapped(char const* const& path) {
+    if (!path)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
 
+    RC code;
+    std::shared_ptr<MappedFile> file(MappedFile::open(path, code));
+    if (!file)
+    {
+        log(code, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
 
+    // Sizes are compared by division, so a damaged header can't overflow them
+    SnapshotHeader header{};
+    const size_t bytes = file->size();
+    if (bytes >= sizeof(header))
+        memcpy(&header, file->data(), sizeof(header));
+
+    const size_t maxDoubles = bytes / sizeof(double);
+    const bool isValid = bytes >= sizeof(header) && memcmp(header.magic, snapshotMagic, sizeof(header.magic)) == 0 &&
+                         header.version == snapshotVersion && header.byteOrder == snapshotByteOrder &&
+                         header.headerBytes == sizeof(header) && header.size <= maxDoubles &&
+                         header.dataOffset == snapshotDataOffset(header.size) && header.dataOffset <= bytes &&
+                         (header.size == 0 || (header.dim != 0 && header.dim <= maxDoubles &&
+                                               header.size <= (bytes - header.dataOffset) / sizeof(double) / header.dim));
+    if (!isValid)
+    {
+        log(RC::IO_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    auto* set = new (std::nothrow) ISetImpl;
+    if (!set)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    // Empty set gets its dimension from the first insert, like a new one
+    if (header.size == 0)
+        return set;
+
+    // Indexes are the only part read now, rows are read from the file on first access
+    char const* indexes = file->data() + sizeof(header);
+    if (!set->availableIndexes.reserve(header.size))
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        delete set;
+        return nullptr;
+    }
+
+    set->availableIndexes.resize(header.size);
+    for (size_t i = 0; i < header.size; i++)
+    {
+        uint64_t index;
+        memcpy(&index, indexes + i * sizeof(index), sizeof(index));
+        if (index >= header.nextIndex || (i != 0 && index <= set->availableIndexes[i - 1]))
+        {
+            log(RC::IO_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            delete set;
+            return nullptr;
+        }
+
+        *set->availableIndexes.mutableAt(i) = index;
+    }
+
+    // Full chunks of rows point into the file and keep it mapped while any clone uses them
+    set->_dim = header.dim;
+    set->_rows.setWidth(header.dim);
+    if (!set->_rows.alias(file, reinterpret_cast<double*>(file->data() + header.dataOffset), header.size) ||
+        !set->_ranks.reset(header.size))
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        delete set;
+        return nullptr;
+    }
+
+    set->_size = header.size;
+    set->_slots = header.size;
+    set->maxHash = header.nextIndex;
+    std::copy(std::begin(header.separation), std::end(header.separation), std::begin(set->_separation));
+
+    return set;
+}
+
+ISetImpl::~ISetImpl() {
+    ++*_epoch;
+}
 
+#endif //IVECTOR_ISETIMPL_H
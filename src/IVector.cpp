@@ -1,28 +1,251 @@
 #include "../include/MathModule.h"
 #include "../src/VectorImpl.cpp"
+#include "../src/CompactVectorImpl.cpp"
 #include "../include/ValidChecker.h"
 #include "../include/IVector.h"
+#include "../include/IVectorArena.h"
+#include "../include/VectorAllocator.h"
+#include "../include/VectorKernels.h"
+#include "../include/VectorExpression.h"
+#include "../include/FixedVector.h"
+#include "../include/IVectorView.h"
+#include <algorithm>
 
 
 #include <new>
 
+namespace {
+    template <size_t N>
+    IVector* createFixedVector(double const* ptr_data, IVectorArena* arena)
+    {
+        const size_t size = sizeof(FixedVector<N>);
+        const size_t dataOffset = FixedVector<N>::dataOffset;
+        void* pInstance = arena ? arena->allocate(size, dataOffset) : VectorAllocator::allocate(size, dataOffset);
+        if (!pInstance)
+            return nullptr;
+
+        auto* vector = ::new(pInstance) FixedVector<N>();
+        vector->setData(N, ptr_data);
+        return vector;
+    }
+
+    bool hasCompact(IVector const* op1, IVector const* op2)
+    {
+        return op1->getPrecision() != IVector::PRECISION::DOUBLE || op2->getPrecision() != IVector::PRECISION::DOUBLE;
+    }
+
+    // Coordinates [start, start + count) as doubles, compact vector is decoded into buffer
+    double const* readBlock(IVector const* vector, size_t start, size_t count, double* buffer)
+    {
+        if (vector->getPrecision() == IVector::PRECISION::DOUBLE)
+            return vector->getData() + start;
+
+        static_cast<CompactVectorImpl const*>(vector)->decode(start, count, buffer);
+        return buffer;
+    }
+
+    double blockedDot(IVector const* op1, IVector const* op2)
+    {
+        const size_t blockSize = CompactVectorImpl::blockSize;
+        double buffer1[blockSize], buffer2[blockSize];
+        double result = 0;
+
+        for (size_t start = 0; start < op1->getDim(); start += blockSize)
+        {
+            const size_t count = std::min(blockSize, op1->getDim() - start);
+            result += VectorKernels::dot(readBlock(op1, start, count, buffer1), readBlock(op2, start, count, buffer2), count);
+        }
+
+        return result;
+    }
+
+    // Same as VectorKernels::distance but for operands with compact coordinates
+    double blockedDistance(IVector const* op1, IVector const* op2, IVector::NORM n, double bound)
+    {
+        const size_t blockSize = CompactVectorImpl::blockSize;
+        double buffer1[blockSize], buffer2[blockSize];
+        const double partialBound = n == IVector::NORM::SECOND ? bound * bound : bound;
+        double result = 0;
+
+        for (size_t start = 0; start < op1->getDim() && result < partialBound; start += blockSize)
+        {
+            const size_t count = std::min(blockSize, op1->getDim() - start);
+            double const* data1 = readBlock(op1, start, count, buffer1);
+            double const* data2 = readBlock(op2, start, count, buffer2);
+
+            switch (n)
+            {
+                case IVector::NORM::FIRST:
+                    result += VectorKernels::sumAbsDiff(data1, data2, count);
+                    break;
+                case IVector::NORM::SECOND:
+                    result += VectorKernels::sumSquaresDiff(data1, data2, count);
+                    break;
+                default:
+                    result = std::max(result, VectorKernels::maxAbsDiff(data1, data2, count));
+            }
+        }
+
+        return n == IVector::NORM::SECOND ? sqrt(result) : result;
+    }
+}
+
 RC IVector::setLogger(ILogger *const logger)
 {
+    FixedVectorBase::setLogger(logger);
+    CompactVectorImpl::setLogger(logger);
     return VectorImpl::setLogger(logger);
 }
 
 
 IVector *IVector::add(IVector const* const& op1, IVector const* const& op2)
 {
-    return AddAndSub(op1, op2, [] (double a, double b) { return a + b;});
+    return AddAndSub(op1, op2, 1);
 }
 
 IVector *IVector::sub(IVector const* const& op1, IVector const* const& op2)
 {
-    return AddAndSub(op1, op2, [] (double a, double b) { return a - b;});
+    return AddAndSub(op1, op2, -1);
+}
+
+RC IVector::axpy(double alpha, IVector const* const& x, IVector* const& y)
+{
+    if (!ValidChecker::isValidNumber(alpha))
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    using namespace VectorExpression;
+    RC rc = assign(y, alpha * vec(x) + vec(y));
+    if (rc != RC::SUCCESS)
+        VectorImpl::log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC IVector::axpby(double alpha, IVector const* const& x, double beta, IVector* const& y)
+{
+    if (!ValidChecker::isValidNumber(alpha) || !ValidChecker::isValidNumber(beta))
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    using namespace VectorExpression;
+    RC rc = assign(y, alpha * vec(x) + beta * vec(y));
+    if (rc != RC::SUCCESS)
+        VectorImpl::log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC IVector::scaleAdd(IVector* const& dest, double alpha, IVector const* const& x, IVector const* const& y)
+{
+    if (!ValidChecker::isValidNumber(alpha))
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    using namespace VectorExpression;
+    RC rc = assign(dest, alpha * vec(x) + vec(y));
+    if (rc != RC::SUCCESS)
+        VectorImpl::log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC IVector::combine(IVector* const& dest, double a, IVector const* const& x, double b, IVector const* const& y, IVector const* const& z)
+{
+    if (!ValidChecker::isValidNumber(a) || !ValidChecker::isValidNumber(b))
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    using namespace VectorExpression;
+    RC rc = assign(dest, a * vec(x) + b * vec(y) - vec(z));
+    if (rc != RC::SUCCESS)
+        VectorImpl::log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC IVector::linearCombination(IVector* const& dest, std::initializer_list<std::pair<double, IVector const*>> const& terms)
+{
+    if (!dest || terms.size() == 0)
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    const size_t dim = dest->getDim();
+    for (auto const& term : terms)
+    {
+        if (!term.second || !ValidChecker::isValidNumber(term.first))
+        {
+            VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::INVALID_ARGUMENT;
+        }
+
+        if (term.second->getDim() != dim)
+        {
+            VectorImpl::log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return RC::MISMATCHING_DIMENSIONS;
+        }
+    }
+
+    double* coords = dest->getMutableData();
+    if (!coords)
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    VectorKernels::Scratch scratch(dim);
+    double* result = scratch.data();
+
+    // Terms are accumulated block by block: every operand is read once and partial sums stay in cache.
+    // Compact terms are decoded one block at a time, getData() would decode the whole vector for every block
+    const size_t blockSize = CompactVectorImpl::blockSize;
+    double buffer[blockSize];
+    for (size_t start = 0; start < dim; start += blockSize)
+    {
+        const size_t count = std::min(blockSize, dim - start);
+        double* block = result + start;
+        auto term = terms.begin();
+
+        const double firstCoef = term->first;
+        const double* firstData = readBlock(term->second, start, count, buffer);
+        for (size_t i = 0; i < count; i++)
+            block[i] = firstCoef * firstData[i];
+
+        for (++term; term != terms.end(); ++term)
+        {
+            const double coef = term->first;
+            const double* data = readBlock(term->second, start, count, buffer);
+            for (size_t i = 0; i < count; i++)
+                block[i] += coef * data[i];
+        }
+    }
+
+    if (!VectorKernels::isFinite(result, dim))
+    {
+        VectorImpl::log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INFINITY_OVERFLOW;
+    }
+
+    memcpy(coords, result, dim * sizeof(double));
+    return RC::SUCCESS;
 }
 
 IVector* IVector::createVector(size_t dim, const double* const& ptr_data)
+{
+    return createVector(dim, ptr_data, nullptr);
+}
+
+IVector* IVector::createVector(size_t dim, const double* const& ptr_data, IVectorArena* const& arena)
 {
     if ((int)dim <= 0)
     {
@@ -38,17 +261,37 @@ IVector* IVector::createVector(size_t dim, const double* const& ptr_data)
     }
 
 
-    for (size_t i = 0; i < dim; i++)
+    if (!VectorKernels::isFinite(ptr_data, dim))
     {
-        if (!ValidChecker::isValidNumber(ptr_data[i]))
-        {
-            VectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return nullptr;
-        }
+        VectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    IVector* fixed = nullptr;
+    bool isFixed = true;
+
+    // Small dimensions used most often get vectors without runtime dimension
+    switch (dim)
+    {
+        case 2: fixed = createFixedVector<2>(ptr_data, arena); break;
+        case 3: fixed = createFixedVector<3>(ptr_data, arena); break;
+        case 4: fixed = createFixedVector<4>(ptr_data, arena); break;
+        case 8: fixed = createFixedVector<8>(ptr_data, arena); break;
+        default: isFixed = false;
+    }
+
+    if (isFixed)
+    {
+        if (!fixed)
+            VectorImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+        return fixed;
     }
 
     const size_t _size = sizeof(VectorImpl) + dim * sizeof(double);
-    uint8_t* pInstance = new (std::nothrow)uint8_t[_size];
+    auto* pInstance = static_cast<uint8_t*>(arena
+        ? arena->allocate(_size, sizeof(VectorImpl))
+        : VectorAllocator::allocate(_size, sizeof(VectorImpl)));
 
     if (!pInstance)
     {
@@ -64,27 +307,55 @@ IVector* IVector::createVector(size_t dim, const double* const& ptr_data)
     return new(pInstance)VectorImpl(dim);
 }
 
+IVector* IVector::createVector(size_t dim, const double* const& ptr_data, PRECISION precision)
+{
+    if (precision == PRECISION::DOUBLE)
+        return createVector(dim, ptr_data);
+
+    if ((int)dim <= 0 || !ptr_data)
+    {
+        CompactVectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    if (!VectorKernels::isFinite(ptr_data, dim))
+    {
+        CompactVectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    const size_t size = sizeof(CompactVectorImpl) + dim * CompactVectorImpl::elementSize(precision);
+    void* pInstance = VectorAllocator::allocate(size, sizeof(CompactVectorImpl));
+    if (!pInstance)
+    {
+        CompactVectorImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    auto* vector = new(pInstance) CompactVectorImpl(dim, precision);
+    if (vector->setData(dim, ptr_data) != RC::SUCCESS)
+    {
+        delete vector;
+        return nullptr;
+    }
+
+    return vector;
+}
+
 double IVector::dot(IVector const* const& op1, IVector const* const& op2) {
 
     if (!op1 || !op2 || op1->getDim() != op2->getDim())
         return std::numeric_limits<double>::quiet_NaN();
 
 
-    double result = 0, left, right, result_tmp;
-    const double dim = op1->getDim();
+    const double result = hasCompact(op1, op2)
+        ? blockedDot(op1, op2)
+        : VectorKernels::dot(op1->getData(), op2->getData(), op1->getDim());
 
-    double const * data1 = op1->getData();
-    double const * data2 = op2->getData();
-
-    for (size_t i = 0; i < dim; i++)
+    if (!ValidChecker::isValidNumber(result))
     {
-        result += data1[i] * data2[i];
-
-        if (!ValidChecker::isValidNumber(result))
-        {
-            VectorImpl::log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return std::numeric_limits<double>::quiet_NaN();
-        }
+        VectorImpl::log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
     }
 
     return result;
@@ -104,26 +375,53 @@ bool IVector::equals(IVector const* const& op1, IVector const* const& op2, NORM
         return false;
     }
 
-    IVector* deltaVector = IVector::sub(op1, op2);
+    const double deltaNorm = hasCompact(op1, op2)
+        ? blockedDistance(op1, op2, n, tol)
+        : VectorKernels::distance(op1->getData(), op2->getData(), op1->getDim(), n, tol);
 
-    if (!deltaVector)
+    if (std::isnan(deltaNorm))
     {
-        VectorImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        VectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return false;
     }
 
-    const double deltaNorm = fabs(deltaVector->norm(n));
+    return deltaNorm < tol;
+}
 
-    if (std::isnan(deltaNorm))
+double IVector::distance(IVector const* const& op1, IVector const* const& op2, NORM n)
+{
+    return distance(op1, op2, n, std::numeric_limits<double>::infinity());
+}
+
+double IVector::distance(IVector const* const& op1, IVector const* const& op2, NORM n, double bound)
+{
+    if (!op1 || !op2 || n == NORM::AMOUNT || std::isnan(bound))
     {
-        delete deltaVector;
-        VectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-        return false;
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
     }
 
-    delete deltaVector;
+    if (op1->getDim() != op2->getDim())
+    {
+        VectorImpl::log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
 
-    return deltaNorm < tol;
+    const double result = hasCompact(op1, op2)
+        ? blockedDistance(op1, op2, n, bound)
+        : VectorKernels::distance(op1->getData(), op2->getData(), op1->getDim(), n, bound);
+
+    if (!ValidChecker::isValidNumber(result))
+    {
+        // Difference of valid coordinates may still overflow, for bounded search it just means "too far"
+        if (result > bound)
+            return result;
+
+        VectorImpl::log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return result;
 }
 
 RC IVector::copyInstance(IVector* const dest, IVector const* const& src)
@@ -134,13 +432,27 @@ RC IVector::copyInstance(IVector* const dest, IVector const* const& src)
         return RC::NULLPTR_ERROR;
     }
 
+    // Views don't own their coordinates, copying view object bytes means nothing
+    if (dynamic_cast<IVectorView const*>(dest) || dynamic_cast<IVectorView const*>(src))
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    // Instances of different precision or dimension have different sizes, raw copy is valid only for equal ones
+    if (dest->sizeAllocated() != src->sizeAllocated())
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
     if (abs(reinterpret_cast<uint8_t*>(dest) - reinterpret_cast<uint8_t const*>(src)) < src->sizeAllocated())
     {
-        VectorImpl::log(RC::UNKNOWN, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-        return RC::UNKNOWN;
+        VectorImpl::log(RC::MEMORY_INTERSECTION, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MEMORY_INTERSECTION;
     }
 
-    memcpy((void*)dest, (void*)src, src->sizeAllocated());
+    VectorKernels::copy((void*)dest, (void const*)src, src->sizeAllocated());
 
     return RC::SUCCESS;
 }
@@ -152,20 +464,26 @@ RC IVector::moveInstance(IVector* const dest, IVector*& src)
         VectorImpl::log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
         return RC::NULLPTR_ERROR;
     }
-    memmove((void*)dest, (void*)src, src->sizeAllocated());
 
-    delete src;
-    src = nullptr;
-    return RC::SUCCESS;
-}
+    if (dynamic_cast<IVectorView const*>(dest) || dynamic_cast<IVectorView const*>(src))
+    {
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
 
-RC IVector::moveInstance(IVector *const dest, const IVector *&src) {
-    if (src == nullptr || dest == nullptr)
+    if (dest->sizeAllocated() != src->sizeAllocated())
     {
-        VectorImpl::log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-        return RC::NULLPTR_ERROR;
+        VectorImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
     }
-    memmove((void*)dest, (void*)src, src->sizeAllocated());
+
+    if (abs(reinterpret_cast<uint8_t*>(dest) - reinterpret_cast<uint8_t const*>(src)) < src->sizeAllocated())
+    {
+        VectorImpl::log(RC::MEMORY_INTERSECTION, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MEMORY_INTERSECTION;
+    }
+
+    VectorKernels::copy((void*)dest, (void const*)src, src->sizeAllocated());
 
     delete src;
     src = nullptr;
@@ -0,0 +1,20 @@
+#include "../include/IVectorArena.h"
+#include "VectorArenaImpl.cpp"
+
+IVectorArena* IVectorArena::createArena(size_t chunkSize)
+{
+    if (chunkSize == 0)
+    {
+        VectorArenaImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    return new (std::nothrow)VectorArenaImpl(chunkSize);
+}
+
+RC IVectorArena::setLogger(ILogger* const logger)
+{
+    return VectorArenaImpl::setLogger(logger);
+}
+
+IVectorArena::~IVectorArena() = default;
@@ -0,0 +1,116 @@
+#include "../include/IVectorBatch.h"
+#include "VectorBatchImpl.cpp"
+
+namespace {
+    VectorBatchImpl* allocateBatch(size_t dim, size_t count, IVectorBatch::LAYOUT layout)
+    {
+        if (dim == 0 || count == 0 || count > std::numeric_limits<size_t>::max() / sizeof(double) / dim)
+        {
+            VectorBatchImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return nullptr;
+        }
+
+        auto* data = new (std::nothrow) double[dim * count]();
+        if (!data)
+        {
+            VectorBatchImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return nullptr;
+        }
+
+        auto* batch = new (std::nothrow) VectorBatchImpl(dim, count, layout, data);
+        if (!batch)
+        {
+            delete[] data;
+            VectorBatchImpl::log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        }
+
+        return batch;
+    }
+}
+
+IVectorBatch* IVectorBatch::createBatch(size_t dim, size_t count, LAYOUT layout)
+{
+    return allocateBatch(dim, count, layout);
+}
+
+IVectorBatch* IVectorBatch::createBatch(size_t dim, size_t count, double const* const& rows, LAYOUT layout)
+{
+    if (!rows)
+    {
+        VectorBatchImpl::log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    if (!VectorKernels::isFinite(rows, dim * count))
+    {
+        VectorBatchImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    VectorBatchImpl* batch = allocateBatch(dim, count, layout);
+    if (batch)
+        batch->importRows(rows);
+
+    return batch;
+}
+
+IVectorBatch* IVectorBatch::createBatch(IVector const* const* const& vectors, size_t count, LAYOUT layout)
+{
+    if (!vectors || count == 0 || !vectors[0])
+    {
+        VectorBatchImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    VectorBatchImpl* batch = allocateBatch(vectors[0]->getDim(), count, layout);
+    for (size_t i = 0; batch && i < count; i++)
+    {
+        if (batch->setRow(i, vectors[i]) != RC::SUCCESS)
+        {
+            delete batch;
+            batch = nullptr;
+        }
+    }
+
+    return batch;
+}
+
+IVectorBatch* IVectorBatch::createBatch(ISet const* const& set, LAYOUT layout)
+{
+    if (!set)
+    {
+        VectorBatchImpl::log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    if (set->getSize() == 0)
+    {
+        VectorBatchImpl::log(RC::SOURCE_SET_EMPTY, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    IVectorView* view = nullptr;
+    if (set->getView(0, view) != RC::SUCCESS)
+        return nullptr;
+
+    // Vectors are read through one view, nothing is allocated per vector
+    VectorBatchImpl* batch = allocateBatch(set->getDim(), set->getSize(), layout);
+    for (size_t i = 0; batch && i < set->getSize(); i++)
+    {
+        if (set->rebindView(i, view) != RC::SUCCESS || batch->setRow(i, view) != RC::SUCCESS)
+        {
+            delete batch;
+            batch = nullptr;
+        }
+    }
+
+    delete view;
+    return batch;
+}
+
+RC IVectorBatch::setLogger(ILogger* const logger)
+{
+    return VectorBatchImpl::setLogger(logger);
+}
+
+IVectorBatch::~IVectorBatch() = default;
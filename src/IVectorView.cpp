@@ -0,0 +1,31 @@
+#include "../include/IVectorView.h"
+#include "VectorViewImpl.cpp"
+#include <new>
+
+IVectorView* IVectorView::createView(size_t dim, double const* const& ptr_data, Epoch const& epoch)
+{
+    if (dim == 0 || !ptr_data)
+    {
+        VectorViewImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    // Read-only view never writes through the pointer
+    return new (std::nothrow)VectorViewImpl(dim, const_cast<double*>(ptr_data), false, epoch);
+}
+
+IVectorView* IVectorView::createMutableView(size_t dim, double* const& ptr_data, Epoch const& epoch)
+{
+    if (dim == 0 || !ptr_data)
+    {
+        VectorViewImpl::log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    return new (std::nothrow)VectorViewImpl(dim, ptr_data, true, epoch);
+}
+
+RC IVectorView::setLogger(ILogger* const logger)
+{
+    return VectorViewImpl::setLogger(logger);
+}
@@ -0,0 +1,240 @@
+#ifndef IVECTOR_KDTREE_H
+#define IVECTOR_KDTREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "../include/IVector.h"
+#include "../include/VectorKernels.h"
+#include "CowChunks.cpp"
+
+namespace {
+    /*
+    * Nearest neighbour search over rows of a set.
+    *
+    * Best results are kept in a bounded max-heap stored in caller's buffers, ordered by distance and then
+    * by slot, so results don't depend on the tree shape and queries allocate nothing. Every norm is at least
+    * the largest coordinate difference, so a subtree is skipped when pattern is farther from its splitting
+    * plane than the current bound
+    */
+    class NearestQuery {
+    public:
+        // capacity is the size of slots and distances, radius bounds distances (strictly less)
+        NearestQuery(double const* pat, size_t dim, IVector::NORM n, double radius, size_t capacity,
+                     size_t* slots, double* distances, bool countAll) :
+            _pat(pat), _dim(dim), _norm(n), _radius(radius), _capacity(capacity), _slots(slots),
+            _distances(distances), _countAll(countAll)
+        {}
+
+        void visit(double const* row, size_t slot)
+        {
+            _visited++;
+            const double bound = _size == _capacity && _capacity != 0 ? std::min(_radius, _distances[0]) : _radius;
+            // Rows at distance bound still win over the heap top if their slot is smaller, so one ulp more is asked
+            const double distance = VectorKernels::distance(_pat, row, _dim, _norm,
+                                                            _countAll ? _radius : std::nextafter(bound, std::numeric_limits<double>::infinity()));
+            if (!(distance < _radius))
+                return;
+
+            _matches++;
+            if (_size < _capacity)
+            {
+                _slots[_size] = slot;
+                _distances[_size] = distance;
+                siftUp(_size++);
+            }
+            else if (_capacity != 0 && isBefore(distance, slot, _distances[0], _slots[0]))
+            {
+                _slots[0] = slot;
+                _distances[0] = distance;
+                siftDown(0, _size);
+            }
+        }
+
+        // Subtrees at least this far from the pattern can't change the result
+        double pruneBound() const
+        {
+            const double bound = _countAll || _size < _capacity ? _radius : std::min(_radius, _distances[0]);
+            return bound * (1 + 4 * std::numeric_limits<double>::epsilon());
+        }
+
+        double const* pattern() const { return _pat; }
+
+        // Sorts the heap nearest first and returns its size
+        size_t finish()
+        {
+            for (size_t end = _size; end > 1; end--)
+            {
+                swapEntries(0, end - 1);
+                siftDown(0, end - 1);
+            }
+
+            return _size;
+        }
+
+        // Rows within radius, may be more than capacity if countAll
+        size_t getMatches() const { return _matches; }
+        size_t getVisited() const { return _visited; }
+
+    private:
+        double const* _pat;
+        size_t _dim;
+        IVector::NORM _norm;
+        double _radius;
+        size_t _capacity;
+        size_t* _slots;
+        double* _distances;
+        bool _countAll;
+        size_t _size = 0;
+        size_t _matches = 0;
+        size_t _visited = 0;
+
+        static bool isBefore(double distance1, size_t slot1, double distance2, size_t slot2)
+        {
+            return distance1 < distance2 || (distance1 == distance2 && slot1 < slot2);
+        }
+
+        bool isBefore(size_t i, size_t j) const
+        {
+            return isBefore(_distances[i], _slots[i], _distances[j], _slots[j]);
+        }
+
+        void swapEntries(size_t i, size_t j)
+        {
+            std::swap(_slots[i], _slots[j]);
+            std::swap(_distances[i], _distances[j]);
+        }
+
+        void siftUp(size_t i)
+        {
+            while (i != 0 && isBefore((i - 1) / 2, i))
+            {
+                swapEntries(i, (i - 1) / 2);
+                i = (i - 1) / 2;
+            }
+        }
+
+        void siftDown(size_t i, size_t size)
+        {
+            while (true)
+            {
+                size_t largest = i;
+                const size_t left = 2 * i + 1, right = 2 * i + 2;
+                if (left < size && isBefore(largest, left))
+                    largest = left;
+                if (right < size && isBefore(largest, right))
+                    largest = right;
+                if (largest == i)
+                    return;
+
+                swapEntries(i, largest);
+                i = largest;
+            }
+        }
+    };
+
+    /*
+    * k-d tree over live rows: nodes split at the median of the coordinate with the largest spread,
+    * leaves hold up to leafSize rows. The tree keeps slots only, rows are passed to every query,
+    * so it has to be built again after rows change or move
+    */
+    class KdTree {
+    public:
+        static constexpr size_t leafSize = 16;
+
+        // Removed rows (NaN) are skipped, throws std::bad_alloc
+        KdTree(CowChunks<double> const& rows, size_t slots) : _dim(rows.getWidth())
+        {
+            _order.reserve(slots);
+            for (size_t slot = 0; slot < slots; slot++)
+            {
+                if (!std::isnan(rows.at(slot)[0]))
+                    _order.push_back(slot);
+            }
+
+            _nodes.reserve(2 * (_order.size() / leafSize + 1));
+            build(rows, 0, _order.size());
+        }
+
+        void search(CowChunks<double> const& rows, NearestQuery& query) const
+        {
+            search(rows, 0, query);
+        }
+
+    private:
+        struct Node {
+            size_t begin;
+            size_t end;
+            // 0 for leaves, root is never a child
+            size_t left = 0;
+            size_t right = 0;
+            size_t axis = 0;
+            double split = 0;
+        };
+
+        size_t _dim;
+        std::vector<size_t> _order;
+        std::vector<Node> _nodes;
+
+        size_t build(CowChunks<double> const& rows, size_t begin, size_t end)
+        {
+            const size_t node = _nodes.size();
+            _nodes.push_back(Node{begin, end});
+            if (end - begin <= leafSize)
+                return node;
+
+            size_t axis = 0;
+            double spread = -1;
+            for (size_t j = 0; j < _dim; j++)
+            {
+                double low = std::numeric_limits<double>::infinity(), high = -low;
+                for (size_t i = begin; i < end; i++)
+                {
+                    low = std::min(low, rows.at(_order[i])[j]);
+                    high = std::max(high, rows.at(_order[i])[j]);
+                }
+
+                if (high - low > spread)
+                {
+                    spread = high - low;
+                    axis = j;
+                }
+            }
+
+            // Rows before mid are not greater than split, rows from mid are not less
+            const size_t mid = begin + (end - begin) / 2;
+            std::nth_element(_order.begin() + begin, _order.begin() + mid, _order.begin() + end,
+                             [&](size_t slot1, size_t slot2) { return rows.at(slot1)[axis] < rows.at(slot2)[axis]; });
+
+            _nodes[node].axis = axis;
+            _nodes[node].split = rows.at(_order[mid])[axis];
+            const size_t left = build(rows, begin, mid);
+            const size_t right = build(rows, mid, end);
+            _nodes[node].left = left;
+            _nodes[node].right = right;
+            return node;
+        }
+
+        void search(CowChunks<double> const& rows, size_t index, NearestQuery& query) const
+        {
+            Node const& node = _nodes[index];
+            if (node.left == 0)
+            {
+                for (size_t i = node.begin; i < node.end; i++)
+                    query.visit(rows.at(_order[i]), _order[i]);
+
+                return;
+            }
+
+            const double gap = query.pattern()[node.axis] - node.split;
+            search(rows, gap < 0 ? node.left : node.right, query);
+            if (std::fabs(gap) <= query.pruneBound())
+                search(rows, gap < 0 ? node.right : node.left, query);
+        }
+    };
+}
+
+#endif //IVECTOR_KDTREE_H
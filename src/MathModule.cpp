@@ -1,35 +1,27 @@
 #include "../include/MathModule.h"
 
 
-IVector* AddAndSub(const IVector *op1, const IVector *op2, const std::function<double(double, double)>& func)
+IVector* AddAndSub(const IVector *op1, const IVector *op2, double sign)
 {
     if (!op1 || !op2 || op1->getDim() != op2->getDim())
         return nullptr;
 
-    const double dim = op1->getDim();
-    double result;
     IVector* resultInstance = op1->clone();
 
     if (!resultInstance)
         return nullptr;
 
-    const double* data1 = op1->getData();
-    const double* data2 = op2->getData();
-    auto* ptr = (double*)((uint8_t*)resultInstance + sizeof(VectorImpl));
+    // Compact vectors have no in-place double coordinates for assign(), they use their own inc/dec
+    using namespace VectorExpression;
+    RC rc = resultInstance->getPrecision() == IVector::PRECISION::DOUBLE
+        ? IVector::assign(resultInstance, vec(op1) + sign * vec(op2))
+        : (sign > 0 ? resultInstance->inc(op2) : resultInstance->dec(op2));
 
-    for (size_t i = 0; i < dim; i++)
+    if (rc != RC::SUCCESS)
     {
-        result = func(data1[i], data2[i]);
-
-        if (fabs(result) == std::numeric_limits<double>::infinity())
-        {
-            VectorImpl::log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            delete resultInstance;
-            resultInstance = nullptr;
-            return nullptr;
-        }
-
-        ptr[i] = result;
+        VectorImpl::log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        delete resultInstance;
+        return nullptr;
     }
 
     return resultInstance;
@@ -0,0 +1,151 @@
+#ifndef IVECTOR_SETSNAPSHOT_H
+#define IVECTOR_SETSNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include "../include/RC.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define IVECTOR_HAS_MMAP
+#endif
+
+namespace {
+    /*
+    * File layout of ISet::save(), all numbers in native byte order:
+    * - SnapshotHeader;
+    * - unique index of every vector, uint64_t each, increasing;
+    * - zero padding up to dataOffset, a multiple of snapshotAlignment;
+    * - coordinates of the vectors, dim doubles each, in the order of indexes.
+    * Removed vectors aren't written, so the rows have no gaps
+    */
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        // snapshotByteOrder as written, a file from a machine with other byte order doesn't match it
+        uint32_t byteOrder;
+        uint64_t headerBytes;
+        uint64_t dim;
+        uint64_t size;
+        // Unique index of the next inserted vector
+        uint64_t nextIndex;
+        uint64_t dataOffset;
+        double separation[3];
+    };
+
+    const char snapshotMagic[8] = {'I', 'S', 'E', 'T', 'S', 'N', 'A', 'P'};
+    const uint32_t snapshotVersion = 1;
+    const uint32_t snapshotByteOrder = 0x01020304;
+    // Page size, so rows may be mapped and start on a cache line
+    const size_t snapshotAlignment = 4096;
+
+    inline size_t snapshotDataOffset(size_t size)
+    {
+        const size_t end = sizeof(SnapshotHeader) + size * sizeof(uint64_t);
+        return (end + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+    }
+
+    /*
+    * Whole file mapped privately for reading and writing: pages are read on first access, the first write
+    * to a page copies it, and nothing is ever written back to the file.
+    * Without mmap the file is read into memory instead
+    */
+    class MappedFile {
+    public:
+        // nullptr and code set if the file can't be opened or read
+        static MappedFile* open(char const* const& path, RC& code)
+        {
+            auto* file = new (std::nothrow) MappedFile;
+            if (!file)
+            {
+                code = RC::ALLOCATION_ERROR;
+                return nullptr;
+            }
+
+            code = file->load(path);
+            if (code != RC::SUCCESS)
+            {
+                delete file;
+                return nullptr;
+            }
+
+            return file;
+        }
+
+        char* data() const { return _address; }
+        size_t size() const { return _bytes; }
+
+        ~MappedFile()
+        {
+#ifdef IVECTOR_HAS_MMAP
+            if (_address)
+                munmap(_address, _bytes);
+#else
+            delete[] reinterpret_cast<double*>(_address);
+#endif
+        }
+
+    private:
+        char* _address = nullptr;
+        size_t _bytes = 0;
+
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef IVECTOR_HAS_MMAP
+        RC load(char const* const& path)
+        {
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return RC::FILE_NOT_FOUND;
+
+            struct stat info;
+            RC code = RC::SUCCESS;
+            if (fstat(fd, &info) != 0 || info.st_size <= 0)
+                code = RC::IO_ERROR;
+            else
+            {
+                _bytes = (size_t)info.st_size;
+                void* address = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (address == MAP_FAILED)
+                    code = RC::IO_ERROR;
+                else
+                    _address = static_cast<char*>(address);
+            }
+
+            // Mapping stays valid after the descriptor is closed
+            close(fd);
+            return code;
+        }
+#else
+        RC load(char const* const& path)
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file.is_open())
+                return RC::FILE_NOT_FOUND;
+
+            const std::streamoff bytes = file.tellg();
+            if (bytes <= 0)
+                return RC::IO_ERROR;
+
+            // double buffer keeps rows aligned
+            _bytes = (size_t)bytes;
+            _address = reinterpret_cast<char*>(new (std::nothrow) double[(_bytes + sizeof(double) - 1) / sizeof(double)]);
+            if (!_address)
+                return RC::ALLOCATION_ERROR;
+
+            file.seekg(0);
+            return file.read(_address, bytes) ? RC::SUCCESS : RC::IO_ERROR;
+        }
+#endif
+    };
+}
+
+#endif //IVECTOR_SETSNAPSHOT_H
@@ -0,0 +1,108 @@
+#ifndef IVECTOR_SLOTRANKS_H
+#define IVECTOR_SLOTRANKS_H
+
+#include <algorithm>
+#include <cstddef>
+#include "CowChunks.cpp"
+
+namespace {
+    /*
+    * Live flags of set slots in a Fenwick tree: position of the k-th live slot and number of live slots
+    * before a slot both cost O(log n), so removed slots can stay in place until compaction.
+    * Tree is kept in shared chunks like the rows, a copy costs a pointer per chunk and a removal copies
+    * at most O(log n) of them
+    */
+    class SlotRanks {
+    public:
+        // count live slots, false if there is no memory
+        bool reset(size_t count)
+        {
+            CowChunks<size_t> tree;
+            if (!tree.reserve(count + 1))
+                return false;
+
+            tree.resize(count + 1);
+            for (size_t i = 0; i <= count; i++)
+                *tree.mutableAt(i) = i & (~i + 1);
+
+            _tree = std::move(tree);
+            return true;
+        }
+
+        // Room for slots slots, so that pushLive() can't fail
+        bool reserve(size_t slots)
+        {
+            return _tree.reserve(slots + 1);
+        }
+
+        void pushLive()
+        {
+            // Position 0 is never read, an empty tree gets it with the first slot
+            const size_t i = std::max<size_t>(_tree.size(), 1);
+            const size_t low = i & (~i + 1);
+            const size_t count = 1 + prefix(i - 1) - prefix(i - low);
+            _tree.resize(i + 1);
+            *_tree.mutableAt(i) = count;
+        }
+
+        // Copies shared chunks kill(slot) writes to, false if there is no memory for them
+        bool prepareKill(size_t slot)
+        {
+            for (size_t i = slot + 1; i < _tree.size(); i += i & (~i + 1))
+            {
+                if (!_tree.mutableAt(i))
+                    return false;
+            }
+
+            return true;
+        }
+
+        // prepareKill(slot) must have succeeded on this copy of the ranks
+        void kill(size_t slot)
+        {
+            for (size_t i = slot + 1; i < _tree.size(); i += i & (~i + 1))
+                (*_tree.mutableAt(i))--;
+        }
+
+        // Live slots in [0, slot)
+        size_t rank(size_t slot) const
+        {
+            return prefix(slot);
+        }
+
+        // Slot of the k-th live slot, k counts from 0 and must be less than the number of live slots
+        size_t select(size_t k) const
+        {
+            size_t step = 1;
+            while (step * 2 < _tree.size())
+                step *= 2;
+
+            size_t pos = 0;
+            for (; step != 0; step /= 2)
+            {
+                if (pos + step < _tree.size() && _tree[pos + step] <= k)
+                {
+                    pos += step;
+                    k -= _tree[pos];
+                }
+            }
+
+            return pos;
+        }
+
+    private:
+        // _tree[i] counts live slots in (i - lowbit(i), i], slot s is position s + 1
+        CowChunks<size_t> _tree;
+
+        size_t prefix(size_t count) const
+        {
+            size_t result = 0;
+            for (size_t i = count; i != 0; i -= i & (~i + 1))
+                result += _tree[i];
+
+            return result;
+        }
+    };
+}
+
+#endif //IVECTOR_SLOTRANKS_H
@@ -0,0 +1,286 @@
+#ifndef IVECTOR_TOLERANCEINDEX_H
+#define IVECTOR_TOLERANCEINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+#include "../include/IVector.h"
+#include "../include/VectorKernels.h"
+#include "CowChunks.cpp"
+
+namespace {
+    /*
+    * Index of rows of a set for "is there a row within tol of pat" queries.
+    *
+    * Index returns candidates, caller checks them with exact distance. Any row within tol under CHEBYSHEV,
+    * FIRST or SECOND norm has every coordinate within tol of pat (Chebyshev norm is the smallest of them),
+    * so index only has to return every row inside that box
+    */
+    class ToleranceIndex {
+    public:
+        virtual void insert(size_t slot, double const* row) = 0;
+        // Slots of other rows don't change, compaction builds a new index
+        virtual void erase(size_t slot, double const* row) = 0;
+
+        /*
+        * Appends to out every slot that may be within tol of pat under n (approximate indexes may miss some).
+        * Returns false if index can't do better than all rows, out is incomplete then
+        */
+        virtual bool candidates(double const* pat, IVector::NORM n, double tol, std::vector<size_t>& out) const = 0;
+
+        // Copy shares buckets with the index until one of them changes, nullptr if there is no memory for it
+        virtual ToleranceIndex* clone() const = 0;
+
+        virtual ~ToleranceIndex() = default;
+    };
+
+    /*
+    * Uniform grid over the first few coordinates, cell size is the tolerance the index was built for.
+    * Queries with other tolerances are exact too, they just visit more or fewer cells
+    */
+    class GridIndex : public ToleranceIndex {
+    public:
+        static constexpr size_t maxKeyDims = 3;
+
+        GridIndex(size_t dim, double cellSize) :
+            _keyDims(dim < maxKeyDims ? dim : maxKeyDims), _cellSize(cellSize)
+        {}
+
+        void insert(size_t slot, double const* row) override
+        {
+            _cells.add(keyOf(row), slot);
+            _count++;
+        }
+
+        void erase(size_t slot, double const* row) override
+        {
+            _cells.remove(keyOf(row), slot);
+            _count--;
+        }
+
+        ToleranceIndex* clone() const override
+        {
+            try
+            {
+                return new GridIndex(*this);
+            }
+            catch (std::bad_alloc const&)
+            {
+                return nullptr;
+            }
+        }
+
+        bool candidates(double const* pat, IVector::NORM, double tol, std::vector<size_t>& out) const override
+        {
+            Key low, high;
+            double cellsInBox = 1;
+
+            for (size_t j = 0; j < _keyDims; j++)
+            {
+                // Box is widened by a few ulps, so rounding in the distance kernels can't put a match outside it
+                const double radius = tol * (1 + 4 * std::numeric_limits<double>::epsilon());
+                low.cell[j] = cellOf(std::nextafter(pat[j] - radius, -std::numeric_limits<double>::infinity()));
+                high.cell[j] = cellOf(std::nextafter(pat[j] + radius, std::numeric_limits<double>::infinity()));
+                cellsInBox *= (double)(high.cell[j] - low.cell[j]) + 1;
+            }
+
+            // Visiting empty cells one by one would cost more than looking at every row
+            if (cellsInBox > (double)_count)
+                return false;
+
+            Key key = low;
+            while (true)
+            {
+                if (std::vector<size_t> const* cell = _cells.find(key))
+                    out.insert(out.end(), cell->begin(), cell->end());
+
+                size_t j = 0;
+                for (; j < _keyDims && key.cell[j] == high.cell[j]; j++)
+                    key.cell[j] = low.cell[j];
+
+                if (j == _keyDims)
+                    break;
+
+                key.cell[j]++;
+            }
+
+            return true;
+        }
+
+    private:
+        struct Key {
+            int64_t cell[maxKeyDims] = {};
+
+            bool operator==(Key const& other) const
+            {
+                return memcmp(cell, other.cell, sizeof(cell)) == 0;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(Key const& key) const
+            {
+                uint64_t hash = 1469598103934665603ULL;
+                for (int64_t cell : key.cell)
+                    hash = (hash ^ (uint64_t)cell) * 1099511628211ULL;
+
+                return (size_t)hash;
+            }
+        };
+
+        size_t _keyDims;
+        double _cellSize;
+        size_t _count = 0;
+        CowBuckets<Key, KeyHash> _cells;
+
+        // Monotonic in val, far cells are clamped together, which keeps queries exact
+        int64_t cellOf(double val) const
+        {
+            const double limit = 4e18;
+            const double cell = std::floor(val / _cellSize);
+            return (int64_t)std::max(-limit, std::min(limit, cell));
+        }
+
+        Key keyOf(double const* row) const
+        {
+            Key key;
+            for (size_t j = 0; j < _keyDims; j++)
+                key.cell[j] = cellOf(row[j]);
+
+            return key;
+        }
+    };
+
+    /*
+    * Locality-sensitive hashing for vectors with many coordinates, where grid cells are almost always empty.
+    *
+    * Each table hashes a vector with hashesPerTable functions floor((value + offset) / width). For SECOND and FIRST
+    * value is a projection on a random direction with Gaussian (2-stable) or Cauchy (1-stable) coordinates:
+    * projections of two vectors differ by their distance times a variable of the same law, so near vectors get
+    * equal values much more often than far ones. CHEBYSHEV takes a random coordinate instead. Candidates are the
+    * vectors sharing a bucket with the pattern in any table, so a near vector is found with high probability only:
+    * more tables raise recall, more hashes per table make buckets smaller and lookups faster.
+    * Index is built for one norm and tolerance: other norms and larger tolerances get no candidates and are answered
+    * by a scan, smaller tolerances find a near vector at least as often as the one the index was built for
+    */
+    class LshIndex : public ToleranceIndex {
+    public:
+        // width is in tolerances, throws std::bad_alloc
+        LshIndex(size_t dim, double tol, IVector::NORM n, size_t tables, size_t hashesPerTable, double width, uint64_t seed) :
+            _dim(dim), _hashes(hashesPerTable), _tol(tol), _width(width * tol), _norm(n), _buckets(tables)
+        {
+            const size_t functions = tables * hashesPerTable;
+            std::mt19937_64 random(seed);
+            std::uniform_real_distribution<double> offset(0, _width);
+            std::normal_distribution<double> gauss;
+            std::cauchy_distribution<double> cauchy;
+            std::uniform_int_distribution<size_t> coordinate(0, dim - 1);
+
+            auto generated = std::make_shared<Functions>();
+            generated->offsets.resize(functions);
+            if (n == IVector::NORM::CHEBYSHEV)
+                generated->coordinates.resize(functions);
+            else
+                generated->directions.resize(functions * dim);
+
+            for (size_t i = 0; i < functions; i++)
+            {
+                generated->offsets[i] = offset(random);
+                if (n == IVector::NORM::CHEBYSHEV)
+                    generated->coordinates[i] = coordinate(random);
+                else
+                {
+                    for (size_t j = 0; j < dim; j++)
+                        generated->directions[i * dim + j] = n == IVector::NORM::SECOND ? gauss(random) : cauchy(random);
+                }
+            }
+
+            _functions = std::move(generated);
+        }
+
+        void insert(size_t slot, double const* row) override
+        {
+            for (size_t table = 0; table < _buckets.size(); table++)
+                _buckets[table].add(hashOf(table, row), slot);
+        }
+
+        void erase(size_t slot, double const* row) override
+        {
+            for (size_t table = 0; table < _buckets.size(); table++)
+                _buckets[table].remove(hashOf(table, row), slot);
+        }
+
+        ToleranceIndex* clone() const override
+        {
+            try
+            {
+                return new LshIndex(*this);
+            }
+            catch (std::bad_alloc const&)
+            {
+                return nullptr;
+            }
+        }
+
+        bool candidates(double const* pat, IVector::NORM n, double tol, std::vector<size_t>& out) const override
+        {
+            // Buckets are too narrow for a larger tolerance, near vectors would be missed much more often
+            if (n != _norm || tol > _tol)
+                return false;
+
+            // A vector may share buckets with the pattern in several tables
+            const size_t start = out.size();
+            for (size_t table = 0; table < _buckets.size(); table++)
+            {
+                if (std::vector<size_t> const* bucket = _buckets[table].find(hashOf(table, pat)))
+                    out.insert(out.end(), bucket->begin(), bucket->end());
+            }
+
+            std::sort(out.begin() + start, out.end());
+            out.erase(std::unique(out.begin() + start, out.end()), out.end());
+            return true;
+        }
+
+    private:
+        // Function i of table t is t * _hashes + i
+        struct Functions {
+            std::vector<double> directions;
+            std::vector<size_t> coordinates;
+            std::vector<double> offsets;
+        };
+
+        size_t _dim;
+        size_t _hashes;
+        double _tol;
+        double _width;
+        IVector::NORM _norm;
+        // Never changed after construction, so copies of the index share it
+        std::shared_ptr<Functions const> _functions;
+        std::vector<CowBuckets<uint64_t, std::hash<uint64_t>>> _buckets;
+
+        // Buckets of different tuples may share a hash, that only adds candidates
+        uint64_t hashOf(size_t table, double const* row) const
+        {
+            const double limit = 4e18;
+            uint64_t hash = 1469598103934665603ULL;
+            for (size_t i = table * _hashes; i < (table + 1) * _hashes; i++)
+            {
+                const double value = _norm == IVector::NORM::CHEBYSHEV ? row[_functions->coordinates[i]] :
+                                     VectorKernels::dot(_functions->directions.data() + i * _dim, row, _dim);
+                const double cell = std::floor((value + _functions->offsets[i]) / _width);
+                hash = (hash ^ (uint64_t)(int64_t)std::max(-limit, std::min(limit, cell))) * 1099511628211ULL;
+            }
+
+            return hash;
+        }
+    };
+}
+
+#endif //IVECTOR_TOLERANCEINDEX_H
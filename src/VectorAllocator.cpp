@@ -0,0 +1,261 @@
+#include "../include/VectorAllocator.h"
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+    enum class Owner : uint32_t {
+        POOL,
+        ARENA,
+        HUGE_PAGES
+    };
+
+    // Instances are aligned by their coordinates, so header itself only needs alignment of size_t
+    struct BlockHeader {
+        size_t size;
+        uint32_t offset; // From the start of the raw block to the instance
+        Owner owner;
+    };
+
+    static_assert(sizeof(BlockHeader) == 16, "instanceOffset() relies on 16 bytes header");
+
+    // Free lists never keep more than this, the rest goes straight back to operator delete
+    const size_t maxBlocksPerClass = 64;
+    const size_t maxCachedBytes = 32 * 1024 * 1024;
+
+    const size_t hugePageSize = 2 * 1024 * 1024;
+
+    std::atomic<size_t> requests(0);
+    std::atomic<size_t> poolHits(0);
+    std::atomic<size_t> arenaHits(0);
+    std::atomic<size_t> systemAllocations(0);
+    std::atomic<size_t> systemReleases(0);
+    std::atomic<size_t> hugePageAllocations(0);
+
+    class ThreadCache {
+    public:
+        // Blocks of one size class also have one offset, so reused instances keep coordinates aligned
+        std::unordered_map<size_t, std::vector<BlockHeader*>> lists;
+        size_t cachedBytes = 0;
+
+        void release();
+
+        ~ThreadCache();
+    };
+
+    // Blocks freed while thread-local storage is being destroyed must bypass the cache
+    thread_local bool cacheDestroyed = false;
+    thread_local ThreadCache cache;
+
+    BlockHeader* header(void* instance)
+    {
+        return reinterpret_cast<BlockHeader*>(reinterpret_cast<uint8_t*>(instance) - sizeof(BlockHeader));
+    }
+
+    // Offset of the instance from the aligned start of its block: room for header and aligned coordinates
+    size_t instanceOffset(size_t dataOffset)
+    {
+        const size_t alignment = VectorAllocator::dataAlignment;
+        size_t offset = (alignment - dataOffset % alignment) % alignment;
+        while (offset < sizeof(BlockHeader))
+            offset += alignment;
+
+        return offset;
+    }
+
+    size_t cacheKey(size_t size, size_t offset)
+    {
+        return size * 2 * VectorAllocator::dataAlignment + offset;
+    }
+
+    size_t hugeMappingSize(size_t blockSize)
+    {
+        return (blockSize + hugePageSize - 1) / hugePageSize * hugePageSize;
+    }
+
+    void* mapHugePages(size_t length)
+    {
+#ifdef __linux__
+        // One extra huge page lets the mapping start on a huge page boundary, the rest is unmapped
+        const size_t mapped = length + hugePageSize;
+        void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            return nullptr;
+
+        const uintptr_t start = (reinterpret_cast<uintptr_t>(raw) + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1);
+        const size_t head = start - reinterpret_cast<uintptr_t>(raw);
+        if (head != 0)
+            munmap(raw, head);
+
+        const size_t tail = mapped - head - length;
+        if (tail != 0)
+            munmap(reinterpret_cast<void*>(start + length), tail);
+
+        // Transparent huge pages are advisory, mapping works without them too
+        madvise(reinterpret_cast<void*>(start), length, MADV_HUGEPAGE);
+        return reinterpret_cast<void*>(start);
+#else
+        (void)length;
+        return nullptr;
+#endif
+    }
+
+    void systemRelease(BlockHeader* block)
+    {
+        systemReleases.fetch_add(1, std::memory_order_relaxed);
+
+        uint8_t* raw = reinterpret_cast<uint8_t*>(block + 1) - block->offset;
+#ifdef __linux__
+        if (block->owner == Owner::HUGE_PAGES)
+        {
+            munmap(raw, hugeMappingSize(block->offset + block->size));
+            return;
+        }
+#endif
+        ::operator delete(raw, std::align_val_t(VectorAllocator::dataAlignment));
+    }
+
+    void* initBlock(uint8_t* raw, size_t size, size_t offset, Owner owner)
+    {
+        auto* instance = raw + offset;
+        BlockHeader* block = header(instance);
+        block->size = size;
+        block->offset = (uint32_t)offset;
+        block->owner = owner;
+        return instance;
+    }
+}
+
+void ThreadCache::release()
+{
+    for (auto& list : lists)
+    {
+        for (BlockHeader* block : list.second)
+            systemRelease(block);
+    }
+
+    lists.clear();
+    cachedBytes = 0;
+}
+
+ThreadCache::~ThreadCache()
+{
+    release();
+    cacheDestroyed = true;
+}
+
+void* VectorAllocator::allocate(size_t size, size_t dataOffset)
+{
+    requests.fetch_add(1, std::memory_order_relaxed);
+
+    const size_t offset = instanceOffset(dataOffset);
+    const size_t total = offset + size;
+
+    if (!cacheDestroyed && total < hugePageThreshold)
+    {
+        auto it = cache.lists.find(cacheKey(size, offset));
+        if (it != cache.lists.end() && !it->second.empty())
+        {
+            BlockHeader* block = it->second.back();
+            it->second.pop_back();
+            cache.cachedBytes -= size;
+            poolHits.fetch_add(1, std::memory_order_relaxed);
+            return block + 1;
+        }
+    }
+
+    if (total >= hugePageThreshold)
+    {
+        auto* raw = static_cast<uint8_t*>(mapHugePages(hugeMappingSize(total)));
+        if (raw)
+        {
+            systemAllocations.fetch_add(1, std::memory_order_relaxed);
+            hugePageAllocations.fetch_add(1, std::memory_order_relaxed);
+            return initBlock(raw, size, offset, Owner::HUGE_PAGES);
+        }
+    }
+
+    auto* raw = static_cast<uint8_t*>(::operator new(total, std::align_val_t(dataAlignment), std::nothrow));
+    if (!raw)
+        return nullptr;
+
+    systemAllocations.fetch_add(1, std::memory_order_relaxed);
+    return initBlock(raw, size, offset, Owner::POOL);
+}
+
+void VectorAllocator::deallocate(void* instance)
+{
+    if (!instance)
+        return;
+
+    BlockHeader* block = header(instance);
+
+    if (block->owner == Owner::ARENA)
+        return;
+
+    if (block->owner == Owner::HUGE_PAGES || cacheDestroyed || cache.cachedBytes + block->size > maxCachedBytes)
+    {
+        systemRelease(block);
+        return;
+    }
+
+    std::vector<BlockHeader*>& list = cache.lists[cacheKey(block->size, block->offset)];
+    if (list.size() >= maxBlocksPerClass)
+    {
+        systemRelease(block);
+        return;
+    }
+
+    list.push_back(block);
+    cache.cachedBytes += block->size;
+}
+
+size_t VectorAllocator::blockSize(size_t size, size_t dataOffset)
+{
+    return instanceOffset(dataOffset) + size;
+}
+
+void* VectorAllocator::markArenaBlock(void* block, size_t size, size_t dataOffset)
+{
+    if (!block)
+        return nullptr;
+
+    requests.fetch_add(1, std::memory_order_relaxed);
+    arenaHits.fetch_add(1, std::memory_order_relaxed);
+
+    return initBlock(static_cast<uint8_t*>(block), size, instanceOffset(dataOffset), Owner::ARENA);
+}
+
+void VectorAllocator::releaseCached()
+{
+    if (!cacheDestroyed)
+        cache.release();
+}
+
+VectorAllocator::Stats VectorAllocator::getStats()
+{
+    Stats stats;
+    stats.requests = requests.load(std::memory_order_relaxed);
+    stats.poolHits = poolHits.load(std::memory_order_relaxed);
+    stats.arenaHits = arenaHits.load(std::memory_order_relaxed);
+    stats.systemAllocations = systemAllocations.load(std::memory_order_relaxed);
+    stats.systemReleases = systemReleases.load(std::memory_order_relaxed);
+    stats.hugePageAllocations = hugePageAllocations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void VectorAllocator::resetStats()
+{
+    requests.store(0, std::memory_order_relaxed);
+    poolHits.store(0, std::memory_order_relaxed);
+    arenaHits.store(0, std::memory_order_relaxed);
+    systemAllocations.store(0, std::memory_order_relaxed);
+    systemReleases.store(0, std::memory_order_relaxed);
+    hugePageAllocations.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,139 @@
+#include "../include/IVectorArena.h"
+#include "../include/VectorAllocator.h"
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace {
+    class VectorArenaImpl : public IVectorArena {
+    private:
+        static ILogger* pLogger;
+        // Chunks and blocks start at VectorAllocator::dataAlignment, so coordinates inside are aligned too
+        static const size_t alignment = VectorAllocator::dataAlignment;
+
+        std::vector<uint8_t*> _chunks;
+        size_t _chunkSize;
+        uint8_t* _current = nullptr;
+        size_t _offset = 0;
+        size_t _allocations = 0;
+        size_t _used = 0;
+
+        uint8_t* addChunk(size_t size);
+
+    public:
+        static void log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line);
+
+        VectorArenaImpl(size_t chunkSize) : _chunkSize(chunkSize) {}
+
+        static RC setLogger(ILogger* const logger);
+
+        void* allocate(size_t size, size_t dataOffset) override;
+
+        RC reset() override;
+
+        size_t getAllocationsCount() const override;
+        size_t sizeAllocated() const override;
+
+        ~VectorArenaImpl() override;
+    };
+
+    ILogger* VectorArenaImpl::pLogger = nullptr;
+}
+
+RC VectorArenaImpl::setLogger(ILogger* const logger)
+{
+    if (!logger)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    pLogger = logger;
+    return RC::SUCCESS;
+}
+
+void VectorArenaImpl::log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line)
+{
+    if (pLogger != nullptr)
+        pLogger->log(code, level, srcfile, function, line);
+}
+
+uint8_t* VectorArenaImpl::addChunk(size_t size)
+{
+    auto* chunk = static_cast<uint8_t*>(::operator new(size, std::align_val_t(alignment), std::nothrow));
+    if (!chunk)
+        return nullptr;
+
+    _chunks.push_back(chunk);
+    return chunk;
+}
+
+void* VectorArenaImpl::allocate(size_t size, size_t dataOffset)
+{
+    const size_t blockSize = (VectorAllocator::blockSize(size, dataOffset) + alignment - 1) / alignment * alignment;
+    uint8_t* block = nullptr;
+
+    if (blockSize > _chunkSize)
+    {
+        // Oversized block gets its own chunk, current chunk stays open for small vectors
+        block = addChunk(blockSize);
+    }
+    else
+    {
+        if (!_current || _offset + blockSize > _chunkSize)
+        {
+            _current = addChunk(_chunkSize);
+            _offset = 0;
+        }
+
+        if (_current)
+        {
+            block = _current + _offset;
+            _offset += blockSize;
+        }
+    }
+
+    if (!block)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    _allocations++;
+    _used += blockSize;
+    return VectorAllocator::markArenaBlock(block, size, dataOffset);
+}
+
+RC VectorArenaImpl::reset()
+{
+    for (uint8_t* chunk : _chunks)
+    {
+        if (chunk != _current)
+            ::operator delete(chunk, std::align_val_t(alignment));
+    }
+
+    _chunks.clear();
+    if (_current)
+        _chunks.push_back(_current);
+
+    _offset = 0;
+    _allocations = 0;
+    _used = 0;
+    return RC::SUCCESS;
+}
+
+size_t VectorArenaImpl::getAllocationsCount() const
+{
+    return _allocations;
+}
+
+size_t VectorArenaImpl::sizeAllocated() const
+{
+    return _used;
+}
+
+VectorArenaImpl::~VectorArenaImpl()
+{
+    for (uint8_t* chunk : _chunks)
+        ::operator delete(chunk, std::align_val_t(alignment));
+}
@@ -0,0 +1,549 @@
+#ifndef IVECTOR_VECTORBATCHIMPL_H
+#define IVECTOR_VECTORBATCHIMPL_H
+
+#include "../include/IVectorBatch.h"
+#include "../include/ISet.h"
+#include "../include/IVectorView.h"
+#include "../include/ValidChecker.h"
+#include "../include/VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace {
+    class VectorBatchImpl : public IVectorBatch {
+    private:
+        size_t _dim;
+        size_t _count;
+        LAYOUT _layout;
+        double* _data;
+
+        static ILogger* pLogger;
+
+        // Coordinate j of vector i is _data[i * rowStride() + j * coordStride()]
+        size_t rowStride() const { return _layout == LAYOUT::ROW_MAJOR ? _dim : 1; }
+        size_t coordStride() const { return _layout == LAYOUT::ROW_MAJOR ? 1 : _count; }
+
+        void gatherRow(size_t index, double* dst) const;
+        void scatterRow(size_t index, double const* src);
+
+        RC checkVector(IVector const* const& vector) const;
+        RC addScaled(double alpha, double const* x, bool isBatch);
+
+        /*
+        * Calls visit(k, term) for every element _data[k] in memory order. Batch x has our layout and gives
+        * x[k], otherwise x is one vector and its coordinate j is the term of coordinate j of every vector
+        */
+        template <class F>
+        void forEachTerm(double const* x, bool isBatch, F&& visit) const
+        {
+            if (isBatch)
+            {
+                for (size_t k = 0; k < _dim * _count; k++)
+                    visit(k, x[k]);
+            }
+            else if (_layout == LAYOUT::ROW_MAJOR)
+            {
+                for (size_t i = 0; i < _count; i++)
+                {
+                    for (size_t j = 0; j < _dim; j++)
+                        visit(i * _dim + j, x[j]);
+                }
+            }
+            else
+            {
+                for (size_t j = 0; j < _dim; j++)
+                {
+                    for (size_t i = 0; i < _count; i++)
+                        visit(j * _count + i, x[j]);
+                }
+            }
+        }
+
+    public:
+        static void log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line);
+
+        static RC setLogger(ILogger* const logger);
+
+        // data must be allocated with new[] for dim * count doubles, batch owns it
+        VectorBatchImpl(size_t dim, size_t count, LAYOUT layout, double* data);
+
+        // Copies row-major rows into data in batch layout
+        void importRows(double const* rows);
+
+        IVectorBatch* clone() const override;
+
+        size_t getDim() const override;
+        size_t getCount() const override;
+        LAYOUT getLayout() const override;
+
+        RC getRow(size_t index, IVector* const& val) const override;
+        RC setRow(size_t index, IVector const* const& val) override;
+
+        RC exportRows(double* const& dst) const override;
+        RC exportToSet(ISet* const& set, IVector::NORM n, double tol) const override;
+
+        RC norms(IVector::NORM n, double* const& result) const override;
+        RC dots(IVector const* const& query, double* const& result) const override;
+        RC equals(IVector const* const& pat, IVector::NORM n, double tol, bool* const& result) const override;
+
+        RC scale(double multiplier) override;
+        RC axpy(double alpha, IVector const* const& x) override;
+        RC axpy(double alpha, IVectorBatch const* const& x) override;
+
+        ~VectorBatchImpl() override;
+    };
+
+    ILogger* VectorBatchImpl::pLogger = nullptr;
+}
+
+VectorBatchImpl::VectorBatchImpl(size_t dim, size_t count, LAYOUT layout, double* data) :
+    _dim(dim), _count(count), _layout(layout), _data(data)
+{}
+
+VectorBatchImpl::~VectorBatchImpl()
+{
+    delete[] _data;
+}
+
+RC VectorBatchImpl::setLogger(ILogger* const logger)
+{
+    if (!logger)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    pLogger = logger;
+    return RC::SUCCESS;
+}
+
+void VectorBatchImpl::log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line)
+{
+    if (pLogger != nullptr)
+        pLogger->log(code, level, srcfile, function, line);
+}
+
+void VectorBatchImpl::gatherRow(size_t index, double* dst) const
+{
+    const size_t stride = coordStride();
+    double const* src = _data + index * rowStride();
+    for (size_t j = 0; j < _dim; j++)
+        dst[j] = src[j * stride];
+}
+
+void VectorBatchImpl::scatterRow(size_t index, double const* src)
+{
+    const size_t stride = coordStride();
+    double* dst = _data + index * rowStride();
+    for (size_t j = 0; j < _dim; j++)
+        dst[j * stride] = src[j];
+}
+
+void VectorBatchImpl::importRows(double const* rows)
+{
+    if (_layout == LAYOUT::ROW_MAJOR)
+    {
+        memcpy(_data, rows, _dim * _count * sizeof(double));
+        return;
+    }
+
+    for (size_t i = 0; i < _count; i++)
+        scatterRow(i, rows + i * _dim);
+}
+
+RC VectorBatchImpl::checkVector(IVector const* const& vector) const
+{
+    if (!vector)
+        return RC::NULLPTR_ERROR;
+
+    if (vector->getDim() != _dim)
+        return RC::MISMATCHING_DIMENSIONS;
+
+    return RC::SUCCESS;
+}
+
+IVectorBatch* VectorBatchImpl::clone() const
+{
+    auto* data = new (std::nothrow) double[_dim * _count];
+    if (!data)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
+
+    memcpy(data, _data, _dim * _count * sizeof(double));
+
+    auto* batch = new (std::nothrow) VectorBatchImpl(_dim, _count, _layout, data);
+    if (!batch)
+    {
+        delete[] data;
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+    }
+
+    return batch;
+}
+
+size_t VectorBatchImpl::getDim() const
+{
+    return _dim;
+}
+
+size_t VectorBatchImpl::getCount() const
+{
+    return _count;
+}
+
+IVectorBatch::LAYOUT VectorBatchImpl::getLayout() const
+{
+    return _layout;
+}
+
+RC VectorBatchImpl::getRow(size_t index, IVector* const& val) const
+{
+    RC rc = index < _count ? checkVector(val) : RC::INDEX_OUT_OF_BOUND;
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    if (_layout == LAYOUT::ROW_MAJOR)
+        return val->setData(_dim, _data + index * _dim);
+
+    VectorKernels::Scratch scratch(_dim);
+    gatherRow(index, scratch.data());
+    return val->setData(_dim, scratch.data());
+}
+
+RC VectorBatchImpl::setRow(size_t index, IVector const* const& val)
+{
+    RC rc = index < _count ? checkVector(val) : RC::INDEX_OUT_OF_BOUND;
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    scatterRow(index, val->getData());
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::exportRows(double* const& dst) const
+{
+    if (!dst)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    if (_layout == LAYOUT::ROW_MAJOR)
+    {
+        memcpy(dst, _data, _dim * _count * sizeof(double));
+        return RC::SUCCESS;
+    }
+
+    for (size_t i = 0; i < _count; i++)
+        gatherRow(i, dst + i * _dim);
+
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::exportToSet(ISet* const& set, IVector::NORM n, double tol) const
+{
+    if (!set)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    // Rows are passed to the set through one view, SOA rows are gathered into scratch first
+    VectorKernels::Scratch scratch(_dim);
+    IVectorView* view = IVectorView::createView(_dim, _data);
+    if (!view)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::ALLOCATION_ERROR;
+    }
+
+    RC rc = RC::SUCCESS;
+    for (size_t i = 0; rc == RC::SUCCESS && i < _count; i++)
+    {
+        if (_layout == LAYOUT::ROW_MAJOR)
+        {
+            rc = view->rebind(_dim, _data + i * _dim);
+        }
+        else
+        {
+            gatherRow(i, scratch.data());
+            rc = view->rebind(_dim, scratch.data());
+        }
+
+        if (rc == RC::SUCCESS)
+            rc = set->insert(view, n, tol);
+    }
+
+    delete view;
+    return rc;
+}
+
+RC VectorBatchImpl::norms(IVector::NORM n, double* const& result) const
+{
+    if (!result || n == IVector::NORM::AMOUNT)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    if (_layout == LAYOUT::ROW_MAJOR)
+    {
+        for (size_t i = 0; i < _count; i++)
+        {
+            double const* row = _data + i * _dim;
+            switch (n)
+            {
+                case IVector::NORM::FIRST:
+                    result[i] = VectorKernels::sumAbs(row, _dim);
+                    break;
+                case IVector::NORM::SECOND:
+                    result[i] = sqrt(VectorKernels::sumSquares(row, _dim));
+                    break;
+                default:
+                    result[i] = VectorKernels::maxAbs(row, _dim);
+            }
+        }
+    }
+    else
+    {
+        // Coordinate by coordinate, so every pass is a contiguous loop over all vectors
+        std::fill(result, result + _count, 0.0);
+        for (size_t j = 0; j < _dim; j++)
+        {
+            double const* coord = _data + j * _count;
+            switch (n)
+            {
+                case IVector::NORM::FIRST:
+                    for (size_t i = 0; i < _count; i++)
+                        result[i] += std::fabs(coord[i]);
+                    break;
+                case IVector::NORM::SECOND:
+                    for (size_t i = 0; i < _count; i++)
+                        result[i] += coord[i] * coord[i];
+                    break;
+                default:
+                    for (size_t i = 0; i < _count; i++)
+                        result[i] = std::max(result[i], std::fabs(coord[i]));
+            }
+        }
+
+        if (n == IVector::NORM::SECOND)
+        {
+            for (size_t i = 0; i < _count; i++)
+                result[i] = sqrt(result[i]);
+        }
+    }
+
+    // Overflowed norms are reported as NaN like IVector::norm does
+    if (!VectorKernels::isFinite(result, _count))
+    {
+        for (size_t i = 0; i < _count; i++)
+        {
+            if (!ValidChecker::isValidNumber(result[i]))
+                result[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+    }
+
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::dots(IVector const* const& query, double* const& result) const
+{
+    RC rc = result ? checkVector(query) : RC::NULLPTR_ERROR;
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    double const* q = query->getData();
+    if (_layout == LAYOUT::ROW_MAJOR)
+    {
+        for (size_t i = 0; i < _count; i++)
+            result[i] = VectorKernels::dot(_data + i * _dim, q, _dim);
+    }
+    else
+    {
+        std::fill(result, result + _count, 0.0);
+        for (size_t j = 0; j < _dim; j++)
+        {
+            double const* coord = _data + j * _count;
+            const double qj = q[j];
+            for (size_t i = 0; i < _count; i++)
+                result[i] += qj * coord[i];
+        }
+    }
+
+    if (!VectorKernels::isFinite(result, _count))
+    {
+        for (size_t i = 0; i < _count; i++)
+        {
+            if (!ValidChecker::isValidNumber(result[i]))
+                result[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::WARNING, __FILE__, __FUNCTION__, __LINE__);
+    }
+
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::equals(IVector const* const& pat, IVector::NORM n, double tol, bool* const& result) const
+{
+    if (!result || n == IVector::NORM::AMOUNT || tol < 0 || !ValidChecker::isValidNumber(tol))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    RC rc = checkVector(pat);
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    double const* p = pat->getData();
+    if (_layout == LAYOUT::ROW_MAJOR)
+    {
+        for (size_t i = 0; i < _count; i++)
+            result[i] = VectorKernels::distance(_data + i * _dim, p, _dim, n, tol) < tol;
+
+        return RC::SUCCESS;
+    }
+
+    VectorKernels::Scratch scratch(_count);
+    double* dist = scratch.data();
+    std::fill(dist, dist + _count, 0.0);
+    for (size_t j = 0; j < _dim; j++)
+    {
+        double const* coord = _data + j * _count;
+        const double pj = p[j];
+        switch (n)
+        {
+            case IVector::NORM::FIRST:
+                for (size_t i = 0; i < _count; i++)
+                    dist[i] += std::fabs(coord[i] - pj);
+                break;
+            case IVector::NORM::SECOND:
+                for (size_t i = 0; i < _count; i++)
+                    dist[i] += (coord[i] - pj) * (coord[i] - pj);
+                break;
+            default:
+                for (size_t i = 0; i < _count; i++)
+                    dist[i] = std::max(dist[i], std::fabs(coord[i] - pj));
+        }
+    }
+
+    // Same comparison as VectorKernels::distance, sum of squares is compared with squared tol
+    const double bound = n == IVector::NORM::SECOND ? tol * tol : tol;
+    for (size_t i = 0; i < _count; i++)
+        result[i] = dist[i] < bound;
+
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::scale(double multiplier)
+{
+    if (!ValidChecker::isValidNumber(multiplier))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    const size_t size = _dim * _count;
+
+    // Product is monotonic in |x|, so the largest coordinate is the only one which may overflow
+    if (!ValidChecker::isValidNumber(VectorKernels::maxAbs(_data, size) * std::fabs(multiplier)))
+    {
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INFINITY_OVERFLOW;
+    }
+
+    for (size_t k = 0; k < size; k++)
+        _data[k] *= multiplier;
+
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::addScaled(double alpha, double const* x, bool isBatch)
+{
+    if (!ValidChecker::isValidNumber(alpha))
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    // First pass only checks results (Inf - Inf and NaN - NaN are NaN), second one writes them
+    double check = 0;
+    forEachTerm(x, isBatch, [&](size_t k, double xk) {
+        const double value = _data[k] + alpha * xk;
+        check += value - value;
+    });
+
+    if (check != 0)
+    {
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INFINITY_OVERFLOW;
+    }
+
+    forEachTerm(x, isBatch, [&](size_t k, double xk) { _data[k] += alpha * xk; });
+    return RC::SUCCESS;
+}
+
+RC VectorBatchImpl::axpy(double alpha, IVector const* const& x)
+{
+    RC rc = checkVector(x);
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    return addScaled(alpha, x->getData(), false);
+}
+
+RC VectorBatchImpl::axpy(double alpha, IVectorBatch const* const& x)
+{
+    if (!x)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    if (x->getDim() != _dim || x->getCount() != _count)
+    {
+        log(RC::MISMATCHING_DIMENSIONS, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::MISMATCHING_DIMENSIONS;
+    }
+
+    auto const* other = static_cast<VectorBatchImpl const*>(x);
+    if (other->_layout == _layout)
+        return addScaled(alpha, other->_data, true);
+
+    // Different layouts, x is converted to ours first
+    VectorKernels::Scratch scratch(_dim * _count);
+    double* converted = scratch.data();
+    for (size_t i = 0; i < _count; i++)
+    {
+        for (size_t j = 0; j < _dim; j++)
+            converted[i * rowStride() + j * coordStride()] = other->_data[i * other->rowStride() + j * other->coordStride()];
+    }
+
+    return addScaled(alpha, converted, true);
+}
+
+#endif //IVECTOR_VECTORBATCHIMPL_H
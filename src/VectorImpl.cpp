@@ -4,6 +4,9 @@
 #include "../include/IVector.h"
 #include "../include/MathModule.h"
 #include "../include/ValidChecker.h"
+#include "../include/VectorAllocator.h"
+#include "../include/VectorKernels.h"
+#include "../include/VectorExpression.h"
 #include <limits>
 #include <cmath>
 #include <cstring>
@@ -35,6 +38,8 @@ namespace {
 
         size_t getDim() const override;
 
+        PRECISION getPrecision() const override;
+
         double norm(NORM n) const override;
 
         IVector* clone() const override;
@@ -50,6 +55,13 @@ namespace {
         RC setData(size_t dim, double const* const& ptr_data) override;
 
         ~VectorImpl() override;
+
+    protected:
+        double* getMutableData() override;
+
+    public:
+        // Instances are created by VectorAllocator or IVectorArena, so they're returned there
+        static void operator delete(void* ptr);
     };
     ILogger* VectorImpl::pLogger = nullptr;
 
@@ -57,6 +69,11 @@ namespace {
 
 VectorImpl::~VectorImpl() = default;
 
+void VectorImpl::operator delete(void* ptr)
+{
+    VectorAllocator::deallocate(ptr);
+}
+
 RC VectorImpl::setLogger(ILogger *const logger) {
     if (!logger)
     {
@@ -117,12 +134,12 @@ RC VectorImpl::scale(double multiplier)
         return RC::INVALID_ARGUMENT;
     }
 
-    double* ptr = (double*)((uint8_t*)this + sizeof(VectorImpl));
-    for (size_t i = 0; i < this->getDim(); i++)
-    {
-        ptr[i] *= multiplier;
-    }
-    return RC::SUCCESS;
+    using namespace VectorExpression;
+    RC rc = IVector::assign(this, multiplier * vec(this));
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
 }
 
 size_t VectorImpl::getDim() const
@@ -130,6 +147,11 @@ size_t VectorImpl::getDim() const
     return _dim;
 }
 
+IVector::PRECISION VectorImpl::getPrecision() const
+{
+    return PRECISION::DOUBLE;
+}
+
 double VectorImpl::norm(IVector::NORM n) const
 {
     double result = 0;
@@ -138,46 +160,15 @@ double VectorImpl::norm(IVector::NORM n) const
     switch (n)
     {
         case NORM::FIRST:
-            for (size_t i = 0; i < this->getDim(); i++)
-            {
-                result += fabs(data[i]);
-
-                if (!ValidChecker::isValidNumber(result))
-                {
-                    log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-                    return std::numeric_limits<double>::quiet_NaN();;
-                }
-            }
-
+            result = VectorKernels::sumAbs(data, _dim);
             break;
 
         case NORM::SECOND:
-            for (size_t i = 0; i < this->getDim(); i++)
-            {
-                result += data[i] * data[i];
-
-                if (!ValidChecker::isValidNumber(result))
-                {
-                    log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-                    return std::numeric_limits<double>::quiet_NaN();;
-                }
-            }
-            result = sqrt(result);
+            result = sqrt(VectorKernels::sumSquares(data, _dim));
             break;
 
         case NORM::CHEBYSHEV:
-            result = 0;
-            for (size_t i = 0; i < this->getDim(); i++)
-            {
-                if (fabs(data[i]) > result)
-                    result = fabs(data[i]);
-
-                if (!ValidChecker::isValidNumber(result))
-                {
-                    log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-                    return std::numeric_limits<double>::quiet_NaN();
-                }
-            }
+            result = VectorKernels::maxAbs(data, _dim);
             break;
         default:
         {
@@ -186,51 +177,57 @@ double VectorImpl::norm(IVector::NORM n) const
         }
     }
 
+    // Overflow anywhere in the sum leaves Inf or NaN in the result, so it is checked once
+    if (!ValidChecker::isValidNumber(result))
+    {
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
     return result;
 }
 
 IVector *VectorImpl::clone() const
 {
-    int size = sizeof(VectorImpl) + this->getDim() * sizeof(double);
+    size_t size = sizeAllocated();
+
+    auto* ptr_block = static_cast<uint8_t*>(VectorAllocator::allocate(size, sizeof(VectorImpl)));
+    if (!ptr_block)
+    {
+        log(RC::ALLOCATION_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return nullptr;
+    }
 
-    auto* ptr_block = new uint8_t[size];
     auto* currentPtr = (uint8_t*)this;
 
-    memcpy(ptr_block, currentPtr, size);
+    VectorKernels::copy(ptr_block, currentPtr, size);
 
     return (IVector*) ptr_block;
 }
 
 RC VectorImpl::applyFunction(const std::function<double(double)> &fun) {
-    double* data = (double*)((uint8_t*)this + sizeof(VectorImpl));
-
-    for (size_t i = 0; i < _dim; i++)
+    if (!fun)
     {
-        if (!ValidChecker::isValidNumber(fun(data[i])))
-        {
-            log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return RC::INFINITY_OVERFLOW;
-        }
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
     }
 
-    for (size_t i = 0; i < _dim; i++)
-    {
-        data[i] = fun(data[i]);
-    }
+    RC rc = applyInline(fun);
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
 
-    return RC::SUCCESS;
+    return rc;
 }
 
 RC VectorImpl::foreach(const std::function<void(double)> &fun) const
 {
-    double* data = (double*)((uint8_t*)this + sizeof(VectorImpl));
-
-    for (size_t i = 0; i < _dim; i++)
+    if (!fun)
     {
-        fun(data[i]);
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
     }
 
-    return RC::SUCCESS;
+    return forEachInline(fun);
 }
 
 double const *VectorImpl::getData() const
@@ -238,6 +235,11 @@ double const *VectorImpl::getData() const
     return (double*)((uint8_t*)this + sizeof(VectorImpl));
 }
 
+double *VectorImpl::getMutableData()
+{
+    return (double*)((uint8_t*)this + sizeof(VectorImpl));
+}
+
 size_t VectorImpl::sizeAllocated() const
 {
     return sizeof(*this) + _dim * sizeof(double);
@@ -254,31 +256,17 @@ RC VectorImpl::inc(const IVector *const &op)
         return RC::MISMATCHING_DIMENSIONS;
     }
 
-    const double* ptr2 = op->getData();
-    double* ptr1 = (double*)((uint8_t*)this + sizeof(VectorImpl));
-
-    for (size_t i = 0; i < _dim; i++)
-    {
-        if (!ValidChecker::isValidNumber(ptr1[i] + ptr2[i]))
-        {
-            log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return RC::INFINITY_OVERFLOW;
-        }
-    }
-
-    for (size_t i = 0; i < _dim; i++)
-    {
-        ptr1[i] += ptr2[i];
-    }
+    using namespace VectorExpression;
+    RC rc = IVector::assign(this, vec(this) + vec(op));
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
 
-    return RC::SUCCESS;
+    return rc;
 }
 
 
 RC VectorImpl::dec(const IVector *const &op)
 {
-    double result;
-
     if (!op)
         return RC::INVALID_ARGUMENT;
 
@@ -288,25 +276,12 @@ RC VectorImpl::dec(const IVector *const &op)
         return RC::MISMATCHING_DIMENSIONS;
     }
 
-    const double* ptr2 = op->getData();
-    double* ptr1 = (double*)((uint8_t*)this + sizeof(VectorImpl));
-
-    for (size_t i = 0; i < _dim; i++)
-    {
-        result = ptr1[i] - ptr2[i];
-        if (!ValidChecker::isValidNumber(result))
-        {
-            log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return RC::INFINITY_OVERFLOW;
-        }
-    }
+    using namespace VectorExpression;
+    RC rc = IVector::assign(this, vec(this) - vec(op));
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
 
-    for (size_t i = 0; i < _dim; i++)
-    {
-        ptr1[i] -= ptr2[i];
-    }
-
-    return RC::SUCCESS;
+    return rc;
 }
 
 void VectorImpl::log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line)
@@ -322,14 +297,12 @@ RC VectorImpl::setData(size_t dim, const double *const &ptr_data) {
         return RC::INVALID_ARGUMENT;
     }
 
-    for (size_t i = 0; i < dim; i++)
+    if (!VectorKernels::isFinite(ptr_data, dim))
     {
-        if (!ValidChecker::isValidNumber(ptr_data[i]))
-        {
-            VectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
-            return RC::NOT_NUMBER;
-        }
+        VectorImpl::log(RC::NOT_NUMBER, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NOT_NUMBER;
     }
+
     auto* curPtrData = (double*)((uint8_t*)this + sizeof(VectorImpl));
     memcpy(curPtrData, ptr_data, _dim * sizeof(double));
 
@@ -0,0 +1,922 @@
+#include "../include/VectorKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IVECTOR_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+    struct KernelTable {
+        VectorKernels::ISA isa;
+        double (*sumAbs)(double const*, size_t);
+        double (*sumSquares)(double const*, size_t);
+        double (*maxAbs)(double const*, size_t);
+        double (*dot)(double const*, double const*, size_t);
+        double (*sumAbsDiff)(double const*, double const*, size_t);
+        double (*sumSquaresDiff)(double const*, double const*, size_t);
+        double (*maxAbsDiff)(double const*, double const*, size_t);
+        bool (*isFinite)(double const*, size_t);
+    };
+
+    // Scratch buffers of the current thread, only [0, scratchDepth) are in use
+    thread_local std::vector<std::vector<double>> scratchBuffers;
+    thread_local size_t scratchDepth = 0;
+
+    // Distance kernels check the bound after every block, so early exit costs nothing inside the block
+    const size_t distanceBlockSize = 256;
+
+    // Rows prefiltered at once by findWithin(), flags of one block stay on the stack
+    const size_t rowBlockSize = 64;
+
+    // Scalar kernels keep four partial results, so they don't depend on one long chain of additions either
+
+    double sumAbsScalar(double const* data, size_t dim)
+    {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 += std::fabs(data[i]);
+            s1 += std::fabs(data[i + 1]);
+            s2 += std::fabs(data[i + 2]);
+            s3 += std::fabs(data[i + 3]);
+        }
+        for (; i < dim; i++)
+            s0 += std::fabs(data[i]);
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    double sumSquaresScalar(double const* data, size_t dim)
+    {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 += data[i] * data[i];
+            s1 += data[i + 1] * data[i + 1];
+            s2 += data[i + 2] * data[i + 2];
+            s3 += data[i + 3] * data[i + 3];
+        }
+        for (; i < dim; i++)
+            s0 += data[i] * data[i];
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    double maxAbsScalar(double const* data, size_t dim)
+    {
+        double result = 0;
+        for (size_t i = 0; i < dim; i++)
+        {
+            if (std::fabs(data[i]) > result)
+                result = std::fabs(data[i]);
+        }
+
+        return result;
+    }
+
+    double dotScalar(double const* op1, double const* op2, size_t dim)
+    {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 += op1[i] * op2[i];
+            s1 += op1[i + 1] * op2[i + 1];
+            s2 += op1[i + 2] * op2[i + 2];
+            s3 += op1[i + 3] * op2[i + 3];
+        }
+        for (; i < dim; i++)
+            s0 += op1[i] * op2[i];
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    double sumAbsDiffScalar(double const* op1, double const* op2, size_t dim)
+    {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 += std::fabs(op1[i] - op2[i]);
+            s1 += std::fabs(op1[i + 1] - op2[i + 1]);
+            s2 += std::fabs(op1[i + 2] - op2[i + 2]);
+            s3 += std::fabs(op1[i + 3] - op2[i + 3]);
+        }
+        for (; i < dim; i++)
+            s0 += std::fabs(op1[i] - op2[i]);
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    double sumSquaresDiffScalar(double const* op1, double const* op2, size_t dim)
+    {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            const double d0 = op1[i] - op2[i], d1 = op1[i + 1] - op2[i + 1];
+            const double d2 = op1[i + 2] - op2[i + 2], d3 = op1[i + 3] - op2[i + 3];
+            s0 += d0 * d0;
+            s1 += d1 * d1;
+            s2 += d2 * d2;
+            s3 += d3 * d3;
+        }
+        for (; i < dim; i++)
+            s0 += (op1[i] - op2[i]) * (op1[i] - op2[i]);
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // x - x is 0 for finite x and NaN otherwise, NaN sticks in the sum
+
+    bool isFiniteScalar(double const* data, size_t dim)
+    {
+        double s0 = 0, s1 = 0;
+        size_t i = 0;
+        for (; i + 2 <= dim; i += 2)
+        {
+            s0 += data[i] - data[i];
+            s1 += data[i + 1] - data[i + 1];
+        }
+        for (; i < dim; i++)
+            s0 += data[i] - data[i];
+
+        return s0 + s1 == 0;
+    }
+
+    double maxAbsDiffScalar(double const* op1, double const* op2, size_t dim)
+    {
+        double result = 0;
+        for (size_t i = 0; i < dim; i++)
+        {
+            if (std::fabs(op1[i] - op2[i]) > result)
+                result = std::fabs(op1[i] - op2[i]);
+        }
+
+        return result;
+    }
+
+#ifdef IVECTOR_X86_KERNELS
+    // Two vectors of two lanes each
+
+    __attribute__((target("sse2"))) double horizontalSum(__m128d v)
+    {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+
+    __attribute__((target("sse2"))) double sumAbsSSE2(double const* data, size_t dim)
+    {
+        const __m128d mask = _mm_set1_pd(-0.0);
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 = _mm_add_pd(s0, _mm_andnot_pd(mask, _mm_loadu_pd(data + i)));
+            s1 = _mm_add_pd(s1, _mm_andnot_pd(mask, _mm_loadu_pd(data + i + 2)));
+        }
+
+        double result = horizontalSum(_mm_add_pd(s0, s1));
+        for (; i < dim; i++)
+            result += std::fabs(data[i]);
+
+        return result;
+    }
+
+    __attribute__((target("sse2"))) double sumSquaresSSE2(double const* data, size_t dim)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            const __m128d v0 = _mm_loadu_pd(data + i);
+            const __m128d v1 = _mm_loadu_pd(data + i + 2);
+            s0 = _mm_add_pd(s0, _mm_mul_pd(v0, v0));
+            s1 = _mm_add_pd(s1, _mm_mul_pd(v1, v1));
+        }
+
+        double result = horizontalSum(_mm_add_pd(s0, s1));
+        for (; i < dim; i++)
+            result += data[i] * data[i];
+
+        return result;
+    }
+
+    __attribute__((target("sse2"))) double maxAbsSSE2(double const* data, size_t dim)
+    {
+        const __m128d mask = _mm_set1_pd(-0.0);
+        __m128d m0 = _mm_setzero_pd(), m1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            m0 = _mm_max_pd(m0, _mm_andnot_pd(mask, _mm_loadu_pd(data + i)));
+            m1 = _mm_max_pd(m1, _mm_andnot_pd(mask, _mm_loadu_pd(data + i + 2)));
+        }
+
+        const __m128d m = _mm_max_pd(m0, m1);
+        double result = maxAbsScalar(data + i, dim - i);
+        const double lanes[2] = {_mm_cvtsd_f64(m), _mm_cvtsd_f64(_mm_unpackhi_pd(m, m))};
+        for (double lane : lanes)
+        {
+            if (lane > result)
+                result = lane;
+        }
+
+        return result;
+    }
+
+    __attribute__((target("sse2"))) double dotSSE2(double const* op1, double const* op2, size_t dim)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(op1 + i), _mm_loadu_pd(op2 + i)));
+            s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(op1 + i + 2), _mm_loadu_pd(op2 + i + 2)));
+        }
+
+        double result = horizontalSum(_mm_add_pd(s0, s1));
+        for (; i < dim; i++)
+            result += op1[i] * op2[i];
+
+        return result;
+    }
+
+    __attribute__((target("sse2"))) double sumAbsDiffSSE2(double const* op1, double const* op2, size_t dim)
+    {
+        const __m128d mask = _mm_set1_pd(-0.0);
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            s0 = _mm_add_pd(s0, _mm_andnot_pd(mask, _mm_sub_pd(_mm_loadu_pd(op1 + i), _mm_loadu_pd(op2 + i))));
+            s1 = _mm_add_pd(s1, _mm_andnot_pd(mask, _mm_sub_pd(_mm_loadu_pd(op1 + i + 2), _mm_loadu_pd(op2 + i + 2))));
+        }
+
+        return horizontalSum(_mm_add_pd(s0, s1)) + sumAbsDiffScalar(op1 + i, op2 + i, dim - i);
+    }
+
+    __attribute__((target("sse2"))) double sumSquaresDiffSSE2(double const* op1, double const* op2, size_t dim)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            const __m128d d0 = _mm_sub_pd(_mm_loadu_pd(op1 + i), _mm_loadu_pd(op2 + i));
+            const __m128d d1 = _mm_sub_pd(_mm_loadu_pd(op1 + i + 2), _mm_loadu_pd(op2 + i + 2));
+            s0 = _mm_add_pd(s0, _mm_mul_pd(d0, d0));
+            s1 = _mm_add_pd(s1, _mm_mul_pd(d1, d1));
+        }
+
+        return horizontalSum(_mm_add_pd(s0, s1)) + sumSquaresDiffScalar(op1 + i, op2 + i, dim - i);
+    }
+
+    __attribute__((target("sse2"))) bool isFiniteSSE2(double const* data, size_t dim)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            const __m128d v0 = _mm_loadu_pd(data + i);
+            const __m128d v1 = _mm_loadu_pd(data + i + 2);
+            s0 = _mm_add_pd(s0, _mm_sub_pd(v0, v0));
+            s1 = _mm_add_pd(s1, _mm_sub_pd(v1, v1));
+        }
+
+        return horizontalSum(_mm_add_pd(s0, s1)) == 0 && isFiniteScalar(data + i, dim - i);
+    }
+
+    __attribute__((target("sse2"))) double maxAbsDiffSSE2(double const* op1, double const* op2, size_t dim)
+    {
+        const __m128d mask = _mm_set1_pd(-0.0);
+        __m128d m0 = _mm_setzero_pd(), m1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= dim; i += 4)
+        {
+            m0 = _mm_max_pd(m0, _mm_andnot_pd(mask, _mm_sub_pd(_mm_loadu_pd(op1 + i), _mm_loadu_pd(op2 + i))));
+            m1 = _mm_max_pd(m1, _mm_andnot_pd(mask, _mm_sub_pd(_mm_loadu_pd(op1 + i + 2), _mm_loadu_pd(op2 + i + 2))));
+        }
+
+        const __m128d m = _mm_max_pd(m0, m1);
+        const double vectorMax = _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+        const double tailMax = maxAbsDiffScalar(op1 + i, op2 + i, dim - i);
+        return vectorMax > tailMax ? vectorMax : tailMax;
+    }
+
+    // Four vectors of four lanes each
+
+    __attribute__((target("avx2"))) double horizontalSum(__m256d v)
+    {
+        const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+
+    __attribute__((target("avx2"))) double horizontalMax(__m256d v)
+    {
+        const __m128d half = _mm_max_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_max_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+
+    __attribute__((target("avx2"))) double sumAbsAVX2(double const* data, size_t dim)
+    {
+        const __m256d mask = _mm256_set1_pd(-0.0);
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            s0 = _mm256_add_pd(s0, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i)));
+            s1 = _mm256_add_pd(s1, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i + 4)));
+            s2 = _mm256_add_pd(s2, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i + 8)));
+            s3 = _mm256_add_pd(s3, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i + 12)));
+        }
+        for (; i + 4 <= dim; i += 4)
+            s0 = _mm256_add_pd(s0, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i)));
+
+        double result = horizontalSum(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+        for (; i < dim; i++)
+            result += std::fabs(data[i]);
+
+        return result;
+    }
+
+    __attribute__((target("avx2"))) double sumSquaresAVX2(double const* data, size_t dim)
+    {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            const __m256d v0 = _mm256_loadu_pd(data + i);
+            const __m256d v1 = _mm256_loadu_pd(data + i + 4);
+            const __m256d v2 = _mm256_loadu_pd(data + i + 8);
+            const __m256d v3 = _mm256_loadu_pd(data + i + 12);
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(v0, v0));
+            s1 = _mm256_add_pd(s1, _mm256_mul_pd(v1, v1));
+            s2 = _mm256_add_pd(s2, _mm256_mul_pd(v2, v2));
+            s3 = _mm256_add_pd(s3, _mm256_mul_pd(v3, v3));
+        }
+        for (; i + 4 <= dim; i += 4)
+        {
+            const __m256d v = _mm256_loadu_pd(data + i);
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(v, v));
+        }
+
+        double result = horizontalSum(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+        for (; i < dim; i++)
+            result += data[i] * data[i];
+
+        return result;
+    }
+
+    __attribute__((target("avx2"))) double maxAbsAVX2(double const* data, size_t dim)
+    {
+        const __m256d mask = _mm256_set1_pd(-0.0);
+        __m256d m0 = _mm256_setzero_pd(), m1 = _mm256_setzero_pd(), m2 = _mm256_setzero_pd(), m3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            m0 = _mm256_max_pd(m0, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i)));
+            m1 = _mm256_max_pd(m1, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i + 4)));
+            m2 = _mm256_max_pd(m2, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i + 8)));
+            m3 = _mm256_max_pd(m3, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i + 12)));
+        }
+        for (; i + 4 <= dim; i += 4)
+            m0 = _mm256_max_pd(m0, _mm256_andnot_pd(mask, _mm256_loadu_pd(data + i)));
+
+        const double vectorMax = horizontalMax(_mm256_max_pd(_mm256_max_pd(m0, m1), _mm256_max_pd(m2, m3)));
+        const double tailMax = maxAbsScalar(data + i, dim - i);
+        return vectorMax > tailMax ? vectorMax : tailMax;
+    }
+
+    __attribute__((target("avx2"))) double dotAVX2(double const* op1, double const* op2, size_t dim)
+    {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(op1 + i), _mm256_loadu_pd(op2 + i)));
+            s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(op1 + i + 4), _mm256_loadu_pd(op2 + i + 4)));
+            s2 = _mm256_add_pd(s2, _mm256_mul_pd(_mm256_loadu_pd(op1 + i + 8), _mm256_loadu_pd(op2 + i + 8)));
+            s3 = _mm256_add_pd(s3, _mm256_mul_pd(_mm256_loadu_pd(op1 + i + 12), _mm256_loadu_pd(op2 + i + 12)));
+        }
+        for (; i + 4 <= dim; i += 4)
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(op1 + i), _mm256_loadu_pd(op2 + i)));
+
+        double result = horizontalSum(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+        for (; i < dim; i++)
+            result += op1[i] * op2[i];
+
+        return result;
+    }
+
+    __attribute__((target("avx2"))) double sumAbsDiffAVX2(double const* op1, double const* op2, size_t dim)
+    {
+        const __m256d mask = _mm256_set1_pd(-0.0);
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= dim; i += 8)
+        {
+            s0 = _mm256_add_pd(s0, _mm256_andnot_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(op1 + i), _mm256_loadu_pd(op2 + i))));
+            s1 = _mm256_add_pd(s1, _mm256_andnot_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(op1 + i + 4), _mm256_loadu_pd(op2 + i + 4))));
+        }
+
+        return horizontalSum(_mm256_add_pd(s0, s1)) + sumAbsDiffScalar(op1 + i, op2 + i, dim - i);
+    }
+
+    __attribute__((target("avx2"))) double sumSquaresDiffAVX2(double const* op1, double const* op2, size_t dim)
+    {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= dim; i += 8)
+        {
+            const __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(op1 + i), _mm256_loadu_pd(op2 + i));
+            const __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(op1 + i + 4), _mm256_loadu_pd(op2 + i + 4));
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(d0, d0));
+            s1 = _mm256_add_pd(s1, _mm256_mul_pd(d1, d1));
+        }
+
+        return horizontalSum(_mm256_add_pd(s0, s1)) + sumSquaresDiffScalar(op1 + i, op2 + i, dim - i);
+    }
+
+    __attribute__((target("avx2"))) bool isFiniteAVX2(double const* data, size_t dim)
+    {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= dim; i += 8)
+        {
+            const __m256d v0 = _mm256_loadu_pd(data + i);
+            const __m256d v1 = _mm256_loadu_pd(data + i + 4);
+            s0 = _mm256_add_pd(s0, _mm256_sub_pd(v0, v0));
+            s1 = _mm256_add_pd(s1, _mm256_sub_pd(v1, v1));
+        }
+
+        return horizontalSum(_mm256_add_pd(s0, s1)) == 0 && isFiniteScalar(data + i, dim - i);
+    }
+
+    __attribute__((target("avx2"))) double maxAbsDiffAVX2(double const* op1, double const* op2, size_t dim)
+    {
+        const __m256d mask = _mm256_set1_pd(-0.0);
+        __m256d m0 = _mm256_setzero_pd(), m1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= dim; i += 8)
+        {
+            m0 = _mm256_max_pd(m0, _mm256_andnot_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(op1 + i), _mm256_loadu_pd(op2 + i))));
+            m1 = _mm256_max_pd(m1, _mm256_andnot_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(op1 + i + 4), _mm256_loadu_pd(op2 + i + 4))));
+        }
+
+        const double vectorMax = horizontalMax(_mm256_max_pd(m0, m1));
+        const double tailMax = maxAbsDiffScalar(op1 + i, op2 + i, dim - i);
+        return vectorMax > tailMax ? vectorMax : tailMax;
+    }
+
+    // Four vectors of eight lanes each, tail is handled with masked loads
+
+    __attribute__((target("avx512f"))) double sumAbsAVX512(double const* data, size_t dim)
+    {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 32 <= dim; i += 32)
+        {
+            s0 = _mm512_add_pd(s0, _mm512_abs_pd(_mm512_loadu_pd(data + i)));
+            s1 = _mm512_add_pd(s1, _mm512_abs_pd(_mm512_loadu_pd(data + i + 8)));
+            s2 = _mm512_add_pd(s2, _mm512_abs_pd(_mm512_loadu_pd(data + i + 16)));
+            s3 = _mm512_add_pd(s3, _mm512_abs_pd(_mm512_loadu_pd(data + i + 24)));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            s0 = _mm512_add_pd(s0, _mm512_abs_pd(_mm512_maskz_loadu_pd(tail, data + i)));
+        }
+
+        return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+    }
+
+    __attribute__((target("avx512f"))) double sumSquaresAVX512(double const* data, size_t dim)
+    {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 32 <= dim; i += 32)
+        {
+            const __m512d v0 = _mm512_loadu_pd(data + i);
+            const __m512d v1 = _mm512_loadu_pd(data + i + 8);
+            const __m512d v2 = _mm512_loadu_pd(data + i + 16);
+            const __m512d v3 = _mm512_loadu_pd(data + i + 24);
+            s0 = _mm512_add_pd(s0, _mm512_mul_pd(v0, v0));
+            s1 = _mm512_add_pd(s1, _mm512_mul_pd(v1, v1));
+            s2 = _mm512_add_pd(s2, _mm512_mul_pd(v2, v2));
+            s3 = _mm512_add_pd(s3, _mm512_mul_pd(v3, v3));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            const __m512d v = _mm512_maskz_loadu_pd(tail, data + i);
+            s0 = _mm512_add_pd(s0, _mm512_mul_pd(v, v));
+        }
+
+        return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+    }
+
+    __attribute__((target("avx512f"))) double maxAbsAVX512(double const* data, size_t dim)
+    {
+        __m512d m0 = _mm512_setzero_pd(), m1 = _mm512_setzero_pd(), m2 = _mm512_setzero_pd(), m3 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 32 <= dim; i += 32)
+        {
+            m0 = _mm512_max_pd(m0, _mm512_abs_pd(_mm512_loadu_pd(data + i)));
+            m1 = _mm512_max_pd(m1, _mm512_abs_pd(_mm512_loadu_pd(data + i + 8)));
+            m2 = _mm512_max_pd(m2, _mm512_abs_pd(_mm512_loadu_pd(data + i + 16)));
+            m3 = _mm512_max_pd(m3, _mm512_abs_pd(_mm512_loadu_pd(data + i + 24)));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            m0 = _mm512_max_pd(m0, _mm512_abs_pd(_mm512_maskz_loadu_pd(tail, data + i)));
+        }
+
+        return _mm512_reduce_max_pd(_mm512_max_pd(_mm512_max_pd(m0, m1), _mm512_max_pd(m2, m3)));
+    }
+
+    __attribute__((target("avx512f"))) double dotAVX512(double const* op1, double const* op2, size_t dim)
+    {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 32 <= dim; i += 32)
+        {
+            s0 = _mm512_add_pd(s0, _mm512_mul_pd(_mm512_loadu_pd(op1 + i), _mm512_loadu_pd(op2 + i)));
+            s1 = _mm512_add_pd(s1, _mm512_mul_pd(_mm512_loadu_pd(op1 + i + 8), _mm512_loadu_pd(op2 + i + 8)));
+            s2 = _mm512_add_pd(s2, _mm512_mul_pd(_mm512_loadu_pd(op1 + i + 16), _mm512_loadu_pd(op2 + i + 16)));
+            s3 = _mm512_add_pd(s3, _mm512_mul_pd(_mm512_loadu_pd(op1 + i + 24), _mm512_loadu_pd(op2 + i + 24)));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            s0 = _mm512_add_pd(s0, _mm512_mul_pd(_mm512_maskz_loadu_pd(tail, op1 + i), _mm512_maskz_loadu_pd(tail, op2 + i)));
+        }
+
+        return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+    }
+
+    __attribute__((target("avx512f"))) double sumAbsDiffAVX512(double const* op1, double const* op2, size_t dim)
+    {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            s0 = _mm512_add_pd(s0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(op1 + i), _mm512_loadu_pd(op2 + i))));
+            s1 = _mm512_add_pd(s1, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(op1 + i + 8), _mm512_loadu_pd(op2 + i + 8))));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            s0 = _mm512_add_pd(s0, _mm512_abs_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(tail, op1 + i), _mm512_maskz_loadu_pd(tail, op2 + i))));
+        }
+
+        return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+    }
+
+    __attribute__((target("avx512f"))) double sumSquaresDiffAVX512(double const* op1, double const* op2, size_t dim)
+    {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            const __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(op1 + i), _mm512_loadu_pd(op2 + i));
+            const __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(op1 + i + 8), _mm512_loadu_pd(op2 + i + 8));
+            s0 = _mm512_add_pd(s0, _mm512_mul_pd(d0, d0));
+            s1 = _mm512_add_pd(s1, _mm512_mul_pd(d1, d1));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            const __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(tail, op1 + i), _mm512_maskz_loadu_pd(tail, op2 + i));
+            s0 = _mm512_add_pd(s0, _mm512_mul_pd(d, d));
+        }
+
+        return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+    }
+
+    __attribute__((target("avx512f"))) bool isFiniteAVX512(double const* data, size_t dim)
+    {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            const __m512d v0 = _mm512_loadu_pd(data + i);
+            const __m512d v1 = _mm512_loadu_pd(data + i + 8);
+            s0 = _mm512_add_pd(s0, _mm512_sub_pd(v0, v0));
+            s1 = _mm512_add_pd(s1, _mm512_sub_pd(v1, v1));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            const __m512d v = _mm512_maskz_loadu_pd(tail, data + i);
+            s0 = _mm512_add_pd(s0, _mm512_sub_pd(v, v));
+        }
+
+        return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1)) == 0;
+    }
+
+    __attribute__((target("avx512f"))) double maxAbsDiffAVX512(double const* op1, double const* op2, size_t dim)
+    {
+        __m512d m0 = _mm512_setzero_pd(), m1 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= dim; i += 16)
+        {
+            m0 = _mm512_max_pd(m0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(op1 + i), _mm512_loadu_pd(op2 + i))));
+            m1 = _mm512_max_pd(m1, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(op1 + i + 8), _mm512_loadu_pd(op2 + i + 8))));
+        }
+        for (; i < dim; i += 8)
+        {
+            const __mmask8 tail = dim - i >= 8 ? 0xFF : (__mmask8)((1u << (dim - i)) - 1);
+            m0 = _mm512_max_pd(m0, _mm512_abs_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(tail, op1 + i), _mm512_maskz_loadu_pd(tail, op2 + i))));
+        }
+
+        return _mm512_reduce_max_pd(_mm512_max_pd(m0, m1));
+    }
+#endif
+
+    bool isSupported(VectorKernels::ISA isa)
+    {
+        switch (isa)
+        {
+            case VectorKernels::ISA::SCALAR:
+                return true;
+#ifdef IVECTOR_X86_KERNELS
+            case VectorKernels::ISA::SSE2:
+                return __builtin_cpu_supports("sse2");
+            case VectorKernels::ISA::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case VectorKernels::ISA::AVX512:
+                return __builtin_cpu_supports("avx512f");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    // Default is larger than L2 and a fair part of L3, smaller copies are served better by the cache
+    std::atomic<size_t> streamingThreshold(4 * 1024 * 1024);
+
+#ifdef IVECTOR_X86_KERNELS
+    __attribute__((target("sse2")))
+    void streamingCopySSE2(uint8_t* dst, uint8_t const* src, size_t bytes)
+    {
+        // Non-temporal stores need aligned destination, head up to the boundary goes through memcpy
+        const size_t head = std::min(bytes, (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16);
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        bytes -= head;
+
+        size_t i = 0;
+        for (; i + 64 <= bytes; i += 64)
+        {
+            const __m128i v0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+            const __m128i v1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i + 16));
+            const __m128i v2 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i + 32));
+            const __m128i v3 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v0);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), v1);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), v2);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), v3);
+        }
+
+        // Streaming stores are weakly ordered, fence makes them visible before the copy is reported done
+        _mm_sfence();
+        memcpy(dst + i, src + i, bytes - i);
+    }
+#endif
+
+    KernelTable makeTable(VectorKernels::ISA isa)
+    {
+        switch (isa)
+        {
+#ifdef IVECTOR_X86_KERNELS
+            case VectorKernels::ISA::AVX512:
+                return {isa, sumAbsAVX512, sumSquaresAVX512, maxAbsAVX512, dotAVX512,
+                        sumAbsDiffAVX512, sumSquaresDiffAVX512, maxAbsDiffAVX512, isFiniteAVX512};
+            case VectorKernels::ISA::AVX2:
+                return {isa, sumAbsAVX2, sumSquaresAVX2, maxAbsAVX2, dotAVX2,
+                        sumAbsDiffAVX2, sumSquaresDiffAVX2, maxAbsDiffAVX2, isFiniteAVX2};
+            case VectorKernels::ISA::SSE2:
+                return {isa, sumAbsSSE2, sumSquaresSSE2, maxAbsSSE2, dotSSE2,
+                        sumAbsDiffSSE2, sumSquaresDiffSSE2, maxAbsDiffSSE2, isFiniteSSE2};
+#endif
+            default:
+                return {VectorKernels::ISA::SCALAR, sumAbsScalar, sumSquaresScalar, maxAbsScalar, dotScalar,
+                        sumAbsDiffScalar, sumSquaresDiffScalar, maxAbsDiffScalar, isFiniteScalar};
+        }
+    }
+
+    // Tables are never changed after they are built, so switching ISA only swaps a pointer
+    KernelTable const* tableOf(VectorKernels::ISA isa)
+    {
+        static const KernelTable tables[] = {makeTable(VectorKernels::ISA::SCALAR), makeTable(VectorKernels::ISA::SSE2),
+                                             makeTable(VectorKernels::ISA::AVX2), makeTable(VectorKernels::ISA::AVX512)};
+        return &tables[(size_t)isa];
+    }
+
+    VectorKernels::ISA detectISA()
+    {
+        const VectorKernels::ISA candidates[] = {VectorKernels::ISA::AVX512, VectorKernels::ISA::AVX2, VectorKernels::ISA::SSE2};
+        for (VectorKernels::ISA isa : candidates)
+        {
+            if (isSupported(isa))
+                return isa;
+        }
+
+        return VectorKernels::ISA::SCALAR;
+    }
+
+    std::atomic<KernelTable const*>& currentTable()
+    {
+        static std::atomic<KernelTable const*> kernels{tableOf(detectISA())};
+        return kernels;
+    }
+
+    KernelTable const& table()
+    {
+        return *currentTable().load(std::memory_order_acquire);
+    }
+}
+
+double VectorKernels::sumAbs(double const* data, size_t dim)
+{
+    return table().sumAbs(data, dim);
+}
+
+double VectorKernels::sumSquares(double const* data, size_t dim)
+{
+    return table().sumSquares(data, dim);
+}
+
+double VectorKernels::maxAbs(double const* data, size_t dim)
+{
+    return table().maxAbs(data, dim);
+}
+
+double VectorKernels::dot(double const* op1, double const* op2, size_t dim)
+{
+    return table().dot(op1, op2, dim);
+}
+
+double VectorKernels::sumAbsDiff(double const* op1, double const* op2, size_t dim, double bound)
+{
+    const KernelTable& kernels = table();
+    double result = 0;
+
+    for (size_t i = 0; i < dim; i += distanceBlockSize)
+    {
+        result += kernels.sumAbsDiff(op1 + i, op2 + i, std::min(distanceBlockSize, dim - i));
+        if (!(result < bound))
+            break;
+    }
+
+    return result;
+}
+
+double VectorKernels::sumSquaresDiff(double const* op1, double const* op2, size_t dim, double bound)
+{
+    const KernelTable& kernels = table();
+    double result = 0;
+
+    for (size_t i = 0; i < dim; i += distanceBlockSize)
+    {
+        result += kernels.sumSquaresDiff(op1 + i, op2 + i, std::min(distanceBlockSize, dim - i));
+        if (!(result < bound))
+            break;
+    }
+
+    return result;
+}
+
+double VectorKernels::maxAbsDiff(double const* op1, double const* op2, size_t dim, double bound)
+{
+    const KernelTable& kernels = table();
+    double result = 0;
+
+    for (size_t i = 0; i < dim; i += distanceBlockSize)
+    {
+        const double blockMax = kernels.maxAbsDiff(op1 + i, op2 + i, std::min(distanceBlockSize, dim - i));
+        if (blockMax > result)
+            result = blockMax;
+        if (!(result < bound))
+            break;
+    }
+
+    return result;
+}
+
+double VectorKernels::distance(double const* op1, double const* op2, size_t dim, IVector::NORM n, double bound)
+{
+    switch (n)
+    {
+        case IVector::NORM::FIRST:
+            return sumAbsDiff(op1, op2, dim, bound);
+        case IVector::NORM::SECOND:
+            return sqrt(sumSquaresDiff(op1, op2, dim, bound * bound));
+        case IVector::NORM::CHEBYSHEV:
+            return maxAbsDiff(op1, op2, dim, bound);
+        default:
+            return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+size_t VectorKernels::findWithin(double const* rows, size_t count, size_t dim, double const* pat, IVector::NORM n, double tol, size_t& visited)
+{
+    visited = 0;
+    if (dim == 0)
+        return count;
+
+    // |row[0] - pat[0]| doesn't exceed any of the norms, radius is widened by a few ulps for rounding in the kernels
+    const double radius = tol * (1 + 4 * std::numeric_limits<double>::epsilon());
+    const double center = pat[0];
+    bool near[rowBlockSize];
+
+    for (size_t start = 0; start < count; start += rowBlockSize)
+    {
+        const size_t rowsInBlock = std::min(rowBlockSize, count - start);
+        double const* block = rows + start * dim;
+
+        for (size_t r = 0; r < rowsInBlock; r++)
+            near[r] = std::fabs(block[r * dim] - center) <= radius;
+
+        for (size_t r = 0; r < rowsInBlock; r++)
+        {
+            if (near[r] && distance(block + r * dim, pat, dim, n, tol) < tol)
+            {
+                visited = start + r + 1;
+                return start + r;
+            }
+        }
+    }
+
+    visited = count;
+    return count;
+}
+
+bool VectorKernels::isFinite(double const* data, size_t dim)
+{
+    return table().isFinite(data, dim);
+}
+
+void VectorKernels::copy(void* dst, void const* src, size_t bytes)
+{
+#ifdef IVECTOR_X86_KERNELS
+    if (bytes >= streamingThreshold.load(std::memory_order_relaxed) && table().isa != ISA::SCALAR)
+    {
+        streamingCopySSE2(static_cast<uint8_t*>(dst), static_cast<uint8_t const*>(src), bytes);
+        return;
+    }
+#endif
+
+    memcpy(dst, src, bytes);
+}
+
+size_t VectorKernels::getStreamingThreshold()
+{
+    return streamingThreshold.load(std::memory_order_relaxed);
+}
+
+void VectorKernels::setStreamingThreshold(size_t bytes)
+{
+    streamingThreshold.store(bytes, std::memory_order_relaxed);
+}
+
+VectorKernels::Scratch::Scratch(size_t dim)
+{
+    if (scratchDepth == scratchBuffers.size())
+        scratchBuffers.emplace_back();
+
+    std::vector<double>& buffer = scratchBuffers[scratchDepth++];
+    if (buffer.size() < dim)
+        buffer.resize(dim);
+
+    _data = buffer.data();
+}
+
+VectorKernels::Scratch::~Scratch()
+{
+    scratchDepth--;
+}
+
+VectorKernels::ISA VectorKernels::getISA()
+{
+    return table().isa;
+}
+
+RC VectorKernels::setISA(ISA isa)
+{
+    if (!isSupported(isa))
+        return RC::INVALID_ARGUMENT;
+
+    currentTable().store(tableOf(isa), std::memory_order_release);
+    return RC::SUCCESS;
+}
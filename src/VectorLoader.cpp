@@ -0,0 +1,298 @@
+#ifndef IVECTOR_VECTORLOADER_H
+#define IVECTOR_VECTORLOADER_H
+
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../include/ISet.h"
+#include "../include/VectorKernels.h"
+
+namespace {
+    /*
+    * Streaming reader behind ISet::load(). A parser thread reads the file in chunks of loadChunkBytes, turns
+    * every chunk into a batch of rows without invalid ones and queues it. The caller takes batches with next()
+    * and inserts them while the following chunks are parsed. At most loadQueueDepth batches wait in the queue,
+    * so memory doesn't depend on the size of the file, and buffers of inserted batches are reused
+    */
+    class VectorLoader {
+    public:
+        static constexpr size_t loadChunkBytes = 1 << 20;
+        static constexpr size_t loadQueueDepth = 4;
+
+        struct Batch {
+            std::vector<double> rows;
+            // Rows found in the chunk, rejected ones included
+            size_t read = 0;
+            // Rows with wrong number of coordinates, unparsable numbers, Inf or NaN
+            size_t rejected = 0;
+        };
+
+        VectorLoader(ISet::FILE_FORMAT format, size_t dim) : _format(format), _dim(dim) {}
+
+        // Opens the file and starts the parser thread
+        RC start(char const* const& path)
+        {
+            _file.open(path, std::ios::binary);
+            if (!_file.is_open())
+                return RC::FILE_NOT_FOUND;
+
+            try
+            {
+                _parser = std::thread(&VectorLoader::run, this);
+            }
+            catch (std::system_error const&)
+            {
+                return RC::UNKNOWN;
+            }
+
+            return RC::SUCCESS;
+        }
+
+        // Replaces batch with the next one, false after the last. Buffer of the old batch is reused
+        bool next(Batch& batch)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (batch.rows.capacity() != 0)
+                _free.push_back(std::move(batch.rows));
+
+            _changed.wait(lock, [this] { return !_ready.empty() || _done; });
+            if (_ready.empty())
+                return false;
+
+            batch = std::move(_ready.front());
+            _ready.pop_front();
+            _changed.notify_all();
+            return true;
+        }
+
+        // Error of the parser, valid after next() returned false
+        RC getResult() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _result;
+        }
+
+        // Stops the parser if the caller gave up early
+        ~VectorLoader()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _changed.notify_all();
+
+            if (_parser.joinable())
+                _parser.join();
+        }
+
+    private:
+        const ISet::FILE_FORMAT _format;
+        const size_t _dim;
+        std::ifstream _file;
+        std::thread _parser;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _changed;
+        std::deque<Batch> _ready;
+        std::vector<std::vector<double>> _free;
+        bool _done = false;
+        bool _stop = false;
+        RC _result = RC::SUCCESS;
+
+        void run()
+        {
+            RC result;
+            try
+            {
+                result = _format == ISet::FILE_FORMAT::CSV ? parseCsv() : parseBinary();
+            }
+            catch (std::bad_alloc const&)
+            {
+                result = RC::ALLOCATION_ERROR;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _result = result;
+            _done = true;
+            _changed.notify_all();
+        }
+
+        Batch takeBatch()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            Batch batch;
+            if (!_free.empty())
+            {
+                batch.rows = std::move(_free.back());
+                _free.pop_back();
+                batch.rows.clear();
+            }
+
+            return batch;
+        }
+
+        // Waits for room in the queue, false if the caller stopped reading
+        bool push(Batch& batch)
+        {
+            dropInvalid(batch);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [this] { return _stop || _ready.size() < loadQueueDepth; });
+            if (_stop)
+                return false;
+
+            _ready.push_back(std::move(batch));
+            _changed.notify_all();
+            return true;
+        }
+
+        // One check over the whole batch, rows are checked one by one only if it fails
+        void dropInvalid(Batch& batch) const
+        {
+            std::vector<double>& rows = batch.rows;
+            if (VectorKernels::isFinite(rows.data(), rows.size()))
+                return;
+
+            size_t kept = 0;
+            for (size_t row = 0; row < rows.size(); row += _dim)
+            {
+                if (!VectorKernels::isFinite(rows.data() + row, _dim))
+                {
+                    batch.rejected++;
+                    continue;
+                }
+
+                if (kept != row)
+                    memmove(rows.data() + kept, rows.data() + row, _dim * sizeof(double));
+
+                kept += _dim;
+            }
+
+            rows.resize(kept);
+        }
+
+        RC parseBinary()
+        {
+            const size_t rowBytes = _dim * sizeof(double);
+            const size_t chunkRows = loadChunkBytes / rowBytes != 0 ? loadChunkBytes / rowBytes : 1;
+            while (true)
+            {
+                Batch batch = takeBatch();
+                batch.rows.resize(chunkRows * _dim);
+                _file.read(reinterpret_cast<char*>(batch.rows.data()), (std::streamsize)(chunkRows * rowBytes));
+                if (_file.bad())
+                    return RC::IO_ERROR;
+
+                // Only the last chunk may be shorter, a piece of a row at the end of the file is rejected
+                const size_t bytes = (size_t)_file.gcount();
+                batch.read = (bytes + rowBytes - 1) / rowBytes;
+                batch.rejected = bytes % rowBytes != 0 ? 1 : 0;
+                batch.rows.resize(bytes / rowBytes * _dim);
+
+                if (batch.read != 0 && !push(batch))
+                    return RC::SUCCESS;
+
+                if (bytes < chunkRows * rowBytes)
+                    return RC::SUCCESS;
+            }
+        }
+
+        RC parseCsv()
+        {
+            // Unfinished line of the previous chunk is moved to the front
+            std::vector<char> buffer;
+            size_t kept = 0;
+            bool isEnd = false;
+            while (!isEnd)
+            {
+                buffer.resize(kept + loadChunkBytes);
+                _file.read(buffer.data() + kept, (std::streamsize)loadChunkBytes);
+                if (_file.bad())
+                    return RC::IO_ERROR;
+
+                const size_t size = kept + (size_t)_file.gcount();
+                isEnd = _file.eof();
+
+                char const* begin = buffer.data();
+                char const* end = begin + size;
+                // Everything is complete at the end of the file, even without the last line break
+                char const* last = end;
+                if (!isEnd)
+                {
+                    while (last != begin && last[-1] != '\n')
+                        last--;
+                }
+
+                Batch batch = takeBatch();
+                while (begin != last)
+                {
+                    char const* lineEnd = static_cast<char const*>(memchr(begin, '\n', (size_t)(last - begin)));
+                    if (!lineEnd)
+                        lineEnd = last;
+
+                    parseLine(begin, lineEnd, batch);
+                    begin = lineEnd != last ? lineEnd + 1 : last;
+                }
+
+                if (batch.read != 0 && !push(batch))
+                    return RC::SUCCESS;
+
+                kept = (size_t)(end - last);
+                memmove(buffer.data(), last, kept);
+            }
+
+            return RC::SUCCESS;
+        }
+
+        static char const* skipBlanks(char const* pos, char const* end)
+        {
+            while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+                pos++;
+
+            return pos;
+        }
+
+        // Comma separated numbers, blank lines are skipped. Inf and NaN are dropped later by dropInvalid()
+        void parseLine(char const* begin, char const* end, Batch& batch) const
+        {
+            char const* pos = skipBlanks(begin, end);
+            if (pos == end)
+                return;
+
+            batch.read++;
+            std::vector<double>& rows = batch.rows;
+            const size_t start = rows.size();
+            rows.resize(start + _dim);
+
+            for (size_t i = 0; i < _dim; i++)
+            {
+                pos = skipBlanks(pos, end);
+                if (pos != end && *pos == '+')
+                    pos++;
+
+                const std::from_chars_result result = std::from_chars(pos, end, rows[start + i]);
+                pos = skipBlanks(result.ptr, end);
+                const bool isLast = i + 1 == _dim;
+                if (result.ec != std::errc() || (isLast ? pos != end : pos == end || *pos != ','))
+                {
+                    rows.resize(start);
+                    batch.rejected++;
+                    return;
+                }
+
+                if (!isLast)
+                    pos++;
+            }
+        }
+    };
+}
+
+#endif //IVECTOR_VECTORLOADER_H
@@ -0,0 +1,317 @@
+#ifndef IVECTOR_VECTORVIEWIMPL_H
+#define IVECTOR_VECTORVIEWIMPL_H
+
+#include "../include/IVectorView.h"
+#include "../include/ValidChecker.h"
+#include "../include/VectorKernels.h"
+#include "../include/VectorExpression.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    class VectorViewImpl : public IVectorView {
+    private:
+        double* _data = nullptr;
+        size_t _dim = 0;
+        bool _mutable = false;
+        Epoch _epoch;
+        size_t _epochValue = 0;
+
+        static ILogger* pLogger;
+
+        RC checkModifiable() const;
+
+    public:
+        static void log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line);
+
+        static RC setLogger(ILogger* const logger);
+
+        VectorViewImpl(size_t dim, double* data, bool isMutable, Epoch const& epoch);
+
+        bool isValid() const override;
+        bool isMutable() const override;
+
+        RC rebind(size_t dim, double const* const& ptr_data, Epoch const& epoch) override;
+        RC rebindMutable(size_t dim, double* const& ptr_data, Epoch const& epoch) override;
+
+        IVector* clone() const override;
+        double const* getData() const override;
+        RC setData(size_t dim, double const* const& ptr_data) override;
+
+        RC getCord(size_t index, double& val) const override;
+        RC setCord(size_t index, double val) override;
+        RC scale(double multiplier) override;
+        size_t getDim() const override;
+        PRECISION getPrecision() const override;
+
+        RC inc(IVector const* const& op) override;
+        RC dec(IVector const* const& op) override;
+
+        double norm(NORM n) const override;
+
+        RC applyFunction(const std::function<double(double)>& fun) override;
+        RC foreach(const std::function<void(double)>& fun) const override;
+
+        size_t sizeAllocated() const override;
+
+        ~VectorViewImpl() override = default;
+
+    protected:
+        double* getMutableData() override;
+    };
+
+    ILogger* VectorViewImpl::pLogger = nullptr;
+}
+
+VectorViewImpl::VectorViewImpl(size_t dim, double* data, bool isMutable, Epoch const& epoch) :
+    _data(data), _dim(dim), _mutable(isMutable), _epoch(epoch), _epochValue(epoch ? *epoch : 0)
+{}
+
+RC VectorViewImpl::setLogger(ILogger* const logger)
+{
+    if (!logger)
+    {
+        log(RC::NULLPTR_ERROR, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::NULLPTR_ERROR;
+    }
+
+    pLogger = logger;
+    return RC::SUCCESS;
+}
+
+void VectorViewImpl::log(RC code, ILogger::Level level, const char* const& srcfile, const char* const& function, int line)
+{
+    if (pLogger != nullptr)
+        pLogger->log(code, level, srcfile, function, line);
+}
+
+bool VectorViewImpl::isValid() const
+{
+    return !_epoch || *_epoch == _epochValue;
+}
+
+bool VectorViewImpl::isMutable() const
+{
+    return _mutable;
+}
+
+RC VectorViewImpl::checkModifiable() const
+{
+    if (!_mutable)
+        return RC::INVALID_ARGUMENT;
+
+    if (!isValid())
+        return RC::SOURCE_SET_DESTROYED;
+
+    return RC::SUCCESS;
+}
+
+RC VectorViewImpl::rebind(size_t dim, double const* const& ptr_data, Epoch const& epoch)
+{
+    if (dim == 0 || !ptr_data)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    // Read-only view never writes through _data
+    _data = const_cast<double*>(ptr_data);
+    _dim = dim;
+    _mutable = false;
+    _epoch = epoch;
+    _epochValue = epoch ? *epoch : 0;
+    return RC::SUCCESS;
+}
+
+RC VectorViewImpl::rebindMutable(size_t dim, double* const& ptr_data, Epoch const& epoch)
+{
+    RC rc = rebind(dim, ptr_data, epoch);
+    if (rc == RC::SUCCESS)
+        _mutable = true;
+
+    return rc;
+}
+
+IVector* VectorViewImpl::clone() const
+{
+    return IVector::createVector(_dim, _data);
+}
+
+double const* VectorViewImpl::getData() const
+{
+    return _data;
+}
+
+double* VectorViewImpl::getMutableData()
+{
+    return checkModifiable() == RC::SUCCESS ? _data : nullptr;
+}
+
+RC VectorViewImpl::setData(size_t dim, double const* const& ptr_data)
+{
+    RC rc = checkModifiable();
+    if (rc == RC::SUCCESS && (!ptr_data || dim != _dim))
+        rc = RC::INVALID_ARGUMENT;
+
+    if (rc == RC::SUCCESS && !VectorKernels::isFinite(ptr_data, dim))
+        rc = RC::NOT_NUMBER;
+
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    memmove(_data, ptr_data, _dim * sizeof(double));
+    return RC::SUCCESS;
+}
+
+RC VectorViewImpl::getCord(size_t index, double& val) const
+{
+    if (index >= _dim)
+    {
+        log(RC::INDEX_OUT_OF_BOUND, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INDEX_OUT_OF_BOUND;
+    }
+
+    val = _data[index];
+    return RC::SUCCESS;
+}
+
+RC VectorViewImpl::setCord(size_t index, double val)
+{
+    RC rc = checkModifiable();
+    if (rc == RC::SUCCESS && index >= _dim)
+        rc = RC::INDEX_OUT_OF_BOUND;
+
+    if (rc == RC::SUCCESS && !ValidChecker::isValidNumber(val))
+        rc = RC::INVALID_ARGUMENT;
+
+    if (rc != RC::SUCCESS)
+    {
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return rc;
+    }
+
+    _data[index] = val;
+    return RC::SUCCESS;
+}
+
+RC VectorViewImpl::scale(double multiplier)
+{
+    RC rc = checkModifiable();
+    if (rc == RC::SUCCESS && !ValidChecker::isValidNumber(multiplier))
+        rc = RC::INVALID_ARGUMENT;
+
+    using namespace VectorExpression;
+    if (rc == RC::SUCCESS)
+        rc = IVector::assign(this, multiplier * vec(this));
+
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+size_t VectorViewImpl::getDim() const
+{
+    return _dim;
+}
+
+IVector::PRECISION VectorViewImpl::getPrecision() const
+{
+    return PRECISION::DOUBLE;
+}
+
+RC VectorViewImpl::inc(IVector const* const& op)
+{
+    RC rc = checkModifiable();
+
+    using namespace VectorExpression;
+    if (rc == RC::SUCCESS)
+        rc = op ? IVector::assign(this, vec(this) + vec(op)) : RC::NULLPTR_ERROR;
+
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC VectorViewImpl::dec(IVector const* const& op)
+{
+    RC rc = checkModifiable();
+
+    using namespace VectorExpression;
+    if (rc == RC::SUCCESS)
+        rc = op ? IVector::assign(this, vec(this) - vec(op)) : RC::NULLPTR_ERROR;
+
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+double VectorViewImpl::norm(NORM n) const
+{
+    double result = 0;
+
+    switch (n)
+    {
+        case NORM::FIRST:
+            result = VectorKernels::sumAbs(_data, _dim);
+            break;
+
+        case NORM::SECOND:
+            result = sqrt(VectorKernels::sumSquares(_data, _dim));
+            break;
+
+        case NORM::CHEBYSHEV:
+            result = VectorKernels::maxAbs(_data, _dim);
+            break;
+
+        default:
+        {
+            log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    if (!ValidChecker::isValidNumber(result))
+    {
+        log(RC::INFINITY_OVERFLOW, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return result;
+}
+
+RC VectorViewImpl::applyFunction(const std::function<double(double)>& fun)
+{
+    RC rc = checkModifiable();
+    if (rc == RC::SUCCESS)
+        rc = fun ? applyInline(fun) : RC::INVALID_ARGUMENT;
+
+    if (rc != RC::SUCCESS)
+        log(rc, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+
+    return rc;
+}
+
+RC VectorViewImpl::foreach(const std::function<void(double)>& fun) const
+{
+    if (!fun)
+    {
+        log(RC::INVALID_ARGUMENT, ILogger::Level::SEVERE, __FILE__, __FUNCTION__, __LINE__);
+        return RC::INVALID_ARGUMENT;
+    }
+
+    return forEachInline(fun);
+}
+
+size_t VectorViewImpl::sizeAllocated() const
+{
+    return sizeof(*this);
+}
+
+#endif //IVECTOR_VECTORVIEWIMPL_H
@@ -0,0 +1,235 @@
+#ifndef IVECTOR_WORKERPOOL_H
+#define IVECTOR_WORKERPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+    /*
+    * Threads shared by set algebra. run() queues a job of parts, the workers and the calling thread take parts
+    * until none is left, and run() returns after every part is done. Jobs of different callers share the workers
+    * and run at the same time, a part may call run() itself: the caller of a job takes its parts too, so every job
+    * finishes even if all workers are busy. An exception from a part stops the job and is rethrown by run()
+    * once no thread works on it any more
+    */
+    class WorkerPool {
+    public:
+        static WorkerPool& instance()
+        {
+            static WorkerPool pool;
+            return pool;
+        }
+
+        /*
+        * Threads including the caller of run(), 0 means one per hardware thread. Workers are started at once,
+        * false if some of them couldn't be, the pool keeps those which were
+        */
+        bool setThreadCount(size_t count)
+        {
+            std::lock_guard<std::mutex> workersLock(_workersMutex);
+            stopWorkers();
+            _threadCount = count != 0 ? count : hardwareThreads();
+            return startWorkers();
+        }
+
+        size_t getThreadCount() const
+        {
+            return _threadCount;
+        }
+
+        void run(size_t parts, std::function<void(size_t)> const& task)
+        {
+            if (_threadCount <= 1 || parts <= 1 || !tryStartWorkers())
+            {
+                for (size_t part = 0; part < parts; part++)
+                    task(part);
+
+                return;
+            }
+
+            Job job(task, parts);
+            try
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _jobs.push_back(&job);
+            }
+            catch (std::bad_alloc const&)
+            {
+                // Nobody else can see the job, the caller does all of it
+            }
+            _wake.notify_all();
+
+            work(job);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            dequeue(&job);
+            _finished.wait(lock, [&job] { return job.active == 0; });
+            lock.unlock();
+
+            if (job.error)
+                std::rethrow_exception(job.error);
+        }
+
+        ~WorkerPool()
+        {
+            std::lock_guard<std::mutex> workersLock(_workersMutex);
+            stopWorkers();
+        }
+
+    private:
+        struct Job {
+            Job(std::function<void(size_t)> const& task, size_t parts) : task(task), parts(parts) {}
+
+            std::function<void(size_t)> const& task;
+            const size_t parts;
+            std::atomic<size_t> next{0};
+            std::atomic<bool> failed{false};
+            // Guarded by WorkerPool::_mutex: workers inside work(), the first exception of a part
+            size_t active = 0;
+            std::exception_ptr error;
+        };
+
+        std::atomic<size_t> _threadCount{hardwareThreads()};
+
+        // Guards _workers, so that callers starting them and setThreadCount() don't race
+        std::mutex _workersMutex;
+        std::vector<std::thread> _workers;
+        // _workers.size(), read without the lock
+        std::atomic<size_t> _workerCount{0};
+
+        // Guards everything below and Job::active, Job::error
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _finished;
+        // Jobs which may still have parts to take, a job is removed before its run() returns
+        std::deque<Job*> _jobs;
+        bool _stop = false;
+
+        static size_t hardwareThreads()
+        {
+            return std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        // Parts are taken until none is left or one of them failed
+        void work(Job& job)
+        {
+            for (size_t part; !job.failed.load(std::memory_order_relaxed) &&
+                              (part = job.next.fetch_add(1, std::memory_order_relaxed)) < job.parts;)
+            {
+                try
+                {
+                    job.task(part);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (!job.error)
+                        job.error = std::current_exception();
+                    job.failed.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void dequeue(Job* job)
+        {
+            auto it = std::find(_jobs.begin(), _jobs.end(), job);
+            if (it != _jobs.end())
+                _jobs.erase(it);
+        }
+
+        void loop()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                _wake.wait(lock, [this] { return _stop || !_jobs.empty(); });
+                if (_stop)
+                    return;
+
+                // Jobs whose parts are all taken finish without help
+                Job* job = _jobs.front();
+                if (job->failed.load(std::memory_order_relaxed) || job->next.load(std::memory_order_relaxed) >= job->parts)
+                {
+                    _jobs.pop_front();
+                    continue;
+                }
+
+                job->active++;
+                lock.unlock();
+
+                work(*job);
+
+                lock.lock();
+                if (--job->active == 0)
+                    _finished.notify_all();
+            }
+        }
+
+        // _workersMutex must be held, false if not every worker could be started
+        bool startWorkers()
+        {
+            try
+            {
+                while (_workers.size() + 1 < _threadCount)
+                    _workers.emplace_back(&WorkerPool::loop, this);
+            }
+            catch (std::system_error const&)
+            {
+                _workerCount = _workers.size();
+                return false;
+            }
+            catch (std::bad_alloc const&)
+            {
+                _workerCount = _workers.size();
+                return false;
+            }
+
+            _workerCount = _workers.size();
+            return true;
+        }
+
+        /*
+        * False if there is no worker, run() does the job on the calling thread then. Doesn't wait for
+        * setThreadCount(): a part calling run() would wait for a stop which waits for the part
+        */
+        bool tryStartWorkers()
+        {
+            if (_workerCount.load() + 1 >= _threadCount)
+                return true;
+
+            std::unique_lock<std::mutex> workersLock(_workersMutex, std::try_to_lock);
+            if (workersLock.owns_lock())
+                startWorkers();
+
+            return _workerCount.load() != 0;
+        }
+
+        // _workersMutex must be held. Jobs in flight are finished by their callers
+        void stopWorkers()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _wake.notify_all();
+
+            for (std::thread& worker : _workers)
+                worker.join();
+
+            _workers.clear();
+            _workerCount = 0;
+            _stop = false;
+        }
+    };
+}
+
+#endif //IVECTOR_WORKERPOOL_H
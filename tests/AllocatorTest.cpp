@@ -0,0 +1,132 @@
+#include "Check.h"
+#include "../include/IVector.h"
+#include "../include/IVectorArena.h"
+#include "../include/VectorAllocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+    std::vector<double> makeCoords(size_t dim, double shift)
+    {
+        std::vector<double> coords(dim);
+        for (size_t i = 0; i < dim; i++)
+            coords[i] = shift + 0.5 * i;
+
+        return coords;
+    }
+
+    bool holds(IVector const* vector, std::vector<double> const& coords)
+    {
+        return vector && vector->getDim() == coords.size() && std::equal(coords.begin(), coords.end(), vector->getData());
+    }
+
+    bool isAligned(IVector const* vector)
+    {
+        return reinterpret_cast<uintptr_t>(vector->getData()) % VectorAllocator::dataAlignment == 0;
+    }
+
+    // Pooled and fresh instances of every size hold their own coordinates, aligned
+    void checkPool()
+    {
+        for (size_t dim : {1, 2, 3, 4, 5, 8, 17, 100, 1000})
+        {
+            const std::vector<double> coords1 = makeCoords(dim, 1), coords2 = makeCoords(dim, -3);
+            for (size_t round = 0; round < 3; round++)
+            {
+                IVector* vector1 = IVector::createVector(dim, coords1.data());
+                IVector* vector2 = IVector::createVector(dim, coords2.data());
+                CHECK(holds(vector1, coords1) && holds(vector2, coords2));
+                CHECK(isAligned(vector1) && isAligned(vector2));
+
+                IVector* sum = IVector::add(vector1, vector2);
+                IVector* copy = vector2->clone();
+                CHECK(holds(copy, coords2));
+                CHECK(sum && sum->getData()[dim - 1] == coords1[dim - 1] + coords2[dim - 1]);
+                delete sum;
+                delete copy;
+                delete vector1;
+                delete vector2;
+            }
+        }
+
+        // Blocks of one size come back from the free list of the thread
+        const std::vector<double> coords = makeCoords(17, 0);
+        VectorAllocator::resetStats();
+        for (size_t i = 0; i < 100; i++)
+            delete IVector::createVector(coords.size(), coords.data());
+
+        const VectorAllocator::Stats stats = VectorAllocator::getStats();
+        CHECK(stats.requests == 100);
+        CHECK(stats.poolHits + stats.systemAllocations == stats.requests);
+        CHECK(stats.poolHits >= 99);
+    }
+
+    void checkArena()
+    {
+        IVectorArena* arena = IVectorArena::createArena(4096);
+        CHECK(arena != nullptr);
+        if (!arena)
+            return;
+
+        VectorAllocator::resetStats();
+        std::vector<IVector*> vectors;
+        for (size_t i = 0; i < 500; i++)
+        {
+            const std::vector<double> coords = makeCoords(1 + i % 40, (double)i);
+            vectors.push_back(IVector::createVector(coords.size(), coords.data(), arena));
+            CHECK(holds(vectors.back(), coords) && isAligned(vectors.back()));
+        }
+
+        // Every vector keeps its coordinates until reset, delete doesn't release arena memory
+        for (size_t i = 0; i < vectors.size(); i++)
+            CHECK(holds(vectors[i], makeCoords(1 + i % 40, (double)i)));
+
+        CHECK(arena->getAllocationsCount() == 500);
+        CHECK(VectorAllocator::getStats().arenaHits == 500);
+        delete vectors[0];
+        CHECK(holds(vectors[1], makeCoords(2, 1)));
+
+        CHECK(arena->reset() == RC::SUCCESS);
+        CHECK(arena->getAllocationsCount() == 0);
+        const std::vector<double> coords = makeCoords(5000, 2);
+        IVector* large = IVector::createVector(coords.size(), coords.data(), arena);
+        CHECK(holds(large, coords));
+        delete arena;
+    }
+
+    // A vector may be deleted by another thread than the one that created it
+    void checkThreads()
+    {
+        std::vector<IVector*> vectors(1000);
+        std::thread creator([&vectors]() {
+            for (size_t i = 0; i < vectors.size(); i++)
+            {
+                const std::vector<double> coords = makeCoords(1 + i % 20, (double)i);
+                vectors[i] = IVector::createVector(coords.size(), coords.data());
+            }
+        });
+        creator.join();
+
+        size_t wrong = 0;
+        std::thread deleter([&vectors, &wrong]() {
+            for (size_t i = 0; i < vectors.size(); i++)
+            {
+                wrong += !holds(vectors[i], makeCoords(1 + i % 20, (double)i));
+                delete vectors[i];
+            }
+        });
+        deleter.join();
+        CHECK(wrong == 0);
+    }
+}
+
+int main()
+{
+    checkPool();
+    checkArena();
+    checkThreads();
+    VectorAllocator::releaseCached();
+    return failures;
+}
@@ -0,0 +1,143 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/IVector.h"
+#include "../include/VectorExpression.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    std::vector<double> randomData(std::mt19937& rng, size_t dim)
+    {
+        std::uniform_real_distribution<double> coordinate(-10, 10);
+        std::vector<double> data(dim);
+        for (double& value : data)
+            value = coordinate(rng);
+        return data;
+    }
+
+    bool hasData(IVector const* vector, std::vector<double> const& expected)
+    {
+        double const* data = vector->getData();
+        for (size_t i = 0; i < expected.size(); i++)
+            if (!Reference::isClose(data[i], expected[i], std::fabs(expected[i]) + 10, 4))
+                return false;
+        return true;
+    }
+
+    bool hasExactData(IVector const* vector, std::vector<double> const& expected)
+    {
+        double const* data = vector->getData();
+        for (size_t i = 0; i < expected.size(); i++)
+            if (data[i] != expected[i])
+                return false;
+        return true;
+    }
+
+    void checkArithmetic(std::mt19937& rng, size_t dim)
+    {
+        using namespace VectorExpression;
+
+        std::vector<double> x = randomData(rng, dim), y = randomData(rng, dim), z = randomData(rng, dim);
+        IVector* vx = IVector::createVector(dim, x.data());
+        IVector* vy = IVector::createVector(dim, y.data());
+        IVector* vz = IVector::createVector(dim, z.data());
+        IVector* dest = IVector::createVector(dim, z.data());
+        std::vector<double> expected(dim);
+
+        CHECK(IVector::axpy(2.5, vx, vy) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 2.5 * x[i] + y[i];
+        CHECK(hasData(vy, expected));
+        y = expected;
+
+        CHECK(IVector::axpby(-1.5, vx, 0.5, vy) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = -1.5 * x[i] + 0.5 * y[i];
+        CHECK(hasData(vy, expected));
+        y = expected;
+
+        CHECK(IVector::scaleAdd(dest, 3, vx, vy) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 3 * x[i] + y[i];
+        CHECK(hasData(dest, expected));
+
+        CHECK(IVector::combine(dest, 2, vx, -3, vy, vz) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 2 * x[i] - 3 * y[i] - z[i];
+        CHECK(hasData(dest, expected));
+
+        CHECK(IVector::linearCombination(dest, {{1, vx}, {-2, vy}, {0.25, vz}, {4, vx}}) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 5 * x[i] - 2 * y[i] + 0.25 * z[i];
+        CHECK(hasData(dest, expected));
+
+        CHECK(IVector::assign(dest, vec(vx) + 0.5 * vec(vy) - vec(vz) * 2 - (-vec(vx))) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = x[i] + 0.5 * y[i] - 2 * z[i] + x[i];
+        CHECK(hasData(dest, expected));
+
+        // Destination is an operand
+        CHECK(IVector::scaleAdd(vx, 2, vx, vy) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 2 * x[i] + y[i];
+        CHECK(hasData(vx, expected));
+        x = std::vector<double>(vx->getData(), vx->getData() + dim);
+
+        CHECK(IVector::assign(vy, vec(vy) - vec(vx) + vec(vy)) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 2 * y[i] - x[i];
+        CHECK(hasData(vy, expected));
+        y = std::vector<double>(vy->getData(), vy->getData() + dim);
+
+        // Overflow leaves the destination as it was
+        const double huge = std::numeric_limits<double>::max();
+        CHECK(IVector::axpy(huge, vx, vy) == RC::INFINITY_OVERFLOW);
+        CHECK(hasExactData(vy, y));
+        CHECK(IVector::linearCombination(vy, {{huge, vx}, {huge, vx}}) != RC::SUCCESS);
+        CHECK(hasExactData(vy, y));
+        CHECK(IVector::assign(vy, huge * vec(vx) + huge * vec(vx)) == RC::INFINITY_OVERFLOW);
+        CHECK(hasExactData(vy, y));
+
+        // Invalid arguments
+        CHECK(IVector::axpy(std::nan(""), vx, vy) == RC::INVALID_ARGUMENT);
+        CHECK(IVector::axpby(1, vx, std::numeric_limits<double>::infinity(), vy) == RC::INVALID_ARGUMENT);
+        CHECK(hasExactData(vy, y));
+
+        IVector* other = IVector::createVector(dim + 1, randomData(rng, dim + 1).data());
+        CHECK(IVector::axpy(1, other, vy) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(IVector::combine(dest, 1, vx, 1, vy, other) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(IVector::linearCombination(dest, {{1, vx}, {1, other}}) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(IVector::assign(dest, vec(vx) + vec(other)) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(IVector::assign(nullptr, vec(vx)) == RC::NULLPTR_ERROR);
+        CHECK(hasExactData(vy, y));
+
+        // Old allocating API agrees
+        IVector* sum = IVector::add(vx, vy);
+        IVector* difference = IVector::sub(vx, vy);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = x[i] + y[i];
+        CHECK(sum && hasData(sum, expected));
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = x[i] - y[i];
+        CHECK(difference && hasData(difference, expected));
+
+        delete sum;
+        delete difference;
+        delete other;
+        delete vx;
+        delete vy;
+        delete vz;
+        delete dest;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(4);
+    for (size_t dim : {1, 2, 3, 4, 5, 8, 17, 511, 512, 513, 1500})
+        checkArithmetic(rng, dim);
+
+    return failures;
+}
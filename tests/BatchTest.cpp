@@ -0,0 +1,177 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/ISet.h"
+#include "../include/IVectorBatch.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+    const IVectorBatch::LAYOUT layouts[] = {IVectorBatch::LAYOUT::ROW_MAJOR, IVectorBatch::LAYOUT::SOA};
+
+    std::vector<double> randomRows(std::mt19937& rng, size_t dim, size_t count)
+    {
+        std::uniform_real_distribution<double> coordinate(-10, 10);
+        std::vector<double> rows(dim * count);
+        for (double& value : rows)
+            value = coordinate(rng);
+        return rows;
+    }
+
+    bool isCloseRows(std::vector<double> const& actual, std::vector<double> const& expected)
+    {
+        for (size_t i = 0; i < expected.size(); i++)
+            if (!Reference::isClose(actual[i], expected[i], std::fabs(expected[i]) + 10, 4))
+                return false;
+        return true;
+    }
+
+    std::vector<double> exported(IVectorBatch const* batch)
+    {
+        std::vector<double> rows(batch->getDim() * batch->getCount());
+        CHECK(batch->exportRows(rows.data()) == RC::SUCCESS);
+        return rows;
+    }
+
+    void checkBatch(std::mt19937& rng, size_t dim, size_t count, IVectorBatch::LAYOUT layout)
+    {
+        std::vector<double> rows = randomRows(rng, dim, count);
+        IVectorBatch* batch = IVectorBatch::createBatch(dim, count, rows.data(), layout);
+        CHECK(batch && batch->getDim() == dim && batch->getCount() == count && batch->getLayout() == layout);
+        CHECK(exported(batch) == rows);
+
+        // Per-vector reference
+        std::vector<IVector*> vectors(count);
+        for (size_t i = 0; i < count; i++)
+            vectors[i] = IVector::createVector(dim, rows.data() + i * dim);
+
+        IVector* row = IVector::createVector(dim, rows.data());
+        for (size_t i = 0; i < count; i++)
+        {
+            CHECK(batch->getRow(i, row) == RC::SUCCESS);
+            CHECK(IVector::distance(row, vectors[i], IVector::NORM::CHEBYSHEV) == 0);
+        }
+        CHECK(batch->getRow(count, row) == RC::INDEX_OUT_OF_BOUND);
+
+        std::vector<double> results(count);
+        for (IVector::NORM n : norms)
+        {
+            CHECK(batch->norms(n, results.data()) == RC::SUCCESS);
+            for (size_t i = 0; i < count; i++)
+                CHECK(Reference::isClose(results[i], vectors[i]->norm(n), vectors[i]->norm(n), dim));
+        }
+
+        IVector* query = vectors[count / 2];
+        CHECK(batch->dots(query, results.data()) == RC::SUCCESS);
+        for (size_t i = 0; i < count; i++)
+        {
+            const double scale = vectors[i]->norm(IVector::NORM::SECOND) * query->norm(IVector::NORM::SECOND);
+            CHECK(Reference::isClose(results[i], Reference::dot(rows.data() + i * dim, query->getData(), dim), scale, dim));
+        }
+
+        // Tolerance between distances, rows too close to it are ambiguous under rounding
+        std::unique_ptr<bool[]> found(new bool[count]);
+        for (IVector::NORM n : norms)
+        {
+            const double tol = IVector::distance(vectors[0], query, n) * 1.5 + 1e-3;
+            CHECK(batch->equals(query, n, tol, found.get()) == RC::SUCCESS);
+            for (size_t i = 0; i < count; i++)
+            {
+                const double distance = Reference::distance(rows.data() + i * dim, query->getData(), dim, n);
+                if (std::fabs(distance - tol) > 1e-9 * tol)
+                    CHECK(found[i] == IVector::equals(vectors[i], query, n, tol));
+            }
+            CHECK(found[count / 2]);
+        }
+
+        // Modifications
+        std::vector<double> expected = rows;
+        CHECK(batch->scale(-0.5) == RC::SUCCESS);
+        for (double& value : expected)
+            value *= -0.5;
+        CHECK(isCloseRows(exported(batch), expected));
+
+        CHECK(batch->axpy(2, query) == RC::SUCCESS);
+        for (size_t i = 0; i < count; i++)
+            for (size_t j = 0; j < dim; j++)
+                expected[i * dim + j] += 2 * rows[count / 2 * dim + j];
+        CHECK(isCloseRows(exported(batch), expected));
+
+        // Other operand in the other layout
+        std::vector<double> otherRows = randomRows(rng, dim, count);
+        IVectorBatch* other = IVectorBatch::createBatch(dim, count, otherRows.data(),
+            layout == IVectorBatch::LAYOUT::SOA ? IVectorBatch::LAYOUT::ROW_MAJOR : IVectorBatch::LAYOUT::SOA);
+        CHECK(batch->axpy(-3, other) == RC::SUCCESS);
+        for (size_t i = 0; i < expected.size(); i++)
+            expected[i] += -3 * otherRows[i];
+        CHECK(isCloseRows(exported(batch), expected));
+
+        // Invalid results change nothing
+        const std::vector<double> before = exported(batch);
+        CHECK(batch->scale(std::numeric_limits<double>::max()) == RC::INFINITY_OVERFLOW);
+        CHECK(batch->axpy(std::numeric_limits<double>::max(), other) == RC::INFINITY_OVERFLOW);
+        CHECK(exported(batch) == before);
+
+        CHECK(batch->setRow(0, vectors[1]) == RC::SUCCESS && batch->getRow(0, row) == RC::SUCCESS);
+        CHECK(IVector::distance(row, vectors[1], IVector::NORM::CHEBYSHEV) == 0);
+        IVectorBatch* copy = batch->clone();
+        CHECK(copy && exported(copy) == exported(batch) && copy->getLayout() == layout);
+
+        IVector* longer = IVector::createVector(dim + 1, std::vector<double>(dim + 1, 1).data());
+        IVectorBatch* shorter = IVectorBatch::createBatch(dim, count - 1, layout);
+        CHECK(batch->setRow(0, longer) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(batch->dots(longer, results.data()) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(batch->axpy(1, shorter) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(batch->norms(IVector::NORM::SECOND, nullptr) == RC::INVALID_ARGUMENT);
+
+        // Set built from the batch is the set built vector by vector
+        const double tol = 5;
+        ISet* fromBatch = ISet::createSet();
+        ISet* oneByOne = ISet::createSet();
+        CHECK(batch->exportToSet(fromBatch, IVector::NORM::SECOND, tol) == RC::SUCCESS);
+        for (size_t i = 0; i < count; i++)
+        {
+            CHECK(batch->getRow(i, row) == RC::SUCCESS);
+            oneByOne->insert(row, IVector::NORM::SECOND, tol);
+        }
+        CHECK(fromBatch->getSize() == oneByOne->getSize());
+        CHECK(ISet::equals(fromBatch, oneByOne, IVector::NORM::CHEBYSHEV, 1e-12));
+
+        IVectorBatch* fromSet = IVectorBatch::createBatch(fromBatch, layout);
+        CHECK(fromSet && fromSet->getCount() == fromBatch->getSize());
+        std::vector<double> setRows(fromBatch->getSize() * dim);
+        CHECK(fromBatch->exportRange(0, fromBatch->getSize(), setRows.data(), dim) == RC::SUCCESS);
+        CHECK(exported(fromSet) == setRows);
+
+        IVectorBatch* fromVectors = IVectorBatch::createBatch(vectors.data(), count, layout);
+        CHECK(fromVectors && exported(fromVectors) == rows);
+
+        delete fromVectors;
+        delete fromSet;
+        delete fromBatch;
+        delete oneByOne;
+        delete shorter;
+        delete longer;
+        delete copy;
+        delete other;
+        delete row;
+        for (IVector* vector : vectors)
+            delete vector;
+        delete batch;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(8);
+    for (IVectorBatch::LAYOUT layout : layouts)
+        for (size_t dim : {1, 3, 4, 9, 64})
+            for (size_t count : {2, 7, 100})
+                checkBatch(rng, dim, count, layout);
+
+    CHECK(IVectorBatch::createBatch(size_t(0), size_t(5)) == nullptr);
+
+    return failures;
+}
@@ -0,0 +1,120 @@
+#include "Check.h"
+#include "../include/IVector.h"
+#include "../include/VectorExpression.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    bool hasExactData(IVector const* vector, std::vector<double> const& expected)
+    {
+        double const* data = vector->getData();
+        for (size_t i = 0; i < expected.size(); i++)
+            if (data[i] != expected[i])
+                return false;
+        return true;
+    }
+
+    // Callable that only moves, so it can't be copied into std::function
+    class Counter
+    {
+    public:
+        explicit Counter(size_t& calls) : _calls(calls) {}
+        Counter(Counter&&) = default;
+        Counter(Counter const&) = delete;
+
+        double operator()(double value) const
+        {
+            _calls++;
+            return 2 * value + 1;
+        }
+
+    private:
+        size_t& _calls;
+    };
+
+    void checkCallables(std::mt19937& rng, size_t dim)
+    {
+        std::uniform_real_distribution<double> coordinate(-100, 100);
+        std::vector<double> data(dim), other(dim), expected(dim);
+        for (size_t i = 0; i < dim; i++)
+        {
+            data[i] = coordinate(rng);
+            other[i] = coordinate(rng);
+        }
+
+        IVector* vector = IVector::createVector(dim, data.data());
+        IVector* operand = IVector::createVector(dim, other.data());
+        IVector* generic = IVector::createVector(dim, data.data());
+
+        // One call per coordinate, same result as std::function path
+        size_t calls = 0;
+        CHECK(vector->applyInline(Counter(calls)) == RC::SUCCESS);
+        CHECK(calls == dim);
+        CHECK(generic->applyFunction([](double value) { return 2 * value + 1; }) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = 2 * data[i] + 1;
+        CHECK(hasExactData(vector, expected));
+        CHECK(hasExactData(generic, expected));
+        data = expected;
+
+        double sum = 0, genericSum = 0;
+        calls = 0;
+        CHECK(vector->forEachInline([&](double value) { sum += value; calls++; }) == RC::SUCCESS);
+        CHECK(generic->foreach([&](double value) { genericSum += value; }) == RC::SUCCESS);
+        CHECK(calls == dim);
+        CHECK(sum == genericSum);
+
+        calls = 0;
+        CHECK(IVector::zipApply(vector, vector, operand, [&](double a, double b) { calls++; return a - 3 * b; }) == RC::SUCCESS);
+        CHECK(calls == dim);
+        for (size_t i = 0; i < dim; i++)
+            expected[i] = data[i] - 3 * other[i];
+        CHECK(hasExactData(vector, expected));
+        data = expected;
+
+        // Invalid result in the last coordinate: still one call each, nothing committed
+        calls = 0;
+        CHECK(vector->applyInline([&](double value) { return ++calls == dim ? std::numeric_limits<double>::infinity() : value; }) == RC::INFINITY_OVERFLOW);
+        CHECK(calls == dim);
+        CHECK(hasExactData(vector, data));
+
+        calls = 0;
+        CHECK(IVector::zipApply(vector, operand, operand, [&](double, double) { return ++calls == 1 ? std::nan("") : 0.0; }) == RC::INFINITY_OVERFLOW);
+        CHECK(calls == dim);
+        CHECK(hasExactData(vector, data));
+        CHECK(generic->applyFunction([](double) { return std::nan(""); }) != RC::SUCCESS);
+
+        const std::vector<double> ones(dim + 1, 1);
+        IVector* longer = IVector::createVector(dim + 1, ones.data());
+        CHECK(IVector::zipApply(vector, operand, longer, [](double a, double) { return a; }) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(IVector::zipApply(nullptr, operand, operand, [](double a, double) { return a; }) == RC::NULLPTR_ERROR);
+        CHECK(hasExactData(vector, data));
+
+        delete longer;
+        delete vector;
+        delete operand;
+        delete generic;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(5);
+    for (size_t dim : {1, 2, 3, 4, 7, 8, 64, 1000})
+        checkCallables(rng, dim);
+
+    // Compact vector can only be read
+    const double coords[5] = {1, 2, 3, 4, 5};
+    IVector* compact = IVector::createVector(5, coords, IVector::PRECISION::FLOAT);
+    size_t calls = 0;
+    double sum = 0;
+    CHECK(compact->applyInline([&](double value) { calls++; return value; }) == RC::INVALID_ARGUMENT);
+    CHECK(calls == 0);
+    CHECK(compact->forEachInline([&](double value) { sum += value; }) == RC::SUCCESS);
+    CHECK(sum == 15);
+    delete compact;
+
+    return failures;
+}
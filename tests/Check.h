@@ -0,0 +1,18 @@
+#ifndef IVECTOR_TESTS_CHECK_H
+#define IVECTOR_TESTS_CHECK_H
+
+#include <cstdio>
+
+// Every test is an executable, main() returns the number of failed checks
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#endif //IVECTOR_TESTS_CHECK_H
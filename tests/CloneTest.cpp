@@ -0,0 +1,155 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    typedef std::vector<std::vector<double>> Rows;
+
+    bool matches(ISet const* set, Rows const& model)
+    {
+        if (set->getSize() != model.size())
+            return false;
+
+        // Through the cursor and through getCopy(), they read storage differently
+        size_t i = 0;
+        for (double const* coords : *set)
+        {
+            if (i == model.size() || !std::equal(model[i].begin(), model[i].end(), coords))
+                return false;
+            i++;
+        }
+
+        for (i = 0; i < model.size(); i++)
+        {
+            IVector* vector = nullptr;
+            if (set->getCopy(i, vector) != RC::SUCCESS)
+                return false;
+
+            const bool isEqual = std::equal(model[i].begin(), model[i].end(), vector->getData());
+            delete vector;
+            if (!isEqual)
+                return false;
+        }
+
+        return i == model.size();
+    }
+
+    bool contains(ISet const* set, std::vector<double> const& row)
+    {
+        IVector* pattern = IVector::createVector(row.size(), row.data());
+        IVector* found = nullptr;
+        const RC code = set->findFirstAndCopy(pattern, IVector::NORM::SECOND, 1e-9, found);
+        delete pattern;
+        delete found;
+        return code == RC::SUCCESS;
+    }
+
+    // Clones are changed in random order, every one must keep its own contents
+    void checkIsolation(std::mt19937& rng, size_t dim, ISet::INDEX index)
+    {
+        std::uniform_real_distribution<double> coordinate(-100, 100);
+        auto makeRow = [&]() {
+            std::vector<double> row(dim);
+            for (double& x : row)
+                x = coordinate(rng);
+            return row;
+        };
+
+        std::vector<ISet*> sets{ISet::createSet()};
+        std::vector<Rows> models(1);
+        CHECK(sets[0]->setIndex(index) == RC::SUCCESS);
+        for (size_t i = 0; i < 3000; i++)
+        {
+            models[0].push_back(makeRow());
+            IVector* vector = IVector::createVector(dim, models[0].back().data());
+            CHECK(sets[0]->insert(vector, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+            delete vector;
+        }
+
+        for (size_t step = 0; step < 400; step++)
+        {
+            const size_t which = rng() % sets.size();
+            ISet* set = sets[which];
+            const size_t op = rng() % 10;
+            if (op == 0 && sets.size() < 5)
+            {
+                sets.push_back(set->clone());
+                Rows copy = models[which];
+                models.push_back(copy);
+                continue;
+            }
+
+            Rows& model = models[which];
+            if (op < 5 && !model.empty())
+            {
+                const size_t i = rng() % model.size();
+                CHECK(set->remove(i) == RC::SUCCESS);
+                model.erase(model.begin() + i);
+            }
+            else if (op < 8)
+            {
+                model.push_back(makeRow());
+                IVector* vector = IVector::createVector(dim, model.back().data());
+                CHECK(set->insert(vector, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+                delete vector;
+            }
+            else if (op == 8)
+            {
+                CHECK(set->compact() == RC::SUCCESS);
+            }
+            else if (!model.empty())
+            {
+                const size_t i = rng() % model.size();
+                IVector* pattern = IVector::createVector(dim, model[i].data());
+                CHECK(set->remove(pattern, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+                delete pattern;
+                model.erase(model.begin() + i);
+            }
+        }
+
+        for (size_t i = 0; i < sets.size(); i++)
+        {
+            CHECK(matches(sets[i], models[i]));
+            for (size_t row = 0; row < models[i].size(); row += 97)
+                CHECK(contains(sets[i], models[i][row]));
+        }
+
+        // Clones outlive the set they were made of
+        delete sets[0];
+        for (size_t i = 1; i < sets.size(); i++)
+        {
+            CHECK(matches(sets[i], models[i]));
+            delete sets[i];
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(25);
+    for (ISet::INDEX index : {ISet::INDEX::GRID, ISet::INDEX::NONE})
+    {
+        checkIsolation(rng, 3, index);
+        checkIsolation(rng, 300, index);
+    }
+
+    // A view of a clone stays valid while the source is changed
+    ISet* set = ISet::createSet();
+    const double rows[] = {1, 2, 3, 4};
+    size_t accepted = 0;
+    CHECK(set->insertBatch(2, rows, 2, IVector::NORM::SECOND, 0.5, accepted) == RC::SUCCESS);
+    ISet* clone = set->clone();
+    IVectorView* view = nullptr;
+    CHECK(clone->getView(1, view) == RC::SUCCESS);
+    CHECK(set->remove((size_t)0) == RC::SUCCESS);
+    CHECK(view->isValid());
+    CHECK(view->getData()[0] == 3 && view->getData()[1] == 4);
+    CHECK(clone->getSize() == 2 && set->getSize() == 1);
+    delete view;
+    delete clone;
+    delete set;
+
+    return failures;
+}
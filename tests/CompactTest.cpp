@@ -0,0 +1,161 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/IVector.h"
+#include "../include/VectorExpression.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+    const IVector::PRECISION precisions[] = {IVector::PRECISION::FLOAT, IVector::PRECISION::BFLOAT16};
+
+    uint32_t bitsOf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float fromBits(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Stored value is the nearest value of storage precision
+    bool isRounded(double stored, double value, IVector::PRECISION precision)
+    {
+        const float single = (float)value;
+        if (precision == IVector::PRECISION::FLOAT)
+            return stored == single;
+
+        const float below = fromBits(bitsOf(single) & 0xFFFF0000u);
+        const float above = fromBits((bitsOf(single) & 0xFFFF0000u) + 0x10000u);
+        if (stored != below && stored != above)
+            return false;
+
+        const double error = std::fabs(stored - single);
+        const double otherError = std::fabs((stored == below ? above : below) - single);
+        return error < otherError || (error == otherError && (bitsOf((float)stored) & 0x10000u) == 0);
+    }
+
+    std::vector<double> decoded(IVector const* vector)
+    {
+        double const* data = vector->getData();
+        return std::vector<double>(data, data + vector->getDim());
+    }
+
+    void checkCompact(std::mt19937& rng, size_t dim, IVector::PRECISION precision)
+    {
+        std::uniform_real_distribution<double> coordinate(-100, 100);
+        std::vector<double> data(dim), other(dim);
+        for (size_t i = 0; i < dim; i++)
+        {
+            data[i] = coordinate(rng);
+            other[i] = coordinate(rng);
+        }
+
+        IVector* compact = IVector::createVector(dim, data.data(), precision);
+        IVector* compactOther = IVector::createVector(dim, other.data(), precision);
+        IVector* plainOther = IVector::createVector(dim, other.data());
+        CHECK(compact && compact->getPrecision() == precision && compact->getDim() == dim);
+        CHECK(dim < 100 || compact->sizeAllocated() < plainOther->sizeAllocated());
+
+        const std::vector<double> values = decoded(compact);
+        const std::vector<double> otherValues = decoded(compactOther);
+        for (size_t i = 0; i < dim; i++)
+        {
+            CHECK(isRounded(values[i], data[i], precision));
+            double value = 0;
+            CHECK(compact->getCord(i, value) == RC::SUCCESS && value == values[i]);
+        }
+
+        // Reductions are those of the decoded doubles
+        for (IVector::NORM n : norms)
+        {
+            const double norm = Reference::norm(values.data(), dim, n);
+            CHECK(Reference::isClose(compact->norm(n), norm, norm, dim));
+
+            const double distance = Reference::distance(values.data(), otherValues.data(), dim, n);
+            CHECK(Reference::isClose(IVector::distance(compact, compactOther, n), distance, distance, dim));
+            const double mixed = Reference::distance(values.data(), other.data(), dim, n);
+            CHECK(Reference::isClose(IVector::distance(compact, plainOther, n), mixed, mixed, dim));
+            CHECK(Reference::isClose(IVector::distance(plainOther, compact, n), mixed, mixed, dim));
+            CHECK(IVector::equals(compact, plainOther, n, mixed * 1.5) && !IVector::equals(compact, plainOther, n, mixed * 0.5));
+
+            const double bound = distance / 2;
+            CHECK(IVector::distance(compact, compactOther, n, bound) >= bound);
+        }
+
+        const double dotScale = Reference::norm(values.data(), dim, IVector::NORM::SECOND) * Reference::norm(other.data(), dim, IVector::NORM::SECOND);
+        CHECK(Reference::isClose(IVector::dot(compact, plainOther), Reference::dot(values.data(), other.data(), dim), dotScale, dim));
+        CHECK(Reference::isClose(IVector::dot(compact, compactOther), Reference::dot(values.data(), otherValues.data(), dim), dotScale, dim));
+
+        // Compact terms of a linear combination are read as decoded
+        IVector* dest = IVector::createVector(dim, data.data());
+        CHECK(IVector::linearCombination(dest, {{2, compact}, {-1, plainOther}, {0.5, compactOther}}) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+        {
+            const double expected = 2 * values[i] - other[i] + 0.5 * otherValues[i];
+            CHECK(Reference::isClose(dest->getData()[i], expected, std::fabs(expected) + 100, 3));
+        }
+
+        // Writes round, results that don't fit change nothing
+        CHECK(compact->inc(plainOther) == RC::SUCCESS);
+        for (size_t i = 0; i < dim; i++)
+            CHECK(isRounded(compact->getData()[i], values[i] + other[i], precision));
+        const std::vector<double> current = decoded(compact);
+        CHECK(compact->scale(1e300) != RC::SUCCESS);
+        CHECK(compact->setCord(0, 1e300) != RC::SUCCESS);
+        CHECK(decoded(compact) == current);
+        CHECK(compact->setCord(dim - 1, 1.0 / 3) == RC::SUCCESS && isRounded(compact->getData()[dim - 1], 1.0 / 3, precision));
+
+        // Compact vector is not a destination of assign()
+        using namespace VectorExpression;
+        CHECK(IVector::axpy(1, plainOther, compact) == RC::INVALID_ARGUMENT);
+        CHECK(IVector::assign(compact, vec(plainOther)) == RC::INVALID_ARGUMENT);
+
+        IVector* clone = compact->clone();
+        CHECK(clone && clone->getPrecision() == precision && decoded(clone) == decoded(compact));
+
+        delete clone;
+        delete dest;
+        delete compact;
+        delete compactOther;
+        delete plainOther;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(9);
+    for (IVector::PRECISION precision : precisions)
+        for (size_t dim : {1, 2, 7, 255, 256, 257, 1000})
+            checkCompact(rng, dim, precision);
+
+    // Out of storage range
+    const double huge[2] = {1, 1e39};
+    CHECK(IVector::createVector(2, huge, IVector::PRECISION::FLOAT) == nullptr);
+    CHECK(IVector::createVector(2, huge, IVector::PRECISION::BFLOAT16) == nullptr);
+
+    // Eight getData() results stay valid at once
+    const double coords[3] = {1, 2, 3};
+    std::vector<IVector*> vectors;
+    std::vector<double const*> data;
+    for (int i = 0; i < 8; i++)
+    {
+        vectors.push_back(IVector::createVector(3, coords, IVector::PRECISION::FLOAT));
+        CHECK(vectors.back()->scale(i + 1) == RC::SUCCESS);
+        data.push_back(vectors.back()->getData());
+    }
+    for (int i = 0; i < 8; i++)
+        CHECK(data[i][2] == 3.0 * (i + 1));
+    for (IVector* vector : vectors)
+        delete vector;
+
+    return failures;
+}
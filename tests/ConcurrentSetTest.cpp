@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+    const size_t dim = 3;
+    const size_t baseCount = 200;
+    const size_t writerInserts = 300;
+
+    // CHECK counts from many threads, so readers and writers count their own failures
+    void read(ISet const* set, std::atomic<bool> const& done, std::atomic<int>& errors)
+    {
+        const double zero[dim] = {0, 0, 0};
+        IVector* found = IVector::createVector(dim, zero);
+        while (!done.load())
+        {
+            // Base vectors are never removed, every version must find them
+            for (size_t i = 0; i < baseCount; i += 7)
+            {
+                const double coords[dim] = {double(i), 0, 0};
+                IVector* pattern = IVector::createVector(dim, coords);
+                if (set->findFirstAndCopyCoords(pattern, IVector::NORM::SECOND, 0.5, found) != RC::SUCCESS || found->getData()[0] != i)
+                    errors++;
+                delete pattern;
+            }
+
+            // Iterator keeps its version, base vectors come first in it
+            ISet::IIterator* it = set->getBegin();
+            size_t count = 0;
+            while (it && it->isValid())
+            {
+                if (it->getVectorCoords(found) != RC::SUCCESS || (count < baseCount && found->getData()[0] != count))
+                    errors++;
+
+                count++;
+                if (it->next() != RC::SUCCESS)
+                    break;
+            }
+
+            if (!it || count < baseCount)
+                errors++;
+            delete it;
+
+            ISet* clone = set->clone();
+            if (!clone || clone->getSize() < baseCount)
+                errors++;
+            delete clone;
+        }
+
+        delete found;
+    }
+
+    // Writers use disjoint coordinates, every third vector is removed again
+    void write(ISet* set, double first, std::atomic<int>& errors)
+    {
+        for (size_t k = 0; k < writerInserts; k++)
+        {
+            const double coords[dim] = {first + k, 1, 1};
+            IVector* vector = IVector::createVector(dim, coords);
+            if (set->insert(vector, IVector::NORM::SECOND, 0.5) != RC::SUCCESS)
+                errors++;
+            if (k % 3 == 0 && set->remove(vector, IVector::NORM::SECOND, 0.5) != RC::SUCCESS)
+                errors++;
+            delete vector;
+        }
+
+        std::vector<double> rows;
+        for (size_t k = 0; k < 100; k++)
+            rows.insert(rows.end(), {first + 0.5 + k, 2, 2});
+
+        size_t accepted = 0;
+        if (set->insertBatch(dim, rows.data(), 100, IVector::NORM::SECOND, 0.5, accepted) != RC::SUCCESS || accepted != 100)
+            errors++;
+        if (set->insertBatch(dim, rows.data(), 100, IVector::NORM::SECOND, 0.5, accepted) != RC::SUCCESS || accepted != 0)
+            errors++;
+    }
+}
+
+int main()
+{
+    ISet* set = ISet::createConcurrentSet();
+    for (size_t i = 0; i < baseCount; i++)
+    {
+        const double coords[dim] = {double(i), 0, 0};
+        IVector* vector = IVector::createVector(dim, coords);
+        CHECK(set->insert(vector, IVector::NORM::SECOND, 0.5) == RC::SUCCESS);
+        delete vector;
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < 3; i++)
+        readers.emplace_back(read, set, std::cref(done), std::ref(errors));
+
+    std::thread writer1(write, set, 1000.0, std::ref(errors));
+    std::thread writer2(write, set, 5000.0, std::ref(errors));
+    writer1.join();
+    writer2.join();
+    done = true;
+    for (std::thread& reader : readers)
+        reader.join();
+
+    CHECK(errors.load() == 0);
+    CHECK(set->getSize() == baseCount + 2 * (writerInserts - writerInserts / 3 + 100));
+
+    // Storage of a version may be freed by the next write, so views and cursors are refused
+    IVectorView* view = nullptr;
+    CHECK(set->getView(0, view) == RC::INVALID_ARGUMENT);
+    CHECK(set->getCursor().isEnd() && !set->getCursor().isValid());
+
+    delete set;
+    return failures;
+}
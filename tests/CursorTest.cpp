@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <random>
+#include <vector>
+
+namespace {
+    // Cursor walk gives exactly the vectors getCopy() gives, in the same order
+    bool matchesCopies(ISet const* set)
+    {
+        const size_t dim = set->getDim();
+        size_t index = 0;
+        bool isSame = true;
+        for (ISet::Cursor cursor = set->getCursor(); !cursor.isEnd(); ++cursor)
+        {
+            IVector* copy = nullptr;
+            if (!cursor.isValid() || cursor.getDim() != dim || set->getCopy(index, copy) != RC::SUCCESS)
+                return false;
+
+            for (size_t i = 0; i < dim; i++)
+                isSame = isSame && cursor.data()[i] == copy->getData()[i];
+            delete copy;
+            index++;
+        }
+        return isSame && index == set->getSize();
+    }
+
+    void checkCursor(std::mt19937& rng, size_t dim, size_t count)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> rows(dim * count);
+        for (double& value : rows)
+            value = coordinate(rng);
+
+        ISet* set = ISet::createSet();
+        size_t accepted = 0;
+        CHECK(set->setCompactionThreshold(1) == RC::SUCCESS);
+        CHECK(set->insertBatch(dim, rows.data(), count, IVector::NORM::SECOND, 0, accepted) == RC::SUCCESS);
+        CHECK(matchesCopies(set));
+
+        // Removed vectors in storage are skipped, including the first and the last ones
+        CHECK(set->remove(0) == RC::SUCCESS);
+        if (set->getSize() > 0)
+            CHECK(set->remove(set->getSize() - 1) == RC::SUCCESS);
+        for (size_t i = 0; i < count / 3 && set->getSize() > 0; i++)
+            CHECK(set->remove(rng() % set->getSize()) == RC::SUCCESS);
+        CHECK(matchesCopies(set));
+
+        // Range-for over the set
+        double total = 0, expected = 0;
+        for (double const* coords : *set)
+            total += coords[dim - 1];
+        for (size_t i = 0; i < set->getSize(); i++)
+        {
+            IVector* copy = nullptr;
+            CHECK(set->getCopy(i, copy) == RC::SUCCESS);
+            expected += copy->getData()[dim - 1];
+            delete copy;
+        }
+        CHECK(total == expected);
+
+        // Clone has its own cursors, changes of one don't touch cursors of the other
+        ISet* clone = set->clone();
+        ISet::Cursor cursor = set->getCursor();
+        ISet::Cursor cloneCursor = clone->getCursor();
+        CHECK(matchesCopies(clone));
+        if (clone->getSize() > 0)
+        {
+            CHECK(clone->remove(0) == RC::SUCCESS);
+            CHECK(cursor.isValid() && !cloneCursor.isValid());
+        }
+        CHECK(matchesCopies(set) && matchesCopies(clone));
+
+        // Every modification invalidates cursors of the set
+        IVector* vector = IVector::createVector(dim, rows.data());
+        CHECK(set->insert(vector, IVector::NORM::SECOND, 0) == RC::SUCCESS);
+        CHECK(!cursor.isValid());
+        cursor = set->getCursor();
+        CHECK(set->remove(0) == RC::SUCCESS);
+        CHECK(!cursor.isValid());
+        cursor = set->getCursor();
+        CHECK(set->compact() == RC::SUCCESS);
+        CHECK(!cursor.isValid());
+        CHECK(matchesCopies(set));
+
+        delete vector;
+        delete clone;
+        delete set;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(16);
+    for (size_t dim : {1, 3, 16})
+        for (size_t count : {1, 2, 10, 1000, 5000})
+            checkCursor(rng, dim, count);
+
+    // Empty cursors
+    ISet::Cursor empty;
+    CHECK(!empty.isValid());
+    ISet* set = ISet::createSet();
+    CHECK(set->begin() == set->end() && set->getCursor().isEnd());
+
+    const double coords[2] = {1, 2};
+    IVector* vector = IVector::createVector(2, coords);
+    ISet* concurrent = ISet::createConcurrentSet();
+    CHECK(concurrent->insert(vector, IVector::NORM::SECOND, 0) == RC::SUCCESS);
+    CHECK(!concurrent->getCursor().isValid());
+    CHECK(concurrent->getCursor().isEnd());
+
+    delete vector;
+    delete concurrent;
+    delete set;
+
+    return failures;
+}
@@ -0,0 +1,94 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/IVector.h"
+#include "../include/VectorKernels.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    // Result below bound is the whole distance, anything else only says the distance reaches bound
+    bool isBoundedResult(double actual, double expected, double bound, size_t dim)
+    {
+        if (actual < bound)
+            return Reference::isClose(actual, expected, expected, dim);
+
+        return expected >= bound * (1 - 1e-12);
+    }
+
+    void checkDistances(std::mt19937& rng, size_t dim)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> op1(dim), op2(dim);
+        for (size_t i = 0; i < dim; i++)
+        {
+            op1[i] = coordinate(rng);
+            op2[i] = op1[i] + 0.01 * coordinate(rng);
+        }
+
+        IVector* vector1 = IVector::createVector(dim, op1.data());
+        IVector* vector2 = IVector::createVector(dim, op2.data());
+        for (IVector::NORM n : norms)
+        {
+            const double expected = Reference::distance(op1.data(), op2.data(), dim, n);
+            CHECK(Reference::isClose(VectorKernels::distance(op1.data(), op2.data(), dim, n), expected, expected, dim));
+            CHECK(Reference::isClose(IVector::distance(vector1, vector2, n), expected, expected, dim));
+
+            // Bounds below, near and above the distance
+            for (double factor : {0.0, 0.1, 0.5, 0.99, 1.01, 2.0})
+            {
+                const double bound = expected * factor;
+                CHECK(isBoundedResult(VectorKernels::distance(op1.data(), op2.data(), dim, n, bound), expected, bound, dim));
+                CHECK(isBoundedResult(IVector::distance(vector1, vector2, n, bound), expected, bound, dim));
+
+                // Tolerances away from the distance, so rounding can't change the answer
+                if (factor != 0.99 && factor != 1.01 && factor != 0)
+                    CHECK(IVector::equals(vector1, vector2, n, bound) == (expected < bound));
+            }
+
+            CHECK(IVector::equals(vector1, vector1, n, 1e-300));
+            CHECK(!IVector::equals(vector1, vector1, n, 0));
+        }
+
+        // Raw kernels
+        const double squares = Reference::distance(op1.data(), op2.data(), dim, IVector::NORM::SECOND);
+        CHECK(Reference::isClose(VectorKernels::sumSquaresDiff(op1.data(), op2.data(), dim), squares * squares, squares * squares, dim));
+        const double sumAbs = Reference::distance(op1.data(), op2.data(), dim, IVector::NORM::FIRST);
+        CHECK(Reference::isClose(VectorKernels::sumAbsDiff(op1.data(), op2.data(), dim), sumAbs, sumAbs, dim));
+        CHECK(VectorKernels::maxAbsDiff(op1.data(), op2.data(), dim) == Reference::distance(op1.data(), op2.data(), dim, IVector::NORM::CHEBYSHEV));
+
+        delete vector1;
+        delete vector2;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(3);
+    const VectorKernels::ISA detected = VectorKernels::getISA();
+    for (VectorKernels::ISA isa : {VectorKernels::ISA::SCALAR, VectorKernels::ISA::SSE2, VectorKernels::ISA::AVX2, VectorKernels::ISA::AVX512})
+    {
+        if (VectorKernels::setISA(isa) != RC::SUCCESS)
+            continue;
+
+        for (size_t dim : {1, 2, 3, 5, 8, 13, 100, 255, 256, 257, 2000})
+            checkDistances(rng, dim);
+    }
+
+    CHECK(VectorKernels::setISA(detected) == RC::SUCCESS);
+
+    // Invalid arguments
+    const double coords[3] = {1, 2, 3};
+    IVector* vector3 = IVector::createVector(3, coords);
+    IVector* vector2 = IVector::createVector(2, coords);
+    CHECK(std::isnan(IVector::distance(vector3, vector2, IVector::NORM::SECOND)));
+    CHECK(!IVector::equals(vector3, vector2, IVector::NORM::SECOND, 1));
+    CHECK(!IVector::equals(vector3, vector3, IVector::NORM::SECOND, -1));
+    delete vector3;
+    delete vector2;
+
+    return failures;
+}
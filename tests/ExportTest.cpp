@@ -0,0 +1,120 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <random>
+#include <vector>
+
+namespace {
+    const double untouched = -12345;
+
+    std::vector<double> copies(ISet const* set)
+    {
+        const size_t dim = set->getDim();
+        std::vector<double> rows(set->getSize() * dim);
+        for (size_t i = 0; i < set->getSize(); i++)
+        {
+            IVector* copy = nullptr;
+            CHECK(set->getCopy(i, copy) == RC::SUCCESS);
+            std::copy(copy->getData(), copy->getData() + dim, rows.begin() + i * dim);
+            delete copy;
+        }
+        return rows;
+    }
+
+    void checkExport(std::mt19937& rng, ISet* set)
+    {
+        const size_t dim = set->getDim(), size = set->getSize();
+        const std::vector<double> rows = copies(set);
+
+        for (int round = 0; round < 30; round++)
+        {
+            const size_t start = rng() % (size + 1);
+            const size_t count = rng() % (size - start + 1);
+            const size_t stride = dim + rng() % 3;
+            const size_t ld = count + rng() % 3;
+
+            // Row-major with gaps between rows
+            std::vector<double> dst(count * stride + 1, untouched);
+            CHECK(set->exportRange(start, count, dst.data(), stride) == RC::SUCCESS);
+            for (size_t i = 0; i < count; i++)
+                for (size_t j = 0; j < stride; j++)
+                    CHECK(dst[i * stride + j] == (j < dim ? rows[(start + i) * dim + j] : untouched));
+            CHECK(dst.back() == untouched);
+
+            // Column-major
+            std::vector<double> columns(dim * ld + 1, untouched);
+            CHECK(set->exportRangeColumnMajor(start, count, columns.data(), ld) == RC::SUCCESS);
+            for (size_t j = 0; j < dim; j++)
+                for (size_t i = 0; i < ld; i++)
+                    CHECK(columns[j * ld + i] == (i < count ? rows[(start + i) * dim + j] : untouched));
+            CHECK(columns.back() == untouched);
+
+            // Arbitrary indices, repeated and out of order
+            std::vector<size_t> indices(count);
+            for (size_t& index : indices)
+                index = size == 0 ? 0 : rng() % size;
+            std::vector<double> gathered(count * stride + 1, untouched);
+            if (count > 0)
+            {
+                CHECK(set->exportIndices(indices.data(), count, gathered.data(), stride) == RC::SUCCESS);
+                for (size_t i = 0; i < count; i++)
+                    for (size_t j = 0; j < dim; j++)
+                        CHECK(gathered[i * stride + j] == rows[indices[i] * dim + j]);
+            }
+        }
+
+        // Arguments are checked before anything is written
+        std::vector<double> dst(dim * (size + 2), untouched);
+        std::vector<double> const clean = dst;
+        CHECK(set->exportRange(0, size + 1, dst.data(), dim) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(set->exportRange(size + 1, 0, dst.data(), dim) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(set->exportRange(0, size, dst.data(), dim - 1) == RC::INVALID_ARGUMENT);
+        CHECK(set->exportRange(0, size, nullptr, dim) == RC::NULLPTR_ERROR);
+        CHECK(set->exportRangeColumnMajor(1, size, dst.data(), size) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(set->exportRangeColumnMajor(0, size, dst.data(), size - 1) == RC::INVALID_ARGUMENT);
+
+        const size_t indices[3] = {0, size, 1};
+        CHECK(set->exportIndices(indices, 3, dst.data(), dim) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(set->exportIndices(indices, 1, dst.data(), dim - 1) == RC::INVALID_ARGUMENT);
+        CHECK(set->exportIndices(nullptr, 1, dst.data(), dim) == RC::NULLPTR_ERROR);
+        CHECK(dst == clean);
+    }
+
+    void fill(std::mt19937& rng, ISet* set, size_t dim, size_t count)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> rows(dim * count);
+        for (double& value : rows)
+            value = coordinate(rng);
+
+        size_t accepted = 0;
+        CHECK(set->insertBatch(dim, rows.data(), count, IVector::NORM::SECOND, 0, accepted) == RC::SUCCESS);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(17);
+    for (size_t dim : {2, 5, 16})
+        for (size_t count : {3, 100, 3000})
+        {
+            // Removed vectors left in storage split the runs of rows
+            ISet* set = ISet::createSet();
+            CHECK(set->setCompactionThreshold(1) == RC::SUCCESS);
+            fill(rng, set, dim, count);
+            checkExport(rng, set);
+            for (size_t i = 0; i < count / 4 + 1; i++)
+                CHECK(set->remove(rng() % set->getSize()) == RC::SUCCESS);
+            checkExport(rng, set);
+            CHECK(set->compact() == RC::SUCCESS);
+            checkExport(rng, set);
+            delete set;
+
+            ISet* concurrent = ISet::createConcurrentSet();
+            fill(rng, concurrent, dim, count);
+            CHECK(concurrent->remove(0) == RC::SUCCESS);
+            checkExport(rng, concurrent);
+            delete concurrent;
+        }
+
+    return failures;
+}
@@ -0,0 +1,154 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/FixedVector.h"
+#include "../include/IVectorArena.h"
+#include "../include/IVectorView.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    // Plain loops in the order FixedKernels promise to keep
+    double loopNorm(double const* data, size_t dim, IVector::NORM n)
+    {
+        double result = 0;
+        for (size_t i = 0; i < dim; i++)
+        {
+            if (n == IVector::NORM::CHEBYSHEV)
+                result = std::fabs(data[i]) > result ? std::fabs(data[i]) : result;
+            else if (n == IVector::NORM::FIRST)
+                result += std::fabs(data[i]);
+            else
+                result += data[i] * data[i];
+        }
+        return n == IVector::NORM::SECOND ? std::sqrt(result) : result;
+    }
+
+    bool hasExactData(IVector const* vector, std::vector<double> const& expected)
+    {
+        for (size_t i = 0; i < expected.size(); i++)
+            if (vector->getData()[i] != expected[i])
+                return false;
+        return true;
+    }
+
+    template <size_t N>
+    void checkFixed(std::mt19937& rng, IVectorArena* arena)
+    {
+        std::uniform_real_distribution<double> coordinate(-10, 10);
+        std::vector<double> data(N), other(N);
+        for (size_t i = 0; i < N; i++)
+        {
+            data[i] = coordinate(rng);
+            other[i] = coordinate(rng);
+        }
+
+        IVector* vector = IVector::createVector(N, data.data(), arena);
+        IVector* operand = IVector::createVector(N, other.data());
+        CHECK(dynamic_cast<FixedVector<N>*>(vector) != nullptr);
+        CHECK(dynamic_cast<FixedVector<N>*>(operand) != nullptr);
+        CHECK(vector->getDim() == N && hasExactData(vector, data));
+
+        // Generic path over the same coordinates
+        IVectorView* generic = IVectorView::createMutableView(N, data.data());
+        IVectorView* genericOperand = IVectorView::createView(N, other.data());
+
+        for (IVector::NORM n : norms)
+        {
+            CHECK(vector->norm(n) == loopNorm(data.data(), N, n));
+            CHECK(Reference::isClose(vector->norm(n), generic->norm(n), generic->norm(n), N));
+            const double distance = Reference::distance(data.data(), other.data(), N, n);
+            CHECK(Reference::isClose(IVector::distance(vector, operand, n), distance, distance, N));
+            CHECK(Reference::isClose(IVector::distance(vector, genericOperand, n), distance, distance, N));
+        }
+
+        double dot = 0;
+        for (size_t i = 0; i < N; i++)
+            dot += data[i] * other[i];
+        CHECK(FixedVector<N>::dot(*static_cast<FixedVector<N>*>(vector), *static_cast<FixedVector<N>*>(operand)) == dot);
+        CHECK(Reference::isClose(IVector::dot(vector, operand), dot, Reference::norm(data.data(), N, IVector::NORM::SECOND) * Reference::norm(other.data(), N, IVector::NORM::SECOND), N));
+        CHECK(Reference::isClose(IVector::dot(vector, genericOperand), IVector::dot(generic, genericOperand), std::fabs(dot) + 100, N));
+
+        // Same modifications on fixed vector and on the view give the same coordinates
+        CHECK(vector->inc(operand) == RC::SUCCESS && generic->inc(genericOperand) == RC::SUCCESS);
+        CHECK(hasExactData(vector, data));
+        CHECK(vector->dec(genericOperand) == RC::SUCCESS && generic->dec(operand) == RC::SUCCESS);
+        CHECK(hasExactData(vector, data));
+        CHECK(vector->scale(-2.5) == RC::SUCCESS && generic->scale(-2.5) == RC::SUCCESS);
+        CHECK(hasExactData(vector, data));
+        CHECK(IVector::axpy(3, operand, vector) == RC::SUCCESS && IVector::axpy(3, genericOperand, generic) == RC::SUCCESS);
+        CHECK(hasExactData(vector, data));
+        CHECK(vector->applyFunction([](double value) { return value / 3; }) == RC::SUCCESS);
+        CHECK(generic->applyFunction([](double value) { return value / 3; }) == RC::SUCCESS);
+        CHECK(hasExactData(vector, data));
+
+        IVector* sum = IVector::add(vector, operand);
+        IVector* difference = IVector::sub(vector, genericOperand);
+        CHECK(dynamic_cast<FixedVector<N>*>(sum) != nullptr);
+        CHECK(dynamic_cast<FixedVector<N>*>(difference) != nullptr);
+        for (size_t i = 0; i < N; i++)
+        {
+            CHECK(sum->getData()[i] == data[i] + other[i]);
+            CHECK(difference->getData()[i] == data[i] - other[i]);
+        }
+
+        // Coordinates, errors and unchanged state on failure
+        double value = 0;
+        CHECK(vector->setCord(N - 1, 7) == RC::SUCCESS && vector->getCord(N - 1, value) == RC::SUCCESS && value == 7);
+        data[N - 1] = 7;
+        CHECK(vector->getCord(N, value) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(vector->setCord(0, std::nan("")) != RC::SUCCESS);
+        CHECK(vector->scale(std::numeric_limits<double>::max()) == RC::INFINITY_OVERFLOW);
+        CHECK(hasExactData(vector, data));
+
+        IVector* clone = vector->clone();
+        CHECK(dynamic_cast<FixedVector<N>*>(clone) != nullptr && hasExactData(clone, data));
+
+        IVector* longer = IVector::createVector(N + 1, std::vector<double>(N + 1, 1).data());
+        CHECK(vector->inc(longer) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(IVector::add(vector, longer) == nullptr);
+        CHECK(hasExactData(vector, data));
+
+        delete longer;
+        delete clone;
+        delete sum;
+        delete difference;
+        delete generic;
+        delete genericOperand;
+        if (!arena)
+            delete vector;
+        delete operand;
+    }
+
+    template <size_t... N>
+    void checkAll(std::mt19937& rng, IVectorArena* arena)
+    {
+        (checkFixed<N>(rng, arena), ...);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(6);
+    IVectorArena* arena = IVectorArena::createArena();
+    for (int round = 0; round < 20; round++)
+    {
+        checkAll<2, 3, 4, 8>(rng, nullptr);
+        checkAll<2, 3, 4, 8>(rng, arena);
+    }
+    delete arena;
+
+    // Other dimensions stay generic
+    const double coords[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    for (size_t dim : {1, 5, 7, 9})
+    {
+        IVector* vector = IVector::createVector(dim, coords);
+        CHECK(dynamic_cast<FixedVectorBase*>(vector) == nullptr);
+        delete vector;
+    }
+
+    return failures;
+}
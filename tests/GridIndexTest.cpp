@@ -0,0 +1,147 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    std::vector<double> rowsOf(ISet const* set)
+    {
+        std::vector<double> rows(set->getSize() * set->getDim());
+        CHECK(set->exportRange(0, set->getSize(), rows.data(), set->getDim()) == RC::SUCCESS);
+        return rows;
+    }
+
+    // First vector of the set within tol by comparing with every vector, nullptr if there is none
+    IVector* bruteForceFind(ISet const* set, IVector const* pat, IVector::NORM n, double tol)
+    {
+        for (size_t i = 0; i < set->getSize(); i++)
+        {
+            IVector* copy = nullptr;
+            CHECK(set->getCopy(i, copy) == RC::SUCCESS);
+            if (IVector::distance(copy, pat, n) < tol)
+                return copy;
+            delete copy;
+        }
+        return nullptr;
+    }
+
+    // Vector near one of a few centres, so many vectors are within tolerance of each other
+    IVector* clusteredVector(std::mt19937& rng, std::vector<double> const& centres, size_t dim, double spread)
+    {
+        std::uniform_int_distribution<size_t> centre(0, centres.size() / dim - 1);
+        std::normal_distribution<double> offset(0, spread);
+        const size_t first = centre(rng) * dim;
+        std::vector<double> coords(dim);
+        for (size_t i = 0; i < dim; i++)
+            coords[i] = centres[first + i] + offset(rng);
+        return IVector::createVector(dim, coords.data());
+    }
+
+    void checkFind(ISet const* grid, ISet const* none, IVector const* pat, IVector::NORM n, double tol)
+    {
+        IVector* expected = bruteForceFind(none, pat, n, tol);
+        IVector* fromGrid = IVector::createVector(pat->getDim(), pat->getData());
+        IVector* fromNone = IVector::createVector(pat->getDim(), pat->getData());
+        const RC gridRC = grid->findFirstAndCopyCoords(pat, n, tol, fromGrid);
+        const RC noneRC = none->findFirstAndCopyCoords(pat, n, tol, fromNone);
+
+        CHECK(gridRC == noneRC);
+        CHECK((gridRC == RC::SUCCESS) == (expected != nullptr));
+        if (expected && gridRC == RC::SUCCESS)
+        {
+            CHECK(IVector::distance(fromGrid, expected, IVector::NORM::CHEBYSHEV) == 0);
+            CHECK(IVector::distance(fromNone, expected, IVector::NORM::CHEBYSHEV) == 0);
+        }
+
+        delete expected;
+        delete fromGrid;
+        delete fromNone;
+    }
+
+    void checkIndex(std::mt19937& rng, size_t dim, IVector::NORM n)
+    {
+        const double tol = 0.5, spread = tol / dim;
+        std::uniform_real_distribution<double> coordinate(-5, 5);
+        std::vector<double> centres(20 * dim);
+        for (double& value : centres)
+            value = coordinate(rng);
+
+        ISet* grid = ISet::createSet();
+        ISet* none = ISet::createSet();
+        CHECK(grid->setIndex(ISet::INDEX::GRID) == RC::SUCCESS);
+        CHECK(none->setIndex(ISet::INDEX::NONE) == RC::SUCCESS);
+
+        // Same inserts accept the same vectors
+        for (int i = 0; i < 400; i++)
+        {
+            IVector* vector = clusteredVector(rng, centres, dim, spread);
+            CHECK(grid->insert(vector, n, tol) == none->insert(vector, n, tol));
+            delete vector;
+        }
+        CHECK(grid->getSize() < 400);
+        CHECK(rowsOf(grid) == rowsOf(none));
+
+        // Lookups with the index tolerance, smaller and larger ones, and other norms
+        for (int i = 0; i < 40; i++)
+        {
+            IVector* pat = clusteredVector(rng, centres, dim, spread);
+            for (double queryTol : {tol, tol / 3, tol * 2.5})
+                for (IVector::NORM queryNorm : norms)
+                    checkFind(grid, none, pat, queryNorm, queryTol);
+            delete pat;
+        }
+
+        // Removal by pattern, then inserts reusing the index
+        for (int i = 0; i < 50; i++)
+        {
+            IVector* pat = clusteredVector(rng, centres, dim, spread);
+            CHECK(grid->remove(pat, n, tol) == none->remove(pat, n, tol));
+            delete pat;
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            IVector* vector = clusteredVector(rng, centres, dim, spread);
+            CHECK(grid->insert(vector, n, tol) == none->insert(vector, n, tol));
+            delete vector;
+        }
+        CHECK(rowsOf(grid) == rowsOf(none));
+
+        // Index visits fewer rows than the scan
+        grid->resetScanStats();
+        none->resetScanStats();
+        for (int i = 0; i < 20; i++)
+        {
+            IVector* pat = clusteredVector(rng, centres, dim, spread);
+            checkFind(grid, none, pat, n, tol);
+            delete pat;
+        }
+        CHECK(grid->getScanStats().lookups == none->getScanStats().lookups);
+        CHECK(grid->getScanStats().rowsVisited <= none->getScanStats().rowsVisited);
+
+        // Switching the index keeps the answers
+        CHECK(grid->setIndex(ISet::INDEX::NONE) == RC::SUCCESS && none->setIndex(ISet::INDEX::GRID) == RC::SUCCESS);
+        for (int i = 0; i < 30; i++)
+        {
+            IVector* vector = clusteredVector(rng, centres, dim, spread);
+            CHECK(grid->insert(vector, n, tol) == none->insert(vector, n, tol));
+            checkFind(grid, none, vector, n, tol);
+            delete vector;
+        }
+        CHECK(rowsOf(grid) == rowsOf(none));
+
+        delete grid;
+        delete none;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(11);
+    for (size_t dim : {1, 2, 3, 8, 20})
+        for (IVector::NORM n : norms)
+            checkIndex(rng, dim, n);
+
+    return failures;
+}
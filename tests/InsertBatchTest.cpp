@@ -0,0 +1,121 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    typedef std::vector<std::vector<double>> Rows;
+
+    double distance(std::vector<double> const& a, double const* b, IVector::NORM n)
+    {
+        double result = 0;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            const double diff = std::fabs(a[i] - b[i]);
+            if (n == IVector::NORM::CHEBYSHEV)
+                result = std::max(result, diff);
+            else
+                result += n == IVector::NORM::FIRST ? diff : diff * diff;
+        }
+
+        return n == IVector::NORM::SECOND ? std::sqrt(result) : result;
+    }
+
+    // Brute force: a row is accepted if every row accepted before it is at least tol away
+    size_t insertModel(Rows& model, double const* row, size_t dim, IVector::NORM n, double tol)
+    {
+        for (auto const& kept : model)
+        {
+            if (distance(kept, row, n) < tol)
+                return 0;
+        }
+
+        model.emplace_back(row, row + dim);
+        return 1;
+    }
+
+    bool matches(ISet const* set, Rows const& model)
+    {
+        if (set->getSize() != model.size())
+            return false;
+
+        const size_t dim = set->getDim();
+        std::vector<double> rows(model.size() * dim);
+        if (!rows.empty() && set->exportRange(0, model.size(), rows.data(), dim) != RC::SUCCESS)
+            return false;
+
+        for (size_t i = 0; i < model.size(); i++)
+        {
+            if (!std::equal(model[i].begin(), model[i].end(), rows.begin() + i * dim))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Coordinates on a coarse grid, so that many rows are within tol of each other
+    void checkAgainstBruteForce(std::mt19937& rng, size_t dim, IVector::NORM n, double tol, ISet::INDEX index)
+    {
+        std::uniform_int_distribution<int> grid(-3, 3);
+        const size_t count = 300;
+        std::vector<double> rows(count * dim);
+        for (double& x : rows)
+            x = grid(rng) * 0.25;
+
+        ISet* set = ISet::createSet();
+        CHECK(set->setIndex(index) == RC::SUCCESS);
+        Rows model;
+
+        // Some rows go in one by one first, the batch must be checked against them too
+        const size_t before = 10;
+        for (size_t i = 0; i < before; i++)
+        {
+            IVector* vector = IVector::createVector(dim, rows.data() + i * dim);
+            CHECK(set->insert(vector, n, tol) == RC::SUCCESS);
+            insertModel(model, rows.data() + i * dim, dim, n, tol);
+            delete vector;
+        }
+
+        size_t expected = 0;
+        for (size_t i = 0; i < count; i++)
+            expected += insertModel(model, rows.data() + i * dim, dim, n, tol);
+
+        size_t accepted = 0;
+        CHECK(set->insertBatch(dim, rows.data(), count, n, tol, accepted) == RC::SUCCESS);
+        CHECK(accepted == expected);
+        CHECK(matches(set, model));
+        delete set;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(13);
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+    const ISet::INDEX indexes[] = {ISet::INDEX::GRID, ISet::INDEX::NONE};
+    for (size_t dim : {1, 3, 40})
+    {
+        for (IVector::NORM n : norms)
+        {
+            for (ISet::INDEX index : indexes)
+            {
+                checkAgainstBruteForce(rng, dim, n, 0, index);
+                checkAgainstBruteForce(rng, dim, n, 0.3, index);
+                checkAgainstBruteForce(rng, dim, n, 0.6, index);
+            }
+        }
+    }
+
+    // A row with NaN rejects the whole batch
+    ISet* set = ISet::createSet();
+    const double rows[] = {1, 2, std::numeric_limits<double>::quiet_NaN(), 3};
+    size_t accepted = 0;
+    CHECK(set->insertBatch(2, rows, 2, IVector::NORM::SECOND, 0.5, accepted) != RC::SUCCESS);
+    CHECK(set->getSize() == 0);
+    delete set;
+
+    return failures;
+}
@@ -0,0 +1,158 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    const size_t dim = 3;
+
+    // Vector number id of the test, ids grow with insertion like unique indexes of the set
+    IVector* vectorOf(size_t id)
+    {
+        const double coords[dim] = {(double)id, -(double)id, 0.5 * id};
+        return IVector::createVector(dim, coords);
+    }
+
+    bool isVectorOf(ISet::IIterator const* it, size_t id)
+    {
+        IVector* expected = vectorOf(id);
+        IVector* actual = vectorOf(id + 1);
+        const bool isSame = it->getVectorCoords(actual) == RC::SUCCESS && IVector::distance(actual, expected, IVector::NORM::CHEBYSHEV) == 0;
+        delete expected;
+        delete actual;
+        return isSame;
+    }
+
+    struct TrackedIterator
+    {
+        ISet::IIterator* it;
+        size_t id;
+    };
+
+    // Steps the iterator and the model the same way, live holds ids of vectors in the set in order
+    void step(TrackedIterator& tracked, std::vector<size_t> const& live, bool isForward, size_t indexInc)
+    {
+        // Live vectors up to the current one, which itself may be removed already
+        const size_t after = std::upper_bound(live.begin(), live.end(), tracked.id) - live.begin();
+        const size_t before = std::lower_bound(live.begin(), live.end(), tracked.id) - live.begin();
+
+        // Zero steps leave the iterator where it is
+        if (indexInc == 0)
+        {
+            CHECK((isForward ? tracked.it->next(0) : tracked.it->previous(0)) == RC::SUCCESS);
+            CHECK(isVectorOf(tracked.it, tracked.id));
+            return;
+        }
+
+        bool isInRange;
+        size_t target = 0;
+        if (isForward)
+        {
+            isInRange = after + indexInc - 1 < live.size();
+            target = after + indexInc - 1;
+        }
+        else
+        {
+            isInRange = before >= indexInc;
+            target = before - indexInc;
+        }
+
+        const RC rc = isForward ? tracked.it->next(indexInc) : tracked.it->previous(indexInc);
+        if (isInRange)
+        {
+            CHECK(rc == RC::SUCCESS);
+            tracked.id = live[target];
+        }
+        else
+            CHECK(rc == RC::INVALID_ARGUMENT);
+
+        CHECK(isVectorOf(tracked.it, tracked.id));
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(15);
+    ISet* set = ISet::createSet();
+    std::vector<size_t> live;
+    size_t nextId = 0;
+    for (; nextId < 300; nextId++)
+    {
+        IVector* vector = vectorOf(nextId);
+        CHECK(set->insert(vector, IVector::NORM::SECOND, 0) == RC::SUCCESS);
+        live.push_back(nextId);
+        delete vector;
+    }
+
+    std::vector<TrackedIterator> iterators;
+    for (int i = 0; i < 20; i++)
+    {
+        const size_t position = rng() % live.size();
+        ISet::IIterator* it = set->getIterator(position);
+        CHECK(it && isVectorOf(it, live[position]) && it->isValid());
+        iterators.push_back({it, live[position]});
+    }
+
+    for (int round = 0; round < 400; round++)
+    {
+        const unsigned op = rng() % 8;
+        if (op < 3 && live.size() > 1)
+        {
+            const size_t position = rng() % live.size();
+            CHECK(set->remove(position) == RC::SUCCESS);
+            live.erase(live.begin() + position);
+        }
+        else if (op < 4)
+        {
+            IVector* vector = vectorOf(nextId);
+            CHECK(set->insert(vector, IVector::NORM::SECOND, 0) == RC::SUCCESS);
+            live.push_back(nextId++);
+            delete vector;
+        }
+        else if (op < 5)
+            CHECK(set->compact() == RC::SUCCESS);
+
+        CHECK(set->getSize() == live.size());
+        for (TrackedIterator& tracked : iterators)
+        {
+            // Iterators keep their vector across compaction and are valid while it is in the set
+            CHECK(tracked.it->isValid() == std::binary_search(live.begin(), live.end(), tracked.id));
+            CHECK(isVectorOf(tracked.it, tracked.id));
+
+            const std::size_t steps[] = {0, 1, 1, 2, 5, 40, 1000};
+            step(tracked, live, rng() % 2 == 0, steps[rng() % 7]);
+        }
+    }
+
+    // Getters leave the iterator in place
+    TrackedIterator& tracked = iterators.front();
+    CHECK(tracked.it->makeBegin() == RC::SUCCESS && isVectorOf(tracked.it, live.front()));
+    tracked.id = live.front();
+    ISet::IIterator* next = tracked.it->getNext(3);
+    CHECK(next && isVectorOf(next, live[3]) && isVectorOf(tracked.it, live.front()));
+    CHECK(tracked.it->previous() == RC::INVALID_ARGUMENT);
+    CHECK(tracked.it->makeEnd() == RC::SUCCESS && isVectorOf(tracked.it, live.back()));
+    CHECK(tracked.it->next() == RC::INVALID_ARGUMENT);
+    ISet::IIterator* previous = tracked.it->getPrevious(live.size() - 1);
+    CHECK(previous && isVectorOf(previous, live.front()));
+    delete next;
+    delete previous;
+
+    // Walking the whole set visits every vector in order
+    ISet::IIterator* it = set->getBegin();
+    size_t visited = 0;
+    do
+    {
+        CHECK(isVectorOf(it, live[visited]));
+        visited++;
+    } while (it->next() == RC::SUCCESS);
+    CHECK(visited == live.size());
+    delete it;
+
+    for (TrackedIterator& iterator : iterators)
+        delete iterator.it;
+    delete set;
+
+    return failures;
+}
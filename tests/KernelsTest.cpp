@@ -0,0 +1,117 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/IVector.h"
+#include "../include/VectorKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Dimensions around every lane and unroll width, and one long enough for several blocks
+    const size_t dims[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000};
+
+    void checkKernels(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> coordinate(-10, 10);
+        for (size_t dim : dims)
+        {
+            std::vector<double> op1(dim + 1), op2(dim + 1), products(dim + 1);
+            for (size_t i = 0; i < dim; i++)
+            {
+                op1[i] = coordinate(rng);
+                op2[i] = coordinate(rng);
+                products[i] = op1[i] * op2[i];
+            }
+
+            CHECK(VectorKernels::maxAbs(op1.data(), dim) == Reference::norm(op1.data(), dim, IVector::NORM::CHEBYSHEV));
+            const double sumAbs = Reference::norm(op1.data(), dim, IVector::NORM::FIRST);
+            CHECK(Reference::isClose(VectorKernels::sumAbs(op1.data(), dim), sumAbs, sumAbs, dim));
+            const double sumSquares = Reference::dot(op1.data(), op1.data(), dim);
+            CHECK(Reference::isClose(VectorKernels::sumSquares(op1.data(), dim), sumSquares, sumSquares, dim));
+            const double scale = Reference::norm(products.data(), dim, IVector::NORM::FIRST);
+            CHECK(Reference::isClose(VectorKernels::dot(op1.data(), op2.data(), dim), Reference::dot(op1.data(), op2.data(), dim), scale, dim));
+
+            CHECK(VectorKernels::isFinite(op1.data(), dim));
+            if (dim != 0)
+            {
+                op1[dim / 2] = std::numeric_limits<double>::infinity();
+                CHECK(!VectorKernels::isFinite(op1.data(), dim));
+                op1[dim / 2] = std::numeric_limits<double>::quiet_NaN();
+                CHECK(!VectorKernels::isFinite(op1.data(), dim));
+                op1[dim / 2] = 0;
+            }
+
+            // Through the public API
+            if (dim != 0)
+            {
+                IVector* vector1 = IVector::createVector(dim, op1.data());
+                IVector* vector2 = IVector::createVector(dim, op2.data());
+                for (IVector::NORM n : {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND})
+                {
+                    const double expected = Reference::norm(op1.data(), dim, n);
+                    CHECK(Reference::isClose(vector1->norm(n), expected, expected, dim));
+                }
+
+                CHECK(Reference::isClose(IVector::dot(vector1, vector2), Reference::dot(op1.data(), op2.data(), dim), scale, dim));
+                delete vector1;
+                delete vector2;
+            }
+        }
+    }
+
+    // Switching implementation while another thread runs kernels gives that thread one of the results
+    void checkSwitching(std::vector<VectorKernels::ISA> const& supported)
+    {
+        std::vector<double> data(1000);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = 1.0 / (i + 1);
+
+        const double expected = Reference::dot(data.data(), data.data(), data.size());
+        std::atomic<bool> done{false};
+        std::atomic<size_t> wrong{0};
+        std::thread reader([&]() {
+            while (!done.load())
+            {
+                if (!Reference::isClose(VectorKernels::sumSquares(data.data(), data.size()), expected, expected, data.size()))
+                    wrong++;
+            }
+        });
+
+        for (size_t i = 0; i < 2000; i++)
+            VectorKernels::setISA(supported[i % supported.size()]);
+
+        done = true;
+        reader.join();
+        CHECK(wrong.load() == 0);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(2);
+    const VectorKernels::ISA detected = VectorKernels::getISA();
+    std::vector<VectorKernels::ISA> supported;
+    for (VectorKernels::ISA isa : {VectorKernels::ISA::SCALAR, VectorKernels::ISA::SSE2, VectorKernels::ISA::AVX2, VectorKernels::ISA::AVX512})
+    {
+        if (VectorKernels::setISA(isa) != RC::SUCCESS)
+        {
+            CHECK(VectorKernels::getISA() != isa);
+            continue;
+        }
+
+        CHECK(VectorKernels::getISA() == isa);
+        supported.push_back(isa);
+        checkKernels(rng);
+    }
+
+    // Scalar code runs everywhere, and the detected implementation is one of the supported ones
+    CHECK(!supported.empty() && supported[0] == VectorKernels::ISA::SCALAR);
+    CHECK(std::find(supported.begin(), supported.end(), detected) != supported.end());
+
+    checkSwitching(supported);
+    CHECK(VectorKernels::setISA(detected) == RC::SUCCESS);
+    return failures;
+}
@@ -0,0 +1,111 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/IVector.h"
+#include "../include/VectorAllocator.h"
+#include "../include/VectorKernels.h"
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    bool isAligned(void const* ptr)
+    {
+        return reinterpret_cast<uintptr_t>(ptr) % VectorAllocator::dataAlignment == 0;
+    }
+
+    // Every size and misalignment of both ends, bytes around dst stay as they were
+    void checkCopy(std::mt19937& rng)
+    {
+        const size_t maxBytes = 700, margin = 64;
+        std::vector<uint8_t> src(maxBytes + margin), dst(maxBytes + 2 * margin), expected;
+        for (uint8_t& byte : src)
+            byte = (uint8_t)rng();
+
+        for (size_t bytes : {0, 1, 7, 15, 16, 17, 63, 64, 65, 127, 128, 129, 255, 256, 300, 511, 700})
+            for (size_t srcOffset = 0; srcOffset < 16; srcOffset += 3)
+                for (size_t dstOffset = 0; dstOffset < 16; dstOffset += 5)
+                {
+                    std::fill(dst.begin(), dst.end(), 0xAB);
+                    expected = dst;
+                    memcpy(expected.data() + margin + dstOffset, src.data() + srcOffset, bytes);
+                    VectorKernels::copy(dst.data() + margin + dstOffset, src.data() + srcOffset, bytes);
+                    CHECK(dst == expected);
+                }
+    }
+
+    void checkLargeVector(std::mt19937& rng, size_t dim)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> data(dim);
+        for (double& value : data)
+            value = coordinate(rng);
+
+        const VectorAllocator::Stats before = VectorAllocator::getStats();
+        IVector* vector = IVector::createVector(dim, data.data());
+        const VectorAllocator::Stats after = VectorAllocator::getStats();
+        CHECK(vector && isAligned(vector->getData()));
+        CHECK(memcmp(vector->getData(), data.data(), dim * sizeof(double)) == 0);
+
+        const bool isHuge = vector->sizeAllocated() >= VectorAllocator::hugePageThreshold;
+        if (isHuge)
+            CHECK(after.hugePageAllocations == before.hugePageAllocations + 1);
+
+        // Clone and copyInstance go through the bulk copy
+        IVector* clone = vector->clone();
+        CHECK(clone && isAligned(clone->getData()));
+        CHECK(memcmp(clone->getData(), data.data(), dim * sizeof(double)) == 0);
+        CHECK(clone->scale(2) == RC::SUCCESS);
+        CHECK(IVector::copyInstance(clone, vector) == RC::SUCCESS);
+        CHECK(memcmp(clone->getData(), data.data(), dim * sizeof(double)) == 0);
+
+        const double norm = Reference::norm(data.data(), dim, IVector::NORM::SECOND);
+        CHECK(Reference::isClose(vector->norm(IVector::NORM::SECOND), norm, norm, dim));
+
+        // Huge blocks go back to the system at once, they're never cached
+        const VectorAllocator::Stats beforeDelete = VectorAllocator::getStats();
+        delete clone;
+        delete vector;
+        const VectorAllocator::Stats afterDelete = VectorAllocator::getStats();
+        if (isHuge)
+            CHECK(afterDelete.systemReleases == beforeDelete.systemReleases + 2);
+
+        if (isHuge)
+        {
+            const VectorAllocator::Stats beforeAgain = VectorAllocator::getStats();
+            vector = IVector::createVector(dim, data.data());
+            CHECK(VectorAllocator::getStats().poolHits == beforeAgain.poolHits);
+            delete vector;
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(10);
+    const size_t threshold = VectorKernels::getStreamingThreshold();
+    const VectorKernels::ISA detected = VectorKernels::getISA();
+
+    // Streaming stores for every size, then plain memcpy for every size
+    for (VectorKernels::ISA isa : {VectorKernels::ISA::SCALAR, detected})
+    {
+        CHECK(VectorKernels::setISA(isa) == RC::SUCCESS);
+        for (size_t streaming : {(size_t)0, (size_t)128, (size_t)-1})
+        {
+            VectorKernels::setStreamingThreshold(streaming);
+            CHECK(VectorKernels::getStreamingThreshold() == streaming);
+            checkCopy(rng);
+        }
+    }
+
+    VectorKernels::setStreamingThreshold(0);
+    for (size_t dim : {1, 5, 100, 1000, 100000, 600000})
+        checkLargeVector(rng, dim);
+
+    VectorKernels::setStreamingThreshold(threshold);
+    CHECK(VectorKernels::setISA(detected) == RC::SUCCESS);
+    for (size_t dim : {5, 1000, 600000})
+        checkLargeVector(rng, dim);
+
+    return failures;
+}
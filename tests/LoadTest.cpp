@@ -0,0 +1,136 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    const char* const csvPath = "LoadTest.csv";
+    const char* const binaryPath = "LoadTest.bin";
+    const size_t dim = 4;
+
+    std::vector<double> rowsOf(ISet const* set)
+    {
+        std::vector<double> rows(set->getSize() * set->getDim());
+        if (!rows.empty())
+            set->exportRange(0, set->getSize(), rows.data(), set->getDim());
+
+        return rows;
+    }
+
+    // Rows the loader must end with, inserted directly
+    ISet* expectedSet(std::vector<double> const& rows, size_t& accepted)
+    {
+        ISet* set = ISet::createSet();
+        CHECK(set->insertBatch(dim, rows.data(), rows.size() / dim, IVector::NORM::SECOND, 1e-9, accepted) == RC::SUCCESS);
+        return set;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(22);
+    std::uniform_real_distribution<double> coordinate(-100, 100);
+
+    // Enough rows for several chunks, every 1000 rows has three bad ones and one blank line
+    std::vector<double> good;
+    size_t read = 0, rejected = 0;
+    FILE* csv = std::fopen(csvPath, "w");
+    for (size_t i = 0; i < 40000; i++)
+    {
+        double row[dim];
+        for (double& x : row)
+            x = std::round(coordinate(rng) * 1000) / 1000;
+
+        switch (i % 1000)
+        {
+            case 1:
+                std::fprintf(csv, "1,2,3\n");
+                read++, rejected++;
+                continue;
+            case 2:
+                std::fprintf(csv, "1,2,nan,4\n");
+                read++, rejected++;
+                continue;
+            case 3:
+                std::fprintf(csv, "1,2,x,4\n");
+                read++, rejected++;
+                continue;
+            case 4:
+                std::fprintf(csv, "\n  \r\n");
+                continue;
+            case 5:
+                std::fprintf(csv, " +%.17g , %.17g,%.17g\t,%.17g\r\n", row[0], row[1], row[2], row[3]);
+                break;
+            default:
+                std::fprintf(csv, "%.17g,%.17g,%.17g,%.17g\n", row[0], row[1], row[2], row[3]);
+        }
+
+        good.insert(good.end(), row, row + dim);
+        read++;
+    }
+
+    // Last line without a newline
+    std::fprintf(csv, "5,6,7,8");
+    good.insert(good.end(), {5, 6, 7, 8});
+    read++;
+    std::fclose(csv);
+
+    size_t accepted = 0;
+    ISet* expected = expectedSet(good, accepted);
+
+    ISet* set = ISet::createSet();
+    ISet::LoadStats stats;
+    CHECK(set->load(csvPath, ISet::FILE_FORMAT::CSV, dim, IVector::NORM::SECOND, 1e-9, stats) == RC::SUCCESS);
+    CHECK(stats.rowsRead == read);
+    CHECK(stats.rowsRejected == rejected);
+    CHECK(stats.rowsAccepted == accepted);
+    CHECK(rowsOf(set) == rowsOf(expected));
+
+    // Binary rows with Inf and NaN are rejected, a trailing partial row is counted as rejected too
+    std::vector<double> binary = good;
+    binary[dim * 10 + 2] = std::numeric_limits<double>::infinity();
+    binary[dim * 20] = std::numeric_limits<double>::quiet_NaN();
+    FILE* file = std::fopen(binaryPath, "wb");
+    std::fwrite(binary.data(), sizeof(double), binary.size(), file);
+    const double partial[2] = {1, 2};
+    std::fwrite(partial, sizeof(double), 2, file);
+    std::fclose(file);
+
+    std::vector<double> kept;
+    for (size_t i = 0; i < good.size() / dim; i++)
+    {
+        if (i != 10 && i != 20)
+            kept.insert(kept.end(), good.begin() + i * dim, good.begin() + (i + 1) * dim);
+    }
+
+    ISet* binaryExpected = expectedSet(kept, accepted);
+    ISet* binarySet = ISet::createSet();
+    CHECK(binarySet->load(binaryPath, ISet::FILE_FORMAT::BINARY, dim, IVector::NORM::SECOND, 1e-9, stats) == RC::SUCCESS);
+    CHECK(stats.rowsRead == good.size() / dim + 1);
+    CHECK(stats.rowsRejected == 3);
+    CHECK(stats.rowsAccepted == accepted);
+    CHECK(rowsOf(binarySet) == rowsOf(binaryExpected));
+
+    // Concurrent set loads the same rows
+    ISet* concurrent = ISet::createConcurrentSet();
+    CHECK(concurrent->load(binaryPath, ISet::FILE_FORMAT::BINARY, dim, IVector::NORM::SECOND, 1e-9, stats) == RC::SUCCESS);
+    CHECK(rowsOf(concurrent) == rowsOf(binaryExpected));
+
+    // Errors
+    CHECK(binarySet->load("LoadTest.missing.csv", ISet::FILE_FORMAT::CSV, dim, IVector::NORM::SECOND, 0.1, stats) == RC::FILE_NOT_FOUND);
+    CHECK(binarySet->load(csvPath, ISet::FILE_FORMAT::CSV, dim - 1, IVector::NORM::SECOND, 0.1, stats) == RC::MISMATCHING_DIMENSIONS);
+    CHECK(binarySet->load(csvPath, ISet::FILE_FORMAT::CSV, 0, IVector::NORM::SECOND, 0.1, stats) == RC::INVALID_ARGUMENT);
+
+    delete expected;
+    delete set;
+    delete binaryExpected;
+    delete binarySet;
+    delete concurrent;
+
+    std::remove(csvPath);
+    std::remove(binaryPath);
+    return failures;
+}
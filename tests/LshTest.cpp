@@ -0,0 +1,131 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/ISet.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+    const size_t dim = 64, count = 200, queries = 200;
+    const double tol = 1;
+
+    // Point at distance in [0, tol / 2) from row under n
+    std::vector<double> nearPoint(std::mt19937& rng, double const* row, IVector::NORM n)
+    {
+        std::normal_distribution<double> gauss;
+        std::uniform_real_distribution<double> fraction(0, 0.5);
+        std::vector<double> direction(dim);
+        for (double& value : direction)
+            value = gauss(rng);
+
+        const double scale = fraction(rng) * tol / Reference::norm(direction.data(), dim, n);
+        std::vector<double> point(dim);
+        for (size_t i = 0; i < dim; i++)
+            point[i] = row[i] + scale * direction[i];
+        return point;
+    }
+
+    void checkRecall(std::mt19937& rng, IVector::NORM n)
+    {
+        // Far apart cluster centres, every query has exactly one vector within tol
+        std::normal_distribution<double> coordinate(0, 10);
+        std::vector<double> rows(dim * count);
+        for (double& value : rows)
+            value = coordinate(rng);
+
+        ISet* lsh = ISet::createSet();
+        ISet::LshParams params;
+        params.sampleEvery = 1;
+        CHECK(lsh->setIndex(ISet::INDEX::LSH) == RC::SUCCESS && lsh->setLshParams(params) == RC::SUCCESS);
+        size_t accepted = 0;
+        CHECK(lsh->insertBatch(dim, rows.data(), count, n, tol, accepted) == RC::SUCCESS && accepted == count);
+
+        std::vector<std::vector<double>> points;
+        for (size_t i = 0; i < queries; i++)
+            points.push_back(nearPoint(rng, rows.data() + (rng() % count) * dim, n));
+
+        lsh->resetScanStats();
+        size_t found = 0;
+        IVector* result = IVector::createVector(dim, rows.data());
+        for (auto const& point : points)
+        {
+            IVector* pat = IVector::createVector(dim, point.data());
+            if (lsh->findFirstAndCopyCoords(pat, n, tol, result) == RC::SUCCESS)
+            {
+                // Index may miss a vector, but never returns a far one
+                CHECK(Reference::distance(result->getData(), point.data(), dim, n) < tol);
+                found++;
+            }
+            delete pat;
+        }
+
+        // Recall against the exact answer, every lookup was sampled
+        const ISet::ScanStats stats = lsh->getScanStats();
+        CHECK(found >= queries * 9 / 10);
+        CHECK(stats.lookups == queries && stats.sampledLookups == queries);
+        CHECK(stats.exactFound == queries && stats.approxFound == found);
+        CHECK(stats.rowsVisited < queries * count / 4);
+
+        // Larger tolerance or another norm is an exact scan
+        const IVector::NORM other = n == IVector::NORM::SECOND ? IVector::NORM::CHEBYSHEV : IVector::NORM::SECOND;
+        for (size_t i = 0; i < 20; i++)
+        {
+            IVector* pat = IVector::createVector(dim, points[i].data());
+            CHECK(lsh->findFirstAndCopyCoords(pat, n, 2 * tol, result) == RC::SUCCESS);
+            const double distance = Reference::distance(result->getData(), points[i].data(), dim, other);
+            CHECK(lsh->findFirstAndCopyCoords(pat, other, distance * 1.01, result) == RC::SUCCESS);
+            delete pat;
+        }
+
+        // Near duplicates are mostly skipped by insert, a missed one is added
+        const size_t before = lsh->getSize();
+        for (size_t i = 0; i < 50; i++)
+        {
+            IVector* pat = IVector::createVector(dim, points[i].data());
+            CHECK(lsh->insert(pat, n, tol) == RC::SUCCESS);
+            delete pat;
+        }
+        CHECK(lsh->getSize() - before <= 5);
+
+        // Sampling every 4th lookup, then none
+        params.sampleEvery = 4;
+        CHECK(lsh->setLshParams(params) == RC::SUCCESS);
+        IVector* first = IVector::createVector(dim, points[0].data());
+        CHECK(lsh->insert(first, n, tol) == RC::SUCCESS);
+        lsh->resetScanStats();
+        for (size_t i = 0; i < 40; i++)
+            lsh->findFirstAndCopyCoords(first, n, tol, result);
+        CHECK(lsh->getScanStats().sampledLookups == 10);
+
+        params.sampleEvery = 0;
+        CHECK(lsh->setLshParams(params) == RC::SUCCESS);
+        CHECK(lsh->insert(first, n, tol) == RC::SUCCESS);
+        lsh->resetScanStats();
+        for (size_t i = 0; i < 10; i++)
+            lsh->findFirstAndCopyCoords(first, n, tol, result);
+        CHECK(lsh->getScanStats().sampledLookups == 0 && lsh->getScanStats().lookups == 10);
+
+        delete first;
+        delete result;
+        delete lsh;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(24);
+    for (IVector::NORM n : norms)
+        checkRecall(rng, n);
+
+    ISet* set = ISet::createSet();
+    ISet::LshParams params;
+    params.tables = 0;
+    CHECK(set->setLshParams(params) == RC::INVALID_ARGUMENT);
+    params.tables = 8;
+    params.bucketWidth = -1;
+    CHECK(set->setLshParams(params) == RC::INVALID_ARGUMENT);
+    delete set;
+
+    return failures;
+}
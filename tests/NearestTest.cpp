@@ -0,0 +1,140 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include "../include/VectorKernels.h"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    // (distance, index) of every vector, nearest first, equal distances in index order
+    std::vector<std::pair<double, size_t>> sortedByDistance(std::vector<double> const& rows, size_t dim, double const* pat, IVector::NORM n)
+    {
+        std::vector<std::pair<double, size_t>> all;
+        for (size_t i = 0; i < rows.size() / dim; i++)
+            all.emplace_back(VectorKernels::distance(rows.data() + i * dim, pat, dim, n), i);
+        std::sort(all.begin(), all.end());
+        return all;
+    }
+
+    std::vector<double> rowsOf(ISet const* set)
+    {
+        std::vector<double> rows(set->getSize() * set->getDim());
+        if (!rows.empty())
+            CHECK(set->exportRange(0, set->getSize(), rows.data(), set->getDim()) == RC::SUCCESS);
+        return rows;
+    }
+
+    void checkQueries(std::mt19937& rng, ISet const* set, int side)
+    {
+        const size_t dim = set->getDim(), size = set->getSize();
+        const std::vector<double> rows = rowsOf(set);
+        std::uniform_real_distribution<double> coordinate(-1, side);
+        std::vector<size_t> indices(size + 5);
+        std::vector<double> distances(size + 5);
+
+        for (int round = 0; round < 5; round++)
+        {
+            // Pattern on the lattice gives equal distances, off it gives distinct ones
+            std::vector<double> coords(dim);
+            for (double& value : coords)
+                value = round % 2 ? (double)(int)coordinate(rng) : coordinate(rng);
+            IVector* pat = IVector::createVector(dim, coords.data());
+
+            for (IVector::NORM n : norms)
+            {
+                const auto expected = sortedByDistance(rows, dim, coords.data(), n);
+
+                for (size_t k : {(size_t)1, (size_t)3, (size_t)17, size, size + 5})
+                {
+                    size_t found = 0;
+                    CHECK(set->findKNearest(pat, k, n, indices.data(), distances.data(), found) == RC::SUCCESS);
+                    CHECK(found == std::min(k, size));
+                    for (size_t i = 0; i < found; i++)
+                        CHECK(indices[i] == expected[i].second && distances[i] == expected[i].first);
+                }
+
+                for (double r : {0.0, 0.5, 1.0, 2.0, 1e9})
+                    for (size_t capacity : {(size_t)0, (size_t)4, size})
+                    {
+                        const size_t within = std::lower_bound(expected.begin(), expected.end(), std::make_pair(r, (size_t)0)) - expected.begin();
+                        size_t found = 0;
+                        CHECK(set->findWithin(pat, r, n, indices.data(), distances.data(), capacity, found) == RC::SUCCESS);
+                        CHECK(found == within);
+                        for (size_t i = 0; i < std::min(found, capacity); i++)
+                            CHECK(indices[i] == expected[i].second && distances[i] == expected[i].first);
+                    }
+            }
+            delete pat;
+        }
+    }
+
+    void checkSet(std::mt19937& rng, size_t dim, size_t count, int side)
+    {
+        std::uniform_int_distribution<int> lattice(0, side - 1);
+        std::uniform_real_distribution<double> coordinate(0, side);
+        std::vector<double> rows(dim * count);
+        for (size_t i = 0; i < rows.size(); i++)
+            rows[i] = i % 3 ? coordinate(rng) : lattice(rng);
+
+        ISet* set = ISet::createSet();
+        size_t accepted = 0;
+        CHECK(set->setCompactionThreshold(1) == RC::SUCCESS);
+        CHECK(set->insertBatch(dim, rows.data(), count, IVector::NORM::SECOND, 1e-9, accepted) == RC::SUCCESS);
+        checkQueries(rng, set, side);
+
+        // Tree is rebuilt after changes, removed vectors are never returned and indexes follow removals
+        for (size_t i = 0; i < count / 5; i++)
+            CHECK(set->remove(rng() % set->getSize()) == RC::SUCCESS);
+        checkQueries(rng, set, side);
+        std::vector<double> far(dim, 3.0 * side);
+        IVector* vector = IVector::createVector(dim, far.data());
+        CHECK(set->insert(vector, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+        checkQueries(rng, set, side);
+        CHECK(set->compact() == RC::SUCCESS);
+        checkQueries(rng, set, side);
+
+        // Concurrent set answers from its current version
+        ISet* concurrent = ISet::createConcurrentSet();
+        const std::vector<double> current = rowsOf(set);
+        CHECK(concurrent->insertBatch(dim, current.data(), set->getSize(), IVector::NORM::SECOND, 1e-9, accepted) == RC::SUCCESS);
+        checkQueries(rng, concurrent, side);
+
+        // Arguments
+        size_t index = 0, found = 7;
+        double distance = 0;
+        std::vector<double> longer(dim + 1, 0);
+        IVector* wrong = IVector::createVector(dim + 1, longer.data());
+        CHECK(set->findKNearest(wrong, 1, IVector::NORM::SECOND, &index, &distance, found) == RC::MISMATCHING_DIMENSIONS);
+        CHECK(set->findKNearest(vector, 1, IVector::NORM::SECOND, nullptr, &distance, found) == RC::NULLPTR_ERROR);
+        CHECK(set->findWithin(vector, -1, IVector::NORM::SECOND, &index, &distance, 1, found) == RC::INVALID_ARGUMENT);
+        CHECK(set->findKNearest(vector, 0, IVector::NORM::SECOND, nullptr, nullptr, found) == RC::SUCCESS && found == 0);
+
+        delete wrong;
+        delete vector;
+        delete concurrent;
+        delete set;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(23);
+    for (size_t dim : {1, 2, 3, 5, 8})
+        for (size_t count : {1, 10, 300})
+            checkSet(rng, dim, count, 6);
+
+    ISet* empty = ISet::createSet();
+    const double coords[2] = {0, 0};
+    IVector* pat = IVector::createVector(2, coords);
+    size_t index = 0, found = 1;
+    double distance = 0;
+    CHECK(empty->findKNearest(pat, 1, IVector::NORM::SECOND, &index, &distance, found) == RC::SUCCESS && found == 0);
+    CHECK(empty->findWithin(pat, 1, IVector::NORM::SECOND, &index, &distance, 1, found) == RC::SUCCESS && found == 0);
+    delete pat;
+    delete empty;
+
+    return failures;
+}
@@ -0,0 +1,60 @@
+#ifndef IVECTOR_TESTS_REFERENCE_H
+#define IVECTOR_TESTS_REFERENCE_H
+
+#include "../include/IVector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+// Plain left-to-right loops in long double, results of optimized code are compared with them
+namespace Reference
+{
+    inline double norm(double const* data, size_t dim, IVector::NORM n)
+    {
+        long double result = 0;
+        for (size_t i = 0; i < dim; i++)
+        {
+            const long double value = std::fabs((long double)data[i]);
+            if (n == IVector::NORM::CHEBYSHEV)
+                result = std::max(result, value);
+            else
+                result += n == IVector::NORM::FIRST ? value : value * value;
+        }
+
+        return (double)(n == IVector::NORM::SECOND ? std::sqrt(result) : result);
+    }
+
+    inline double distance(double const* op1, double const* op2, size_t dim, IVector::NORM n)
+    {
+        long double result = 0;
+        for (size_t i = 0; i < dim; i++)
+        {
+            const long double diff = std::fabs((long double)op1[i] - (long double)op2[i]);
+            if (n == IVector::NORM::CHEBYSHEV)
+                result = std::max(result, diff);
+            else
+                result += n == IVector::NORM::FIRST ? diff : diff * diff;
+        }
+
+        return (double)(n == IVector::NORM::SECOND ? std::sqrt(result) : result);
+    }
+
+    inline double dot(double const* op1, double const* op2, size_t dim)
+    {
+        long double result = 0;
+        for (size_t i = 0; i < dim; i++)
+            result += (long double)op1[i] * op2[i];
+
+        return (double)result;
+    }
+
+    // |actual - expected| within ulps of dim additions relative to scale
+    inline bool isClose(double actual, double expected, double scale, size_t dim)
+    {
+        const double bound = 4 * (double)(dim + 1) * std::numeric_limits<double>::epsilon() * std::fabs(scale);
+        return std::fabs(actual - expected) <= bound;
+    }
+}
+
+#endif //IVECTOR_TESTS_REFERENCE_H
@@ -0,0 +1,115 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include "../include/VectorKernels.h"
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    size_t bruteForceFind(std::vector<double> const& rows, size_t count, size_t dim, double const* pat, IVector::NORM n, double tol)
+    {
+        for (size_t i = 0; i < count; i++)
+            if (VectorKernels::distance(rows.data() + i * dim, pat, dim, n) < tol)
+                return i;
+        return count;
+    }
+
+    // Many rows share the first coordinate of the pattern, so the first-coordinate pass can't drop them
+    std::vector<double> makeRows(std::mt19937& rng, size_t count, size_t dim, double const* pat)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> rows(count * dim);
+        for (size_t i = 0; i < count; i++)
+            for (size_t j = 0; j < dim; j++)
+                rows[i * dim + j] = j == 0 && rng() % 2 ? pat[0] : coordinate(rng);
+        return rows;
+    }
+
+    void checkKernel(std::mt19937& rng, size_t count, size_t dim)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> pat(dim);
+        for (double& value : pat)
+            value = coordinate(rng);
+        const std::vector<double> rows = makeRows(rng, count, dim, pat.data());
+
+        for (IVector::NORM n : norms)
+            for (double tol : {0.0, 0.05, 0.3, 1.0, 3.0, 100.0})
+            {
+                size_t visited = 0;
+                const size_t expected = bruteForceFind(rows, count, dim, pat.data(), n, tol);
+                CHECK(VectorKernels::findWithin(rows.data(), count, dim, pat.data(), n, tol, visited) == expected);
+                CHECK(visited == (expected == count ? count : expected + 1));
+            }
+
+        // Exact copy of a row is found at that row when nothing before it matches
+        if (count > 0)
+        {
+            const size_t target = rng() % count;
+            size_t visited = 0;
+            double const* row = rows.data() + target * dim;
+            const size_t expected = bruteForceFind(rows, count, dim, row, IVector::NORM::SECOND, 1e-300);
+            CHECK(expected <= target);
+            CHECK(VectorKernels::findWithin(rows.data(), count, dim, row, IVector::NORM::SECOND, 1e-300, visited) == expected);
+        }
+    }
+
+    // FindEqualData of a set without index is the same scan, lookups count the visited rows
+    void checkSet(std::mt19937& rng, size_t count, size_t dim)
+    {
+        std::uniform_real_distribution<double> coordinate(-1, 1);
+        std::vector<double> pat(dim);
+        for (double& value : pat)
+            value = coordinate(rng);
+        const std::vector<double> rows = makeRows(rng, count, dim, pat.data());
+
+        ISet* set = ISet::createSet();
+        CHECK(set->setIndex(ISet::INDEX::NONE) == RC::SUCCESS);
+        size_t accepted = 0;
+        CHECK(set->insertBatch(dim, rows.data(), count, IVector::NORM::SECOND, 0, accepted) == RC::SUCCESS && accepted == count);
+
+        IVector* pattern = IVector::createVector(dim, pat.data());
+        IVector* found = IVector::createVector(dim, pat.data());
+        for (IVector::NORM n : norms)
+            for (double tol : {0.05, 0.5, 2.0})
+            {
+                const size_t expected = bruteForceFind(rows, count, dim, pat.data(), n, tol);
+                set->resetScanStats();
+                const RC rc = set->findFirstAndCopyCoords(pattern, n, tol, found);
+                CHECK((rc == RC::SUCCESS) == (expected != count));
+                if (rc == RC::SUCCESS)
+                    CHECK(VectorKernels::distance(found->getData(), rows.data() + expected * dim, dim, IVector::NORM::CHEBYSHEV) == 0);
+
+                const ISet::ScanStats stats = set->getScanStats();
+                CHECK(stats.lookups == 1);
+                CHECK(stats.rowsVisited == (expected == count ? count : expected + 1));
+            }
+
+        delete pattern;
+        delete found;
+        delete set;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(12);
+    const VectorKernels::ISA detected = VectorKernels::getISA();
+    for (VectorKernels::ISA isa : {VectorKernels::ISA::SCALAR, VectorKernels::ISA::SSE2, VectorKernels::ISA::AVX2, VectorKernels::ISA::AVX512})
+    {
+        if (VectorKernels::setISA(isa) != RC::SUCCESS)
+            continue;
+
+        for (size_t count : {0, 1, 2, 31, 63, 64, 65, 200, 1000})
+            for (size_t dim : {1, 2, 3, 7, 16})
+                checkKernel(rng, count, dim);
+    }
+    CHECK(VectorKernels::setISA(detected) == RC::SUCCESS);
+
+    for (size_t count : {1, 64, 65, 1000})
+        for (size_t dim : {1, 3, 16})
+            checkSet(rng, count, dim);
+
+    return failures;
+}
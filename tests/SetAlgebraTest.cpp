@@ -0,0 +1,178 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/ISet.h"
+#include <random>
+#include <vector>
+
+namespace {
+    using Rows = std::vector<std::vector<double>>;
+
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    // The old O(n * m) definitions: every vector is compared with every vector
+    bool isMember(std::vector<double> const& row, Rows const& rows, IVector::NORM n, double tol)
+    {
+        for (auto const& other : rows)
+            if (Reference::distance(row.data(), other.data(), row.size(), n) < tol)
+                return true;
+        return false;
+    }
+
+    void insertInto(Rows& rows, std::vector<double> const& row, IVector::NORM n, double tol)
+    {
+        if (!isMember(row, rows, n, tol))
+            rows.push_back(row);
+    }
+
+    Rows filter(Rows const& op1, Rows const& op2, IVector::NORM n, double tol, bool member, Rows result = Rows())
+    {
+        for (auto const& row : op1)
+            if (isMember(row, op2, n, tol) == member)
+                insertInto(result, row, n, tol);
+        return result;
+    }
+
+    bool isSubSet(Rows const& op1, Rows const& op2, IVector::NORM n, double tol)
+    {
+        for (auto const& row : op1)
+            if (!isMember(row, op2, n, tol))
+                return false;
+        return true;
+    }
+
+    bool hasRows(ISet const* set, Rows const& rows)
+    {
+        if (!set || set->getSize() != rows.size())
+            return false;
+
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            IVector* copy = nullptr;
+            if (set->getCopy(i, copy) != RC::SUCCESS)
+                return false;
+            const bool isSame = std::equal(rows[i].begin(), rows[i].end(), copy->getData());
+            delete copy;
+            if (!isSame)
+                return false;
+        }
+        return true;
+    }
+
+    // Points of a small integer lattice, so distances are exact and many of them are within tolerance
+    Rows fill(std::mt19937& rng, ISet* set, size_t dim, size_t count, int side, IVector::NORM n, double tol)
+    {
+        std::uniform_int_distribution<int> coordinate(0, side - 1);
+        Rows rows;
+        for (size_t i = 0; i < count; i++)
+        {
+            std::vector<double> row(dim);
+            for (double& value : row)
+                value = coordinate(rng);
+
+            IVector* vector = IVector::createVector(dim, row.data());
+            CHECK(set->insert(vector, n, tol) == RC::SUCCESS);
+            insertInto(rows, row, n, tol);
+            delete vector;
+        }
+        CHECK(hasRows(set, rows));
+        return rows;
+    }
+
+    void checkOperations(ISet const* set1, Rows const& rows1, ISet const* set2, Rows const& rows2, IVector::NORM n, double tol)
+    {
+        ISet* intersection = ISet::makeIntersection(set1, set2, n, tol);
+        ISet* setUnion = ISet::makeUnion(set1, set2, n, tol);
+        ISet* difference = ISet::sub(set1, set2, n, tol);
+        ISet* symDifference = ISet::symSub(set1, set2, n, tol);
+
+        // Empty result is an empty set, not an error
+        CHECK(intersection && setUnion && difference && symDifference);
+        CHECK(hasRows(intersection, filter(rows1, rows2, n, tol, true)));
+        CHECK(hasRows(setUnion, filter(rows2, Rows(), n, tol, false, filter(rows1, Rows(), n, tol, false))));
+        CHECK(hasRows(difference, filter(rows1, rows2, n, tol, false)));
+        CHECK(hasRows(symDifference, filter(rows2, rows1, n, tol, false, filter(rows1, rows2, n, tol, false))));
+
+        CHECK(ISet::subSet(set1, set2, n, tol) == isSubSet(rows1, rows2, n, tol));
+        CHECK(ISet::subSet(set2, set1, n, tol) == isSubSet(rows2, rows1, n, tol));
+        CHECK(ISet::equals(set1, set2, n, tol) == (isSubSet(rows1, rows2, n, tol) && isSubSet(rows2, rows1, n, tol)));
+
+        delete intersection;
+        delete setUnion;
+        delete difference;
+        delete symDifference;
+    }
+
+    void checkAlgebra(std::mt19937& rng, size_t dim, size_t count1, size_t count2, ISet::INDEX index)
+    {
+        for (IVector::NORM n : norms)
+        {
+            // Operands are built with one tolerance, operations use it, smaller and larger ones, and other norms
+            const double buildTol = 1.5;
+            ISet* set1 = ISet::createSet();
+            ISet* set2 = ISet::createSet();
+            CHECK(set1->setIndex(index) == RC::SUCCESS && set2->setIndex(index) == RC::SUCCESS);
+            const Rows rows1 = fill(rng, set1, dim, count1, 8, n, buildTol);
+            const Rows rows2 = fill(rng, set2, dim, count2, 8, n, buildTol);
+
+            for (double tol : {buildTol, 0.5, 2.5})
+                for (IVector::NORM queryNorm : norms)
+                    checkOperations(set1, rows1, set2, rows2, queryNorm, tol);
+
+            // Set compared with itself and with its clone
+            ISet* clone = set1->clone();
+            checkOperations(set1, rows1, clone, rows1, n, buildTol);
+            checkOperations(set1, rows1, set1, rows1, n, buildTol);
+
+            // Operand which isn't ISetImpl goes through IVector lookups
+            ISet* concurrent = ISet::createConcurrentSet();
+            const Rows concurrentRows = fill(rng, concurrent, dim, count2, 8, n, buildTol);
+            checkOperations(set1, rows1, concurrent, concurrentRows, n, buildTol);
+            checkOperations(concurrent, concurrentRows, set1, rows1, n, 2.5);
+
+            // Operands are never changed
+            CHECK(hasRows(set1, rows1) && hasRows(set2, rows2));
+
+            delete concurrent;
+            delete clone;
+            delete set1;
+            delete set2;
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(18);
+    for (ISet::INDEX index : {ISet::INDEX::GRID, ISet::INDEX::NONE})
+    {
+        checkAlgebra(rng, 1, 5, 5, index);
+        checkAlgebra(rng, 2, 40, 30, index);
+        checkAlgebra(rng, 3, 150, 100, index);
+    }
+
+    // Probe rows split into several parts
+    ISet* large = ISet::createSet();
+    ISet* small = ISet::createSet();
+    const Rows largeRows = fill(rng, large, 4, 6000, 10, IVector::NORM::CHEBYSHEV, 0.5);
+    const Rows smallRows = fill(rng, small, 4, 60, 10, IVector::NORM::CHEBYSHEV, 0.5);
+    ISet* intersection = ISet::makeIntersection(large, small, IVector::NORM::CHEBYSHEV, 0.5);
+    ISet* difference = ISet::sub(large, small, IVector::NORM::CHEBYSHEV, 0.5);
+    CHECK(hasRows(intersection, filter(largeRows, smallRows, IVector::NORM::CHEBYSHEV, 0.5, true)));
+    CHECK(difference && difference->getSize() == largeRows.size() - intersection->getSize());
+    CHECK(!ISet::subSet(large, small, IVector::NORM::CHEBYSHEV, 0.5));
+    CHECK(ISet::subSet(intersection, large, IVector::NORM::CHEBYSHEV, 0.5));
+    delete intersection;
+    delete difference;
+
+    // Invalid operands
+    ISet* empty = ISet::createSet();
+    CHECK(ISet::makeUnion(large, empty, IVector::NORM::SECOND, 1) == nullptr);
+    CHECK(ISet::makeIntersection(large, nullptr, IVector::NORM::SECOND, 1) == nullptr);
+    CHECK(ISet::sub(large, small, IVector::NORM::SECOND, -1) == nullptr);
+    CHECK(!ISet::subSet(large, small, IVector::NORM::AMOUNT, 1));
+    delete empty;
+    delete large;
+    delete small;
+
+    return failures;
+}
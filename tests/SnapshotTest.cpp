@@ -0,0 +1,136 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+    typedef std::vector<std::vector<double>> Rows;
+
+    const char* const snapshotPath = "SnapshotTest.bin";
+    const char* const brokenPath = "SnapshotTest.broken.bin";
+
+    Rows rowsOf(ISet const* set)
+    {
+        Rows rows;
+        for (double const* coords : *set)
+            rows.emplace_back(coords, coords + set->getDim());
+
+        return rows;
+    }
+
+    std::vector<char> readFile(char const* path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(char const* path, std::vector<char> const& bytes, size_t count)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(bytes.data(), count);
+    }
+
+    void insertRandom(std::mt19937& rng, ISet* set, ISet* other, size_t dim, size_t count)
+    {
+        std::uniform_real_distribution<double> coordinate(0, 100);
+        std::vector<double> row(dim);
+        for (size_t i = 0; i < count; i++)
+        {
+            for (double& x : row)
+                x = coordinate(rng);
+
+            IVector* vector = IVector::createVector(dim, row.data());
+            CHECK(set->insert(vector, IVector::NORM::SECOND, 0.01) == RC::SUCCESS);
+            if (other)
+                CHECK(other->insert(vector, IVector::NORM::SECOND, 0.01) == RC::SUCCESS);
+            delete vector;
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(21);
+    const size_t dim = 5;
+
+    // Removed vectors aren't saved, the mapped set reads the same vectors in the same order
+    ISet* set = ISet::createSet();
+    insertRandom(rng, set, nullptr, dim, 3000);
+    for (size_t i = 0; i < 300; i++)
+        CHECK(set->remove(i * 7 % set->getSize()) == RC::SUCCESS);
+
+    CHECK(set->save(snapshotPath) == RC::SUCCESS);
+    const std::vector<char> bytes = readFile(snapshotPath);
+
+    ISet* mapped = ISet::openMapped(snapshotPath);
+    CHECK(mapped != nullptr);
+    if (!mapped)
+        return failures;
+
+    CHECK(mapped->getDim() == dim);
+    CHECK(mapped->getSize() == set->getSize());
+    CHECK(rowsOf(mapped) == rowsOf(set));
+    for (size_t i = 0; i < mapped->getSize(); i += 97)
+    {
+        IVector* pattern = nullptr;
+        IVector* found = nullptr;
+        CHECK(mapped->getCopy(i, pattern) == RC::SUCCESS);
+        CHECK(mapped->findFirstAndCopy(pattern, IVector::NORM::FIRST, 1e-9, found) == RC::SUCCESS);
+        delete pattern;
+        delete found;
+    }
+
+    // Changes of the mapped set and of its clone never reach the file
+    ISet* clone = mapped->clone();
+    for (size_t i = 0; i < 100; i++)
+    {
+        CHECK(mapped->remove(i * 3) == RC::SUCCESS);
+        CHECK(set->remove(i * 3) == RC::SUCCESS);
+    }
+
+    CHECK(mapped->compact() == RC::SUCCESS);
+    insertRandom(rng, mapped, set, dim, 500);
+    CHECK(rowsOf(mapped) == rowsOf(set));
+    CHECK(readFile(snapshotPath) == bytes);
+    delete mapped;
+
+    ISet* reopened = ISet::openMapped(snapshotPath);
+    CHECK(reopened && rowsOf(reopened) == rowsOf(clone));
+    delete reopened;
+    delete clone;
+
+    // Damaged files are refused
+    CHECK(ISet::openMapped("SnapshotTest.missing.bin") == nullptr);
+    writeFile(brokenPath, bytes, bytes.size() - sizeof(double));
+    CHECK(ISet::openMapped(brokenPath) == nullptr);
+    writeFile(brokenPath, bytes, 50);
+    CHECK(ISet::openMapped(brokenPath) == nullptr);
+    writeFile(brokenPath, bytes, 0);
+    CHECK(ISet::openMapped(brokenPath) == nullptr);
+    std::vector<char> badMagic = bytes;
+    badMagic[0] = 'X';
+    writeFile(brokenPath, badMagic, badMagic.size());
+    CHECK(ISet::openMapped(brokenPath) == nullptr);
+
+    // Empty set, its dimension is taken from the first insert after opening
+    ISet* empty = ISet::createSet();
+    CHECK(empty->save(snapshotPath) == RC::SUCCESS);
+    ISet* emptyMapped = ISet::openMapped(snapshotPath);
+    CHECK(emptyMapped && emptyMapped->getSize() == 0);
+    if (emptyMapped)
+    {
+        insertRandom(rng, emptyMapped, nullptr, 3, 1);
+        CHECK(emptyMapped->getDim() == 3 && emptyMapped->getSize() == 1);
+    }
+
+    delete emptyMapped;
+    delete empty;
+    delete set;
+
+    std::remove(snapshotPath);
+    std::remove(brokenPath);
+    return failures;
+}
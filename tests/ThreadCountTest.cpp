@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Tolerance of the operands' own index and a larger one, which needs an index built for the call
+    const double tols[] = {0.5, 1.0};
+
+    std::vector<double> rowsOf(ISet const* set)
+    {
+        if (!set)
+            return std::vector<double>();
+
+        std::vector<double> rows(set->getSize() * set->getDim());
+        if (!rows.empty())
+            CHECK(set->exportRange(0, set->getSize(), rows.data(), set->getDim()) == RC::SUCCESS);
+        return rows;
+    }
+
+    ISet* makeSet(std::mt19937& rng, size_t dim, size_t count)
+    {
+        std::uniform_int_distribution<int> coordinate(0, 19);
+        std::vector<double> rows(dim * count);
+        for (double& value : rows)
+            value = coordinate(rng);
+
+        ISet* set = ISet::createSet();
+        size_t accepted = 0;
+        CHECK(set->insertBatch(dim, rows.data(), count, IVector::NORM::CHEBYSHEV, 0.5, accepted) == RC::SUCCESS);
+        return set;
+    }
+
+    struct Results
+    {
+        std::vector<double> intersection, setUnion, difference, symDifference;
+        bool isSubSet, isSubSetOfUnion, isEqual;
+
+        bool operator==(Results const& other) const
+        {
+            return intersection == other.intersection && setUnion == other.setUnion && difference == other.difference &&
+                   symDifference == other.symDifference && isSubSet == other.isSubSet &&
+                   isSubSetOfUnion == other.isSubSetOfUnion && isEqual == other.isEqual;
+        }
+    };
+
+    Results compute(ISet const* set1, ISet const* set2, double tol)
+    {
+        const IVector::NORM n = IVector::NORM::CHEBYSHEV;
+        Results results;
+        ISet* intersection = ISet::makeIntersection(set1, set2, n, tol);
+        ISet* setUnion = ISet::makeUnion(set1, set2, n, tol);
+        ISet* difference = ISet::sub(set1, set2, n, tol);
+        ISet* symDifference = ISet::symSub(set1, set2, n, tol);
+        CHECK(intersection && setUnion && difference && symDifference);
+
+        results.intersection = rowsOf(intersection);
+        results.setUnion = rowsOf(setUnion);
+        results.difference = rowsOf(difference);
+        results.symDifference = rowsOf(symDifference);
+        results.isSubSet = ISet::subSet(set1, set2, n, tol);
+        results.isSubSetOfUnion = ISet::subSet(set1, setUnion, n, tol);
+        results.isEqual = ISet::equals(set1, set1, n, tol);
+
+        delete intersection;
+        delete setUnion;
+        delete difference;
+        delete symDifference;
+        return results;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(19);
+
+    // Several parts of probe rows, so the work is really split
+    ISet* set1 = makeSet(rng, 4, 4500);
+    ISet* set2 = makeSet(rng, 4, 1500);
+    CHECK(set1->getSize() > 4096);
+
+    CHECK(ISet::setThreadCount(1) == RC::SUCCESS && ISet::getThreadCount() == 1);
+    std::vector<Results> expected;
+    for (double tol : tols)
+        expected.push_back(compute(set1, set2, tol));
+    CHECK(expected[0].isSubSetOfUnion && expected[0].isEqual);
+
+    // Same results for any number of threads
+    for (size_t count : {3, 0})
+    {
+        CHECK(ISet::setThreadCount(count) == RC::SUCCESS);
+        CHECK(ISet::getThreadCount() == count || (count == 0 && ISet::getThreadCount() >= 1));
+        for (size_t i = 0; i < 2; i++)
+            CHECK(compute(set1, set2, tols[i]) == expected[i]);
+    }
+
+    // Operations from several threads at once on shared operands
+    CHECK(ISet::setThreadCount(4) == RC::SUCCESS);
+    std::vector<std::thread> threads;
+    std::vector<char> isSame(4, 0);
+    for (size_t t = 0; t < isSame.size(); t++)
+        threads.emplace_back([&, t]() {
+            isSame[t] = compute(set1, set2, tols[t % 2]) == expected[t % 2];
+        });
+    for (std::thread& thread : threads)
+        thread.join();
+    for (char same : isSame)
+        CHECK(same);
+
+    CHECK(ISet::setThreadCount(1) == RC::SUCCESS);
+    delete set1;
+    delete set2;
+
+    return failures;
+}
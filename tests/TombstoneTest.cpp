@@ -0,0 +1,162 @@
+#include "Check.h"
+#include "../include/ISet.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+    using Rows = std::vector<std::vector<double>>;
+
+    bool hasRows(ISet const* set, Rows const& model)
+    {
+        if (set->getSize() != model.size())
+            return false;
+        if (model.empty())
+            return true;
+
+        const size_t dim = set->getDim();
+        std::vector<double> rows(model.size() * dim);
+        if (set->exportRange(0, model.size(), rows.data(), dim) != RC::SUCCESS)
+            return false;
+
+        for (size_t i = 0; i < model.size(); i++)
+            if (!std::equal(model[i].begin(), model[i].end(), rows.begin() + i * dim))
+                return false;
+        return true;
+    }
+
+    // Rows looked at by a lookup that finds nothing, the scan goes over removed rows too until compaction
+    size_t scannedRows(ISet* set)
+    {
+        std::vector<double> far(set->getDim(), 1e6);
+        IVector* pat = IVector::createVector(far.size(), far.data());
+        IVector* found = IVector::createVector(far.size(), far.data());
+        set->resetScanStats();
+        CHECK(set->findFirstAndCopyCoords(pat, IVector::NORM::SECOND, 1, found) == RC::VECTOR_NOT_FOUND);
+        delete pat;
+        delete found;
+        return set->getScanStats().rowsVisited;
+    }
+
+    void checkRandomOperations(std::mt19937& rng, size_t dim, ISet::INDEX index, double threshold)
+    {
+        std::uniform_int_distribution<int> coordinate(0, 3);
+        ISet* set = ISet::createSet();
+        CHECK(set->setIndex(index) == RC::SUCCESS);
+        CHECK(set->setCompactionThreshold(threshold) == RC::SUCCESS);
+        Rows model;
+        const double tol = 0.5;
+
+        for (int step = 0; step < 600; step++)
+        {
+            // Integer coordinates, so distances are exact and patterns match whole groups
+            std::vector<double> coords(dim);
+            for (double& value : coords)
+                value = coordinate(rng);
+            IVector* vector = IVector::createVector(dim, coords.data());
+
+            const unsigned op = rng() % 10;
+            if (op < 6 || model.empty())
+            {
+                bool isNear = false;
+                for (auto const& row : model)
+                {
+                    double distance = 0;
+                    for (size_t i = 0; i < dim; i++)
+                        distance = std::max(distance, std::fabs(row[i] - coords[i]));
+                    isNear = isNear || distance < tol;
+                }
+                // Vector within tol is skipped, insert() still succeeds
+                CHECK(set->insert(vector, IVector::NORM::CHEBYSHEV, tol) == RC::SUCCESS);
+                if (!isNear)
+                    model.push_back(coords);
+            }
+            else if (op < 8)
+            {
+                const size_t position = rng() % model.size();
+                CHECK(set->remove(position) == RC::SUCCESS);
+                model.erase(model.begin() + position);
+            }
+            else if (op < 9)
+            {
+                // Every vector within tol of the pattern goes
+                Rows kept;
+                for (auto const& row : model)
+                {
+                    double distance = 0;
+                    for (size_t i = 0; i < dim; i++)
+                        distance += std::fabs(row[i] - coords[i]);
+                    if (!(distance < 2))
+                        kept.push_back(row);
+                }
+                const RC rc = set->remove(vector, IVector::NORM::FIRST, 2);
+                CHECK(rc == (kept.size() == model.size() ? RC::VECTOR_NOT_FOUND : RC::SUCCESS));
+                model = kept;
+            }
+            else
+                CHECK(set->compact() == RC::SUCCESS);
+
+            delete vector;
+            CHECK(hasRows(set, model));
+        }
+
+        CHECK(set->remove(model.size()) == RC::INVALID_ARGUMENT);
+        delete set;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(14);
+    for (ISet::INDEX index : {ISet::INDEX::NONE, ISet::INDEX::GRID})
+        for (double threshold : {0.25, 0.5, 1.0})
+            for (size_t dim : {1, 2, 3})
+                checkRandomOperations(rng, dim, index, threshold);
+
+    // Removed rows stay in storage until the threshold is passed or compact() is called
+    const size_t count = 100, dim = 3;
+    std::vector<double> rows(count * dim);
+    for (size_t i = 0; i < rows.size(); i++)
+        rows[i] = (double)i;
+
+    ISet* set = ISet::createSet();
+    size_t accepted = 0;
+    CHECK(set->setIndex(ISet::INDEX::NONE) == RC::SUCCESS);
+    CHECK(set->insertBatch(dim, rows.data(), count, IVector::NORM::SECOND, 0.5, accepted) == RC::SUCCESS && accepted == count);
+    CHECK(set->setCompactionThreshold(1) == RC::SUCCESS);
+    for (size_t i = 0; i < 60; i++)
+        CHECK(set->remove(rng() % set->getSize()) == RC::SUCCESS);
+    CHECK(set->getSize() == 40 && scannedRows(set) == count);
+
+    // Removed vector doesn't block inserting it again
+    IVector* removed = nullptr;
+    CHECK(set->getCopy(0, removed) == RC::SUCCESS && set->remove(0) == RC::SUCCESS);
+    CHECK(set->insert(removed, IVector::NORM::SECOND, 0.5) == RC::SUCCESS);
+    CHECK(set->getSize() == 40);
+    delete removed;
+
+    CHECK(set->compact() == RC::SUCCESS && scannedRows(set) == 40);
+    CHECK(set->compact() == RC::SUCCESS && set->getSize() == 40);
+
+    // Default threshold: compaction once more than a quarter of the storage is removed
+    CHECK(set->setCompactionThreshold(0.25) == RC::SUCCESS);
+    for (size_t i = 0; i < 10; i++)
+        CHECK(set->remove(set->getSize() - 1) == RC::SUCCESS);
+    CHECK(scannedRows(set) == 40);
+    CHECK(set->remove(set->getSize() - 1) == RC::SUCCESS);
+    CHECK(scannedRows(set) == 29);
+
+    // Lowering the threshold compacts at once
+    for (size_t i = 0; i < 5; i++)
+        CHECK(set->remove(0) == RC::SUCCESS);
+    CHECK(scannedRows(set) == 29);
+    CHECK(set->setCompactionThreshold(0.1) == RC::SUCCESS && scannedRows(set) == 24);
+
+    CHECK(set->setCompactionThreshold(0) == RC::INVALID_ARGUMENT);
+    CHECK(set->setCompactionThreshold(1.5) == RC::INVALID_ARGUMENT);
+    CHECK(set->setCompactionThreshold(std::nan("")) == RC::INVALID_ARGUMENT);
+    delete set;
+
+    return failures;
+}
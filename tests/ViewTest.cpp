@@ -0,0 +1,170 @@
+#include "Check.h"
+#include "Reference.h"
+#include "../include/ISet.h"
+#include "../include/IVectorView.h"
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+    const IVector::NORM norms[] = {IVector::NORM::CHEBYSHEV, IVector::NORM::FIRST, IVector::NORM::SECOND};
+
+    bool hasExactData(IVector const* vector, double const* expected, size_t dim)
+    {
+        for (size_t i = 0; i < dim; i++)
+            if (vector->getData()[i] != expected[i])
+                return false;
+        return true;
+    }
+
+    void checkExternalViews(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> coordinate(-10, 10);
+        const size_t dim = 37;
+        std::vector<double> data(dim), other(dim);
+        for (size_t i = 0; i < dim; i++)
+        {
+            data[i] = coordinate(rng);
+            other[i] = coordinate(rng);
+        }
+
+        std::shared_ptr<size_t> counter = std::make_shared<size_t>(0);
+        IVectorView* view = IVectorView::createView(dim, data.data(), counter);
+        IVectorView* mutableView = IVectorView::createMutableView(dim, data.data(), counter);
+        IVector* copy = IVector::createVector(dim, data.data());
+        CHECK(view->isValid() && !view->isMutable() && mutableView->isMutable());
+        CHECK(view->getData() == data.data() && view->getDim() == dim);
+
+        // Reads give what an owning vector with the same coordinates gives
+        for (IVector::NORM n : norms)
+        {
+            CHECK(view->norm(n) == copy->norm(n));
+            const double expected = Reference::norm(data.data(), dim, n);
+            CHECK(Reference::isClose(view->norm(n), expected, expected, dim));
+        }
+        CHECK(IVector::dot(view, copy) == IVector::dot(copy, copy));
+        CHECK(IVector::equals(view, copy, IVector::NORM::SECOND, 1e-12));
+
+        // Read-only view never writes
+        CHECK(view->setCord(0, 1) == RC::INVALID_ARGUMENT);
+        CHECK(view->scale(2) == RC::INVALID_ARGUMENT);
+        CHECK(view->inc(copy) == RC::INVALID_ARGUMENT);
+        CHECK(IVector::axpy(1, copy, view) == RC::INVALID_ARGUMENT);
+        CHECK(hasExactData(copy, data.data(), dim));
+
+        // Mutable view writes through to the buffer
+        CHECK(mutableView->scale(2) == RC::SUCCESS && copy->scale(2) == RC::SUCCESS);
+        CHECK(hasExactData(copy, data.data(), dim));
+        CHECK(mutableView->setCord(dim - 1, 0.5) == RC::SUCCESS && data[dim - 1] == 0.5);
+        CHECK(mutableView->setCord(dim, 0.5) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(mutableView->setCord(0, std::nan("")) != RC::SUCCESS && std::isfinite(data[0]));
+        IVector* operand = IVector::createVector(dim, other.data());
+        std::vector<double> expected = data;
+        for (size_t i = 0; i < dim; i++)
+            expected[i] += other[i];
+        CHECK(mutableView->inc(operand) == RC::SUCCESS);
+        CHECK(data == expected);
+
+        IVector* clone = mutableView->clone();
+        CHECK(clone && dynamic_cast<IVectorView*>(clone) == nullptr && hasExactData(clone, data.data(), dim));
+        CHECK(clone->getData() != data.data());
+
+        // Changing the epoch invalidates views, modifications fail, rebind revalidates
+        ++*counter;
+        CHECK(!view->isValid() && !mutableView->isValid());
+        CHECK(mutableView->scale(2) == RC::SOURCE_SET_DESTROYED);
+        CHECK(data == expected);
+        CHECK(mutableView->rebindMutable(dim, data.data(), counter) == RC::SUCCESS && mutableView->isValid());
+        CHECK(view->rebind(dim, other.data()) == RC::SUCCESS && view->isValid());
+        CHECK(hasExactData(view, other.data(), dim));
+        CHECK(view->rebind(0, other.data()) == RC::INVALID_ARGUMENT);
+        CHECK(view->rebind(dim, nullptr) == RC::INVALID_ARGUMENT);
+
+        delete clone;
+        delete operand;
+        delete copy;
+        delete view;
+        delete mutableView;
+    }
+
+    void checkSetViews(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> coordinate(-10, 10);
+        const size_t dim = 5, count = 200;
+        ISet* set = ISet::createSet();
+        for (size_t i = 0; i < count; i++)
+        {
+            double coords[dim];
+            for (double& value : coords)
+                value = coordinate(rng);
+            IVector* vector = IVector::createVector(dim, coords);
+            CHECK(set->insert(vector, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+            delete vector;
+        }
+
+        // Views see the same coordinates as copies
+        std::vector<IVectorView*> views(count, nullptr);
+        for (size_t i = 0; i < count; i++)
+        {
+            IVector* copy = nullptr;
+            CHECK(set->getView(i, views[i]) == RC::SUCCESS && set->getCopy(i, copy) == RC::SUCCESS);
+            CHECK(views[i]->isValid() && hasExactData(views[i], copy->getData(), dim));
+            CHECK(views[i]->setCord(0, 1) == RC::INVALID_ARGUMENT);
+            delete copy;
+        }
+        IVectorView* view = nullptr;
+        CHECK(set->getView(count, view) == RC::INDEX_OUT_OF_BOUND && view == nullptr);
+
+        // Every kind of modification invalidates all views
+        double coords[dim] = {100, 100, 100, 100, 100};
+        IVector* far = IVector::createVector(dim, coords);
+        CHECK(set->insert(far, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+        for (IVectorView* setView : views)
+            CHECK(!setView->isValid());
+
+        for (size_t i = 0; i < count; i++)
+            CHECK(set->rebindView(i, views[i]) == RC::SUCCESS && views[i]->isValid());
+        CHECK(set->remove(far, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+        CHECK(!views[0]->isValid());
+
+        CHECK(set->rebindView(0, views[0]) == RC::SUCCESS && views[0]->isValid());
+        CHECK(set->remove(0) == RC::SUCCESS);
+        CHECK(!views[0]->isValid());
+
+        CHECK(set->rebindView(0, views[0]) == RC::SUCCESS && views[0]->isValid());
+        IVector* copy = nullptr;
+        CHECK(set->getCopy(0, copy) == RC::SUCCESS && hasExactData(views[0], copy->getData(), dim));
+        delete copy;
+        CHECK(set->compact() == RC::SUCCESS);
+        CHECK(!views[0]->isValid());
+        CHECK(set->rebindView(set->getSize(), views[0]) == RC::INDEX_OUT_OF_BOUND);
+        CHECK(set->rebindView(0, nullptr) == RC::NULLPTR_ERROR);
+
+        // Destroyed set
+        CHECK(set->rebindView(1, views[1]) == RC::SUCCESS && views[1]->isValid());
+        delete set;
+        CHECK(!views[1]->isValid());
+
+        // Concurrent set has no views
+        ISet* concurrent = ISet::createConcurrentSet();
+        CHECK(concurrent->insert(far, IVector::NORM::SECOND, 1e-9) == RC::SUCCESS);
+        CHECK(concurrent->getView(0, view) == RC::INVALID_ARGUMENT);
+        CHECK(concurrent->rebindView(0, views[1]) == RC::INVALID_ARGUMENT);
+        delete concurrent;
+
+        delete far;
+        for (IVectorView* setView : views)
+            delete setView;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(7);
+    for (int round = 0; round < 10; round++)
+        checkExternalViews(rng);
+    checkSetViews(rng);
+
+    return failures;
+}